@@ -17,11 +17,13 @@ SOURCES += main.cpp\
         mainwindow.cpp \
     audio_recording.cpp \
     desktop_record.cpp \
+    recording_controller.cpp \
     video_recording.cpp
 
 HEADERS  += mainwindow.h \
     audio_recording.h \
     desktop_record.h \
+    recording_controller.h \
     video_recording.h
 
 LIBDIR = $$PWD\..\video_record\libav\libs
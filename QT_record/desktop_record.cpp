@@ -53,8 +53,6 @@ int frame_size = 0;
 
 uint8_t *picture_buf = NULL, *frame_buf = NULL;
 
-bool bCap = true;
-
 DWORD WINAPI ScreenCapThreadProc(LPVOID lpParam);
 DWORD WINAPI AudioCapThreadProc(LPVOID lpParam);
 
@@ -247,6 +245,7 @@ int OpenOutPut()
 
 DWORD WINAPI ScreenCapThreadProc(LPVOID lpParam)
 {
+    DesktopRecord *record = (DesktopRecord *)lpParam;
     AVPacket packet;/* = (AVPacket *)av_malloc(sizeof(AVPacket))*/;
     int got_picture;
     AVFrame *pFrame;
@@ -268,7 +267,7 @@ DWORD WINAPI ScreenCapThreadProc(LPVOID lpParam)
     int height = pFormatCtx_Out->streams[VideoIndex]->codec->height;
     int width = pFormatCtx_Out->streams[VideoIndex]->codec->width;
     int y_size = height*width;
-    while (bCap)
+    while (record->isCapturing())
     {
         packet.data = NULL;
         packet.size = 0;
@@ -276,6 +275,11 @@ DWORD WINAPI ScreenCapThreadProc(LPVOID lpParam)
         {
             continue;
         }
+        if (record->isPaused())
+        {
+            av_free_packet(&packet);
+            continue;
+        }
         if (packet.stream_index == 0)
         {
             if (avcodec_decode_video2(pCodecCtx_Video, pFrame, &got_picture, &packet) < 0)
@@ -288,6 +292,7 @@ DWORD WINAPI ScreenCapThreadProc(LPVOID lpParam)
                 sws_scale(img_convert_ctx, (const uint8_t* const*)pFrame->data, pFrame->linesize, 0,
                     pFormatCtx_Out->streams[VideoIndex]->codec->height, picture->data, picture->linesize);
 
+                bool queued = false;
                 if (av_fifo_space(fifo_video) >= size)
                 {
                     EnterCriticalSection(&VideoSection);
@@ -295,7 +300,9 @@ DWORD WINAPI ScreenCapThreadProc(LPVOID lpParam)
                     av_fifo_generic_write(fifo_video, picture->data[1], y_size / 4, NULL);
                     av_fifo_generic_write(fifo_video, picture->data[2], y_size / 4, NULL);
                     LeaveCriticalSection(&VideoSection);
+                    queued = true;
                 }
+                record->onVideoCaptured(picture, width, height, queued);
             }
         }
         av_free_packet(&packet);
@@ -309,11 +316,12 @@ DWORD WINAPI ScreenCapThreadProc(LPVOID lpParam)
 
 DWORD WINAPI AudioCapThreadProc(LPVOID lpParam)
 {
+    DesktopRecord *record = (DesktopRecord *)lpParam;
     AVPacket pkt;
     AVFrame *frame;
     frame = av_frame_alloc();
     int gotframe;
-    while (bCap)
+    while (record->isCapturing())
     {
         pkt.data = NULL;
         pkt.size = 0;
@@ -330,7 +338,7 @@ DWORD WINAPI AudioCapThreadProc(LPVOID lpParam)
         }
         av_free_packet(&pkt);
 
-        if (!gotframe)
+        if (!gotframe || record->isPaused())
         {
             continue;
         }
@@ -354,22 +362,46 @@ DWORD WINAPI AudioCapThreadProc(LPVOID lpParam)
 }
 
 
-DesktopRecord::DesktopRecord()
+DesktopRecord::DesktopRecord(DesktopRecordListener *listener)
+    : listener(listener)
+    , previewConvertCtx(NULL)
+    , previewMaxWidth(320)
+    , previewIntervalMs(1000 / 10)
+    , lastPreviewTime(0)
+    , stopRequested(false)
+    , paused(false)
+    , framesCaptured(0)
+    , framesEncoded(0)
+    , framesDropped(0)
+    , videoQueueFrames(0)
+    , audioQueueSamples(0)
 {
-    av_register_all();
-    avdevice_register_all();
-    if (OpenVideoCapture() < 0)
+}
+
+static void CloseCapture()
+{
+    if (pFormatCtx_Video != NULL)
     {
-        return;
+        avformat_close_input(&pFormatCtx_Video);
+        pFormatCtx_Video = NULL;
     }
-    if (OpenAudioCapture() < 0)
+    if (pFormatCtx_Audio != NULL)
     {
-        return;
+        avformat_close_input(&pFormatCtx_Audio);
+        pFormatCtx_Audio = NULL;
     }
-    if (OpenOutPut() < 0)
+}
+
+int DesktopRecord::run()
+{
+    av_register_all();
+    avdevice_register_all();
+    if (OpenVideoCapture() < 0 || OpenAudioCapture() < 0 || OpenOutPut() < 0)
     {
-        return;
+        CloseCapture();
+        return -1;
     }
+    lastPreviewTime = 0;
 
     InitializeCriticalSection(&VideoSection);
     InitializeCriticalSection(&AudioSection);
@@ -386,18 +418,20 @@ DesktopRecord::DesktopRecord()
 
 
 
+    HANDLE capThreads[2];
     //star cap screen thread
-    CreateThread(NULL, 0, ScreenCapThreadProc, 0, 0, NULL);
+    capThreads[0] = CreateThread(NULL, 0, ScreenCapThreadProc, this, 0, NULL);
     //star cap audio thread
-    CreateThread(NULL, 0, AudioCapThreadProc, 0, 0, NULL);
+    capThreads[1] = CreateThread(NULL, 0, AudioCapThreadProc, this, 0, NULL);
     int64_t cur_pts_v = 0, cur_pts_a = 0;
     int VideoFrameIndex = 0, AudioFrameIndex = 0;
 
     while (1)
     {
-//        if (_kbhit() != 0 && bCap)
+        bool idle = true;
+//        if (_kbhit() != 0 && !stopRequested)
 //        {
-//            bCap = false;
+//            stopRequested = true;
 //            Sleep(2000);//??????sleep???????????
 //        }
         if (fifo_audio && fifo_video)
@@ -406,17 +440,25 @@ DesktopRecord::DesktopRecord()
             int sizeVideo = av_fifo_size(fifo_video);
             //???????????????????
             if (av_audio_fifo_size(fifo_audio) <= pFormatCtx_Out->streams[AudioIndex]->codec->frame_size &&
-                av_fifo_size(fifo_video) <= frame_size && !bCap)
+                av_fifo_size(fifo_video) <= frame_size && stopRequested)
             {
                 break;
             }
         }
+        else if (stopRequested)
+        {
+            //the audio device never delivered, nothing left to mux
+            break;
+        }
+
+        videoQueueFrames = av_fifo_size(fifo_video) / size;
+        audioQueueSamples = fifo_audio ? av_audio_fifo_size(fifo_audio) : 0;
 
         if (av_compare_ts(cur_pts_v, pFormatCtx_Out->streams[VideoIndex]->time_base,
             cur_pts_a, pFormatCtx_Out->streams[AudioIndex]->time_base) <= 0)
         {
             //read data from fifo
-            if (av_fifo_size(fifo_video) < frame_size && !bCap)
+            if (av_fifo_size(fifo_video) < frame_size && stopRequested)
             {
                 cur_pts_v = 0x7fffffffffffffff;
             }
@@ -464,15 +506,18 @@ DesktopRecord::DesktopRecord()
                     av_free_packet(&pkt);
                 }
                 VideoFrameIndex++;
+                framesEncoded++;
+                idle = false;
             }
         }
         else
         {
             if (NULL == fifo_audio)
             {
+                Sleep(5);
                 continue;//??d??'??fifo
             }
-            if (av_audio_fifo_size(fifo_audio) < pFormatCtx_Out->streams[AudioIndex]->codec->frame_size && !bCap)
+            if (av_audio_fifo_size(fifo_audio) < pFormatCtx_Out->streams[AudioIndex]->codec->frame_size && stopRequested)
             {
                 cur_pts_a = 0x7fffffffffffffff;
             }
@@ -524,33 +569,122 @@ DesktopRecord::DesktopRecord()
                     av_free_packet(&pkt_out);
                 }
                 AudioFrameIndex++;
+                idle = false;
             }
         }
+
+        if (idle)
+        {
+            //nothing queued yet, don't spin the core the capture threads need
+            Sleep(5);
+        }
     }
 
+    WaitForMultipleObjects(2, capThreads, TRUE, INFINITE);
+    CloseHandle(capThreads[0]);
+    CloseHandle(capThreads[1]);
+
+    av_frame_free(&picture);
     delete[] picture_buf;
+    picture_buf = NULL;
 
     av_fifo_free(fifo_video);
-    av_audio_fifo_free(fifo_audio);
+    fifo_video = NULL;
+    if (fifo_audio != NULL)
+    {
+        av_audio_fifo_free(fifo_audio);
+        fifo_audio = NULL;
+    }
+    videoQueueFrames = 0;
+    audioQueueSamples = 0;
+
+    DeleteCriticalSection(&VideoSection);
+    DeleteCriticalSection(&AudioSection);
 
     av_write_trailer(pFormatCtx_Out);
 
     avio_close(pFormatCtx_Out->pb);
     avformat_free_context(pFormatCtx_Out);
+    pFormatCtx_Out = NULL;
 
-    if (pFormatCtx_Video != NULL)
+    CloseCapture();
+    return 0;
+}
+
+void DesktopRecord::stop()
+{
+    stopRequested = true;
+}
+
+void DesktopRecord::setPaused(bool paused)
+{
+    this->paused = paused;
+}
+
+bool DesktopRecord::isPaused() const
+{
+    return paused;
+}
+
+void DesktopRecord::setPreviewSize(int maxWidth, int maxFps)
+{
+    previewMaxWidth = maxWidth;
+    previewIntervalMs = maxFps > 0 ? 1000 / maxFps : 0;
+}
+
+DesktopRecordStatistics DesktopRecord::statistics() const
+{
+    DesktopRecordStatistics stats;
+    stats.framesCaptured = framesCaptured;
+    stats.framesEncoded = framesEncoded;
+    stats.framesDropped = framesDropped;
+    stats.videoQueueFrames = videoQueueFrames;
+    stats.audioQueueSamples = audioQueueSamples;
+    return stats;
+}
+
+void DesktopRecord::onVideoCaptured(AVFrame *picture, int width, int height, bool queued)
+{
+    framesCaptured++;
+    if (!queued)
     {
-        avformat_close_input(&pFormatCtx_Video);
-        pFormatCtx_Video = NULL;
+        framesDropped++;
     }
-    if (pFormatCtx_Audio != NULL)
+
+    //the preview is cut from the already converted YUV frame, at most
+    //previewIntervalMs apart so it never competes with the encoder
+    if (listener == NULL || previewMaxWidth <= 0)
     {
-        avformat_close_input(&pFormatCtx_Audio);
-        pFormatCtx_Audio = NULL;
+        return;
     }
-}
+    unsigned long long now = GetTickCount64();
+    if (lastPreviewTime != 0 && now - lastPreviewTime < (unsigned long long)previewIntervalMs)
+    {
+        return;
+    }
+    lastPreviewTime = now;
 
+    int previewWidth = (previewMaxWidth < width ? previewMaxWidth : width) & ~1;
+    int previewHeight = (int)((long long)height * previewWidth / width) & ~1;
+    if (previewWidth <= 0 || previewHeight <= 0)
+    {
+        return;
+    }
+    previewConvertCtx = sws_getCachedContext(previewConvertCtx, width, height, AV_PIX_FMT_YUV420P,
+        previewWidth, previewHeight, AV_PIX_FMT_BGRA, SWS_FAST_BILINEAR, NULL, NULL, NULL);
+    if (previewConvertCtx == NULL)
+    {
+        return;
+    }
+
+    QImage image(previewWidth, previewHeight, QImage::Format_RGB32);
+    uint8_t *dst[4] = { image.bits(), NULL, NULL, NULL };
+    int dstStride[4] = { image.bytesPerLine(), 0, 0, 0 };
+    sws_scale(previewConvertCtx, (const uint8_t* const*)picture->data, picture->linesize, 0, height, dst, dstStride);
+    listener->previewReady(image);
+}
 
 DesktopRecord::~DesktopRecord()
 {
+    sws_freeContext(previewConvertCtx);
 }
@@ -1,8 +1,63 @@
 #pragma once
+
+#include <atomic>
+#include <QImage>
+
+struct SwsContext;
+struct AVFrame;
+
+struct DesktopRecordStatistics
+{
+    long long framesCaptured;
+    long long framesEncoded;
+    long long framesDropped;
+    int videoQueueFrames;
+    int audioQueueSamples;
+};
+
+// Receives the downscaled preview frames. Called from the screen capture
+// thread, so implementations must hand the image over to their own thread.
+class DesktopRecordListener
+{
+public:
+    virtual ~DesktopRecordListener() {}
+    virtual void previewReady(const QImage &image) = 0;
+};
+
 class DesktopRecord
 {
 public:
-    DesktopRecord();
+    DesktopRecord(DesktopRecordListener *listener = 0);
     virtual ~DesktopRecord();
-};
 
+    // Opens the devices and records until stop() is called. Blocks, so run it
+    // on a worker thread. Returns 0 once the output file has been finalized.
+    int run();
+    // Safe to call from any thread, both return immediately.
+    void stop();
+    void setPaused(bool paused);
+    bool isPaused() const;
+    // false once stop() was called, also when that happened before run()
+    bool isCapturing() const { return !stopRequested; }
+
+    void setPreviewSize(int maxWidth, int maxFps);
+    DesktopRecordStatistics statistics() const;
+
+    // Called by the capture threads.
+    void onVideoCaptured(AVFrame *picture, int width, int height, bool queued);
+
+private:
+    DesktopRecordListener *listener;
+    SwsContext *previewConvertCtx;
+    int previewMaxWidth;
+    int previewIntervalMs;
+    unsigned long long lastPreviewTime;
+
+    std::atomic<bool> stopRequested;
+    std::atomic<bool> paused;
+    std::atomic<long long> framesCaptured;
+    std::atomic<long long> framesEncoded;
+    std::atomic<long long> framesDropped;
+    std::atomic<int> videoQueueFrames;
+    std::atomic<int> audioQueueSamples;
+};
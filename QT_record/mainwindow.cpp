@@ -3,13 +3,18 @@
 
 #include "audio_recording.h"
 #include "video_recording.h"
-#include "desktop_record.h"
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
-    ui(new Ui::MainWindow)
+    ui(new Ui::MainWindow),
+    recorder(new RecordingController(this))
 {
     ui->setupUi(this);
+
+    connect(recorder, SIGNAL(started()), this, SLOT(onRecordingStarted()));
+    connect(recorder, SIGNAL(stopped(bool)), this, SLOT(onRecordingStopped(bool)));
+    connect(recorder, SIGNAL(previewAvailable(QImage)), this, SLOT(onPreviewAvailable(QImage)));
+    connect(recorder, SIGNAL(statisticsUpdated(RecordingStatistics)), this, SLOT(onStatisticsUpdated(RecordingStatistics)));
 }
 
 MainWindow::~MainWindow()
@@ -19,7 +24,64 @@ MainWindow::~MainWindow()
 
 void MainWindow::on_pushButton_clicked()
 {
-    DesktopRecord record;
+    if (recorder->isRecording())
+    {
+        recorder->stop();
+        ui->pushButton->setEnabled(false);
+        ui->pushButton->setText("stopping...");
+    }
+    else if (!recorder->isStopping())
+    {
+        recorder->start();
+    }
+}
+
+void MainWindow::on_pauseButton_toggled(bool checked)
+{
+    recorder->setPaused(checked);
+    ui->pauseButton->setText(checked ? "resume" : "pause");
+}
+
+void MainWindow::onRecordingStarted()
+{
+    ui->pushButton->setText("stop");
+    ui->pauseButton->setEnabled(true);
+}
+
+void MainWindow::onRecordingStopped(bool ok)
+{
+    ui->pushButton->setEnabled(true);
+    ui->pushButton->setText("record both");
+    ui->pauseButton->setChecked(false);
+    ui->pauseButton->setEnabled(false);
+    ui->preview->clear();
+    if (!ok)
+    {
+        ui->statistics->setText("could not open the capture devices");
+    }
+}
+
+void MainWindow::onPreviewAvailable(const QImage &image)
+{
+    if (!recorder->isRecording())
+    {
+        return;
+    }
+    ui->preview->setPixmap(QPixmap::fromImage(image).scaled(ui->preview->size(), Qt::KeepAspectRatio));
+}
+
+void MainWindow::onStatisticsUpdated(const RecordingStatistics &stats)
+{
+    ui->statistics->setText(QString("capture %1 fps, encode %2 fps\n"
+                                    "encoded %3, dropped %4\n"
+                                    "queued %5 frames, %6 samples%7")
+                            .arg(stats.captureFps, 0, 'f', 1)
+                            .arg(stats.encodeFps, 0, 'f', 1)
+                            .arg(stats.framesEncoded)
+                            .arg(stats.framesDropped)
+                            .arg(stats.videoQueueFrames)
+                            .arg(stats.audioQueueSamples)
+                            .arg(recorder->isPaused() ? "\npaused" : ""));
 }
 
 void MainWindow::on_recordvideo_clicked()
@@ -3,6 +3,8 @@
 
 #include <QMainWindow>
 
+#include "recording_controller.h"
+
 namespace Ui {
 class MainWindow;
 }
@@ -22,8 +24,19 @@ private slots:
 
     void on_recordaudio_clicked();
 
+    void on_pauseButton_toggled(bool checked);
+
+    void onRecordingStarted();
+
+    void onRecordingStopped(bool ok);
+
+    void onPreviewAvailable(const QImage &image);
+
+    void onStatisticsUpdated(const RecordingStatistics &stats);
+
 private:
     Ui::MainWindow *ui;
+    RecordingController *recorder;
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,144 @@
+#include "recording_controller.h"
+
+#include <QThread>
+#include <QTimer>
+
+namespace {
+
+class RecordThread : public QThread
+{
+public:
+    RecordThread(DesktopRecord *record, int *result)
+        : record(record)
+        , result(result)
+    {
+    }
+
+protected:
+    void run()
+    {
+        *result = record->run();
+    }
+
+private:
+    DesktopRecord *record;
+    int *result;
+};
+
+}
+
+RecordingController::RecordingController(QObject *parent) :
+    QObject(parent),
+    record(NULL),
+    thread(NULL),
+    statsTimer(new QTimer(this)),
+    result(0),
+    stopping(false)
+{
+    qRegisterMetaType<RecordingStatistics>();
+    statsTimer->setInterval(1000);
+    connect(statsTimer, SIGNAL(timeout()), this, SLOT(sampleStatistics()));
+}
+
+RecordingController::~RecordingController()
+{
+    if (thread != NULL)
+    {
+        record->stop();
+        thread->wait();
+        delete thread;
+        delete record;
+    }
+}
+
+bool RecordingController::isRecording() const
+{
+    return thread != NULL && !stopping;
+}
+
+bool RecordingController::isStopping() const
+{
+    return stopping;
+}
+
+bool RecordingController::isPaused() const
+{
+    return record != NULL && record->isPaused();
+}
+
+void RecordingController::start()
+{
+    if (thread != NULL)
+    {
+        return;
+    }
+    record = new DesktopRecord(this);
+    thread = new RecordThread(record, &result);
+    connect(thread, SIGNAL(finished()), this, SLOT(onThreadFinished()));
+
+    stopping = false;
+    lastStats = record->statistics();
+    statsClock.start();
+    statsTimer->start();
+    thread->start();
+    emit started();
+}
+
+void RecordingController::stop()
+{
+    if (thread == NULL || stopping)
+    {
+        return;
+    }
+    // the worker drains the queues and writes the trailer, stopped() follows
+    stopping = true;
+    record->setPaused(false);
+    record->stop();
+}
+
+void RecordingController::setPaused(bool paused)
+{
+    if (record != NULL && !stopping)
+    {
+        record->setPaused(paused);
+    }
+}
+
+void RecordingController::onThreadFinished()
+{
+    sampleStatistics();
+    statsTimer->stop();
+
+    thread->deleteLater();
+    thread = NULL;
+    delete record;
+    record = NULL;
+    stopping = false;
+    emit stopped(result == 0);
+}
+
+void RecordingController::sampleStatistics()
+{
+    if (record == NULL)
+    {
+        return;
+    }
+    DesktopRecordStatistics current = record->statistics();
+    double seconds = statsClock.restart() / 1000.0;
+
+    RecordingStatistics stats;
+    stats.captureFps = seconds > 0 ? (current.framesCaptured - lastStats.framesCaptured) / seconds : 0;
+    stats.encodeFps = seconds > 0 ? (current.framesEncoded - lastStats.framesEncoded) / seconds : 0;
+    stats.framesEncoded = current.framesEncoded;
+    stats.framesDropped = current.framesDropped;
+    stats.videoQueueFrames = current.videoQueueFrames;
+    stats.audioQueueSamples = current.audioQueueSamples;
+    lastStats = current;
+    emit statisticsUpdated(stats);
+}
+
+void RecordingController::previewReady(const QImage &image)
+{
+    // runs on the capture thread, the queued connection hands it to the GUI
+    emit previewAvailable(image);
+}
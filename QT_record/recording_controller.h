@@ -0,0 +1,66 @@
+#ifndef RECORDING_CONTROLLER_H
+#define RECORDING_CONTROLLER_H
+
+#include <QObject>
+#include <QImage>
+#include <QElapsedTimer>
+#include <QMetaType>
+
+#include "desktop_record.h"
+
+class QThread;
+class QTimer;
+
+struct RecordingStatistics
+{
+    double captureFps;
+    double encodeFps;
+    long long framesEncoded;
+    long long framesDropped;
+    int videoQueueFrames;
+    int audioQueueSamples;
+};
+Q_DECLARE_METATYPE(RecordingStatistics)
+
+// Owns a DesktopRecord and runs it on a worker thread, so start(), stop() and
+// setPaused() return immediately and the GUI thread never waits on ffmpeg.
+class RecordingController : public QObject, private DesktopRecordListener
+{
+    Q_OBJECT
+
+public:
+    explicit RecordingController(QObject *parent = 0);
+    ~RecordingController();
+
+    bool isRecording() const;
+    bool isStopping() const;
+    bool isPaused() const;
+
+public slots:
+    void start();
+    void stop();
+    void setPaused(bool paused);
+
+signals:
+    void started();
+    void stopped(bool ok);
+    void previewAvailable(const QImage &image);
+    void statisticsUpdated(const RecordingStatistics &stats);
+
+private slots:
+    void onThreadFinished();
+    void sampleStatistics();
+
+private:
+    void previewReady(const QImage &image);
+
+    DesktopRecord *record;
+    QThread *thread;
+    QTimer *statsTimer;
+    QElapsedTimer statsClock;
+    DesktopRecordStatistics lastStats;
+    int result;
+    bool stopping;
+};
+
+#endif // RECORDING_CONTROLLER_H
@@ -8,6 +8,8 @@
 
 #include <opencv2/core/ocl.hpp>
 
+#include "ingest_benchmark.h"
+
 #include "opencv2/imgproc.hpp"
 #include <Windows.h>
 
@@ -65,8 +67,13 @@ Mat hwnd2mat(HWND hwnd)
 }
 
 
-int main()
+int main(int argc, char* argv[])
 {
+    if (argc > 1 && string(argv[1]) == "--benchmark")
+    {
+        return runIngestBenchmark(argc, argv);
+    }
+
     if (!cv::ocl::haveOpenCL())
     {
         cout << "OpenCL is not avaiable..." << endl;
@@ -0,0 +1,274 @@
+#include "stdafx.h"
+#include "ingest_benchmark.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/core/ocl.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+
+using namespace std;
+using namespace cv;
+
+namespace
+{
+
+// Distinct frames kept per source, so consecutive reads do not hit a warm cache
+const int FramesPerSource = 4;
+
+struct Source
+{
+    string name;
+    vector<Mat> frames;
+    Size outputSize;
+};
+
+struct StepTimes
+{
+    vector<double> read;
+    vector<double> resize;
+    vector<double> composite;
+    vector<double> total;
+};
+
+vector<string> split(const string& text, char separator)
+{
+    vector<string> parts;
+    stringstream stream(text);
+    string part;
+    while (getline(stream, part, separator))
+    {
+        if (!part.empty())
+            parts.push_back(part);
+    }
+    return parts;
+}
+
+Mat syntheticFrame(Size size, int type, int seed)
+{
+    // gradients plus noise, so resize has real work and compression-like
+    // shortcuts in the copies do not apply
+    Mat frame(size, type);
+    RNG rng(seed);
+    rng.fill(frame, RNG::UNIFORM, Scalar::all(0), Scalar::all(256));
+    Mat gradient(size, type);
+    for (int y = 0; y < size.height; y++)
+        gradient.row(y).setTo(Scalar::all((y * 255) / size.height));
+    addWeighted(frame, 0.25, gradient, 0.75, 0, frame);
+    return frame;
+}
+
+bool loadReplay(const string& path, Source& source)
+{
+    VideoCapture replay(path);
+    if (!replay.isOpened())
+        return false;
+
+    Mat frame;
+    while ((int)source.frames.size() < FramesPerSource && replay.read(frame))
+        source.frames.push_back(frame.clone());
+    return !source.frames.empty();
+}
+
+double percentile(vector<double> values, double p)
+{
+    if (values.empty())
+        return 0;
+    sort(values.begin(), values.end());
+    size_t index = min(values.size() - 1, (size_t)(p * (values.size() - 1) + 0.5));
+    return values[index];
+}
+
+void printStep(const char* step, const vector<double>& times)
+{
+    cout << "  " << left << setw(10) << step << right << fixed << setprecision(2)
+         << " p50 " << setw(8) << percentile(times, 0.50)
+         << " p90 " << setw(8) << percentile(times, 0.90)
+         << " p99 " << setw(8) << percentile(times, 0.99)
+         << " max " << setw(8) << percentile(times, 1.00) << " ms" << endl;
+}
+
+double elapsedMs(int64 from, int64 to)
+{
+    return (to - from) * 1000.0 / getTickFrequency();
+}
+
+// One iteration reads a new frame from every source, resizes it to its slot
+// and composites it into the canvas, like one pass of the camera loop.
+void runConfiguration(vector<Source>& sources, const Size& canvasSize, int iterations, StepTimes& times)
+{
+    Mat canvas(canvasSize, CV_8UC3, Scalar::all(0));
+    vector<Mat> captured(sources.size());
+    vector<Mat> resized(sources.size());
+
+    // slots side by side, the layout scaled to fill the canvas width, so a
+    // larger canvas also means larger resize outputs
+    int layoutWidth = 0, layoutHeight = 0;
+    for (const Source& source : sources)
+    {
+        layoutWidth += source.outputSize.width;
+        layoutHeight = max(layoutHeight, source.outputSize.height);
+    }
+    double scale = min((double)canvasSize.width / layoutWidth, (double)canvasSize.height / layoutHeight);
+
+    vector<Rect> slots;
+    int x = 0;
+    for (const Source& source : sources)
+    {
+        Size size(max(1, (int)(source.outputSize.width * scale)), max(1, (int)(source.outputSize.height * scale)));
+        slots.push_back(Rect(x, 0, size.width, size.height));
+        x += size.width;
+    }
+
+    for (int n = 0; n < iterations; n++)
+    {
+        int64 start = getTickCount();
+
+        // read: the capture driver hands out a fresh buffer every frame, so
+        // the allocation is part of the step
+        for (size_t i = 0; i < sources.size(); i++)
+            captured[i] = sources[i].frames[n % sources[i].frames.size()].clone();
+        int64 read = getTickCount();
+
+        for (size_t i = 0; i < sources.size(); i++)
+            cv::resize(captured[i], resized[i], slots[i].size(), 0, 0, INTER_AREA);
+        int64 resize = getTickCount();
+
+        for (size_t i = 0; i < sources.size(); i++)
+        {
+            Mat slot = canvas(slots[i]);
+            if (resized[i].channels() == 4)
+                cvtColor(resized[i], slot, COLOR_BGRA2BGR);
+            else
+                resized[i].copyTo(slot);
+        }
+        int64 composite = getTickCount();
+
+        times.read.push_back(elapsedMs(start, read));
+        times.resize.push_back(elapsedMs(read, resize));
+        times.composite.push_back(elapsedMs(resize, composite));
+        times.total.push_back(elapsedMs(start, composite));
+    }
+}
+
+}
+
+int runIngestBenchmark(int argc, char* argv[])
+{
+    int iterations = 100;
+    vector<int> threadCounts;
+    vector<Size> canvasSizes;
+    string replayPath;
+
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        string value = i + 1 < argc ? argv[i + 1] : "";
+        if (arg == "--iterations" && !value.empty())
+        {
+            iterations = max(1, atoi(value.c_str()));
+            i++;
+        }
+        else if (arg == "--threads" && !value.empty())
+        {
+            for (const string& count : split(value, ','))
+                threadCounts.push_back(max(1, atoi(count.c_str())));
+            i++;
+        }
+        else if (arg == "--sizes" && !value.empty())
+        {
+            for (const string& size : split(value, ','))
+            {
+                int width = 0, height = 0;
+                if (sscanf(size.c_str(), "%dx%d", &width, &height) == 2 && width > 0 && height > 0)
+                    canvasSizes.push_back(Size(width, height));
+            }
+            i++;
+        }
+        else if (arg == "--replay" && !value.empty())
+        {
+            replayPath = value;
+            i++;
+        }
+    }
+
+    if (threadCounts.empty())
+    {
+        int cores = getNumberOfCPUs();
+        for (int count = 1; count < cores; count *= 2)
+            threadCounts.push_back(count);
+        threadCounts.push_back(cores);
+    }
+    if (canvasSizes.empty())
+    {
+        canvasSizes.push_back(Size(1920, 1080));
+        canvasSizes.push_back(Size(3840, 2160));
+    }
+
+    // CPU only, the results must not depend on which OpenCL device is around
+    ocl::setUseOpenCL(false);
+
+    // the sources of the camera loop: down cam, web cam and the desktop, with
+    // their slot proportions in a 1920 wide layout
+    vector<Source> sources(3);
+    sources[0].name = "down cam 4416x3312";
+    sources[0].outputSize = Size(1000, 600);
+    sources[1].name = "web cam 1920x1080";
+    sources[1].outputSize = Size(400, 225);
+    sources[2].name = "desktop 1920x1080";
+    sources[2].outputSize = Size(520, 293);
+
+    if (!replayPath.empty() && !loadReplay(replayPath, sources[0]))
+    {
+        cout << "Cannot read frames from " << replayPath << endl;
+        return -1;
+    }
+    for (int i = 0; i < FramesPerSource; i++)
+    {
+        if (replayPath.empty())
+            sources[0].frames.push_back(syntheticFrame(Size(4416, 3312), CV_8UC3, i));
+        sources[1].frames.push_back(syntheticFrame(Size(1920, 1080), CV_8UC3, 100 + i));
+        sources[2].frames.push_back(syntheticFrame(Size(1920, 1080), CV_8UC4, 200 + i));
+    }
+    if (!replayPath.empty())
+        sources[0].name = "down cam " + replayPath;
+
+    cout << "Sources:" << endl;
+    for (const Source& source : sources)
+        cout << "  " << source.name << endl;
+
+    for (const Size& canvasSize : canvasSizes)
+    {
+        for (int threads : threadCounts)
+        {
+            setNumThreads(threads);
+
+            // warm up allocations and the thread pool
+            StepTimes warmup;
+            runConfiguration(sources, canvasSize, 5, warmup);
+
+            StepTimes times;
+            int64 start = getTickCount();
+            runConfiguration(sources, canvasSize, iterations, times);
+            double seconds = elapsedMs(start, getTickCount()) / 1000.0;
+
+            cout << endl << "canvas " << canvasSize.width << "x" << canvasSize.height
+                 << ", " << threads << " thread(s), " << iterations << " iterations: "
+                 << fixed << setprecision(1) << iterations / seconds << " fps sustained" << endl;
+            printStep("read", times.read);
+            printStep("resize", times.resize);
+            printStep("composite", times.composite);
+            printStep("total", times.total);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+// Replays in-memory frames through the read -> resize -> composite steps of the
+// camera loop in main() and prints per step latency percentiles and sustained
+// fps. Needs no cameras, display or OpenCL device.
+//
+//   ConsoleApplication1 --benchmark [--iterations N] [--threads 1,2,4]
+//                       [--sizes 1000x600,1920x1080] [--replay video_file]
+int runIngestBenchmark(int argc, char* argv[]);
@@ -0,0 +1,288 @@
+#include "pixel_convert.h"
+
+#include <QElapsedTimer>
+#include <QImage>
+#include <QString>
+#include <QStringList>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+
+// Every tail length of the widest kernel twice over, plus odd frame widths
+const int MaxShortCount = 257;
+const int FrameWidths[] = { 1, 3, 31, 33, 641, 1279, 1920, 1921, 4415 };
+
+struct Options
+{
+    int iterations = 20;
+    int width = 4416;
+    int height = 3312;
+    bool benchmark = true;
+};
+
+vector<uchar> noise(size_t size, quint32 seed)
+{
+    vector<uchar> bytes(size);
+    for (size_t i = 0; i < size; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        bytes[i] = (uchar)(seed >> 16);
+    }
+    return bytes;
+}
+
+// One conversion of count pixels from src, writes its result into dst and
+// returns the number of bytes written.
+typedef function<size_t(const uchar* src, uchar* dst, int count)> Conversion;
+
+struct Case
+{
+    const char* name;
+    int srcBytesPerPixel;
+    int rowsPerCall;
+    Conversion convert;
+};
+
+size_t planarSize(int width, int height)
+{
+    return width * height + 2 * (width / 2) * (height / 2);
+}
+
+vector<Case> cases()
+{
+    using namespace PixelConvert;
+    vector<Case> all;
+    all.push_back({ "swapRB24", 3, 1, [](const uchar* src, uchar* dst, int count) {
+        swapRB24(src, dst, count); return (size_t)count * 3; } });
+    all.push_back({ "swapRB24 in place", 3, 1, [](const uchar* src, uchar* dst, int count) {
+        memcpy(dst, src, count * 3); swapRB24(dst, dst, count); return (size_t)count * 3; } });
+    all.push_back({ "swapRB32", 4, 1, [](const uchar* src, uchar* dst, int count) {
+        swapRB32(src, dst, count); return (size_t)count * 4; } });
+    all.push_back({ "swapRB32 in place", 4, 1, [](const uchar* src, uchar* dst, int count) {
+        memcpy(dst, src, count * 4); swapRB32(dst, dst, count); return (size_t)count * 4; } });
+    all.push_back({ "expand24To32", 3, 1, [](const uchar* src, uchar* dst, int count) {
+        expand24To32(src, dst, count, false); return (size_t)count * 4; } });
+    all.push_back({ "expand24To32 swapRB", 3, 1, [](const uchar* src, uchar* dst, int count) {
+        expand24To32(src, dst, count, true); return (size_t)count * 4; } });
+    all.push_back({ "pack32To24", 4, 1, [](const uchar* src, uchar* dst, int count) {
+        pack32To24(src, dst, count, false); return (size_t)count * 3; } });
+    all.push_back({ "pack32To24 swapRB", 4, 1, [](const uchar* src, uchar* dst, int count) {
+        pack32To24(src, dst, count, true); return (size_t)count * 3; } });
+    all.push_back({ "bgraToGray", 4, 1, [](const uchar* src, uchar* dst, int count) {
+        bgraToGray(src, dst, count); return (size_t)count; } });
+    all.push_back({ "bgrToGray", 3, 1, [](const uchar* src, uchar* dst, int count) {
+        bgrToGray(src, dst, count); return (size_t)count; } });
+    // two rows of count & ~1 pixels, the planar converters need even sizes
+    all.push_back({ "bgraToI420", 4, 2, [](const uchar* src, uchar* dst, int count) {
+        int width = max(2, count & ~1);
+        uchar* u = dst + width * 2;
+        uchar* v = u + width / 2;
+        bgraToI420(src, width * 4, width, 2, dst, width, u, width / 2, v, width / 2);
+        return planarSize(width, 2); } });
+    all.push_back({ "bgraToNV12", 4, 2, [](const uchar* src, uchar* dst, int count) {
+        int width = max(2, count & ~1);
+        bgraToNV12(src, width * 4, width, 2, dst, width, dst + width * 2, width);
+        return planarSize(width, 2); } });
+    return all;
+}
+
+// Runs every case at count pixels on the active path and on scalar, with
+// the source both aligned and one byte off.
+bool matchesScalar(const QString& path, const Case& c, int count, vector<uchar>& expected, vector<uchar>& actual,
+                   const vector<uchar>& src)
+{
+    for (int offset = 0; offset < 2; offset++)
+    {
+        PixelConvert::setInstructionSet(QStringLiteral("scalar"));
+        size_t bytes = c.convert(src.data() + offset, expected.data(), count);
+        PixelConvert::setInstructionSet(path);
+        c.convert(src.data() + offset, actual.data() + offset, count);
+
+        if (memcmp(expected.data(), actual.data() + offset, bytes) != 0)
+        {
+            size_t first = 0;
+            while (expected[first] == actual[first + offset])
+                first++;
+            cout << "  " << left << setw(22) << c.name << " MISMATCH at " << count << " pixels"
+                 << (offset ? ", unaligned source" : "") << ": byte " << first
+                 << " is " << (int)actual[first + offset] << ", scalar gives " << (int)expected[first] << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool checkPath(const QString& path, const vector<Case>& all)
+{
+    const int maxCount = FrameWidths[sizeof(FrameWidths) / sizeof(FrameWidths[0]) - 1];
+    // room for the largest case: two rows of 4 byte pixels
+    const vector<uchar> src = noise(maxCount * 8 + 64, 12345);
+    vector<uchar> expected(maxCount * 8 + 64);
+    vector<uchar> actual(maxCount * 8 + 64);
+
+    vector<int> counts;
+    for (int count = 1; count <= MaxShortCount; count++)
+        counts.push_back(count);
+    for (int width : FrameWidths)
+        counts.push_back(width);
+
+    bool ok = true;
+    for (const Case& c : all)
+    {
+        bool caseOk = true;
+        for (int count : counts)
+        {
+            if (!matchesScalar(path, c, count, expected, actual, src))
+            {
+                caseOk = false;
+                break;
+            }
+        }
+        if (caseOk)
+            cout << "  " << left << setw(22) << c.name << " ok" << endl;
+        ok = ok && caseOk;
+    }
+    return ok;
+}
+
+bool checkImages(const QString& path)
+{
+    // odd sized images, stride padding must not leak into the results
+    const int width = 1921, height = 7;
+    QImage bgra(width, height, QImage::Format_RGB32);
+    vector<uchar> bytes = noise(bgra.byteCount(), 54321);
+    memcpy(bgra.bits(), bytes.data(), bytes.size());
+    for (int row = 0; row < height; row++)
+    {
+        quint32* pixels = reinterpret_cast<quint32*>(bgra.scanLine(row));
+        for (int x = 0; x < width; x++)
+            pixels[x] |= 0xff000000;
+    }
+    const int bgrStride = width * 3 + 5;
+    vector<uchar> bgr = noise(bgrStride * height, 999);
+
+    PixelConvert::setInstructionSet(QStringLiteral("scalar"));
+    QImage expectedRgb = PixelConvert::toRgb888(bgra);
+    QImage expectedFromBgr = PixelConvert::imageFromBgr(bgr.data(), width, height, bgrStride);
+    PixelConvert::setInstructionSet(path);
+
+    bool ok = true;
+    if (PixelConvert::toRgb888(bgra) != expectedRgb || expectedRgb != bgra.convertToFormat(QImage::Format_RGB888))
+    {
+        cout << "  " << left << setw(22) << "toRgb888" << " MISMATCH" << endl;
+        ok = false;
+    }
+    if (PixelConvert::imageFromBgr(bgr.data(), width, height, bgrStride) != expectedFromBgr)
+    {
+        cout << "  " << left << setw(22) << "imageFromBgr" << " MISMATCH" << endl;
+        ok = false;
+    }
+    if (ok)
+        cout << "  " << left << setw(22) << "toRgb888, imageFromBgr" << " ok" << endl;
+    return ok;
+}
+
+void benchmarkPath(const QString& path, const vector<Case>& all, const Options& options)
+{
+    PixelConvert::setInstructionSet(path);
+    const vector<uchar> src = noise((size_t)options.width * 8, 777);
+    vector<uchar> dst((size_t)options.width * 8);
+
+    for (const Case& c : all)
+    {
+        int calls = options.height / c.rowsPerCall;
+
+        c.convert(src.data(), dst.data(), options.width);
+        QElapsedTimer timer;
+        timer.start();
+        for (int n = 0; n < options.iterations; n++)
+        {
+            for (int row = 0; row < calls; row++)
+                c.convert(src.data(), dst.data(), options.width);
+        }
+        double seconds = timer.nsecsElapsed() / 1e9;
+        double bytes = (double)options.width * calls * c.rowsPerCall * c.srcBytesPerPixel * options.iterations;
+        cout << "  " << left << setw(22) << c.name << right << fixed << setprecision(0)
+             << setw(8) << bytes / seconds / 1e6 << " MB/s" << endl;
+    }
+}
+
+void usage()
+{
+    cout << "usage: pixel_convert_test [--iterations N] [--size WxH] [--no-benchmark]" << endl
+         << "  Compares every PixelConvert path this CPU can run with scalar, over" << endl
+         << "  every tail length and odd widths, then prints MB/s of source pixels" << endl
+         << "  converted per path for frames of the given size (default 4416x3312)." << endl;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc)
+        {
+            options.iterations = max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--size" && i + 1 < argc)
+        {
+            if (sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2
+                || options.width < 2 || options.height < 2)
+            {
+                usage();
+                return 2;
+            }
+        }
+        else if (arg == "--no-benchmark")
+        {
+            options.benchmark = false;
+        }
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    const vector<Case> all = cases();
+    const QStringList paths = PixelConvert::availableInstructionSets();
+    cout << "paths: " << paths.join(QStringLiteral(", ")).toStdString() << endl;
+
+    bool ok = true;
+    for (const QString& path : paths)
+    {
+        if (path == QLatin1String("scalar"))
+            continue;
+        cout << path.toStdString() << " against scalar" << endl;
+        ok = checkPath(path, all) && ok;
+        ok = checkImages(path) && ok;
+    }
+
+    if (options.benchmark)
+    {
+        for (const QString& path : paths)
+        {
+            cout << path.toStdString() << ", " << options.width << "x" << options.height
+                 << ", " << options.iterations << " frames" << endl;
+            benchmarkPath(path, all, options);
+        }
+    }
+
+    cout << (ok ? "all paths match scalar" : "FAILED: a path differs from scalar") << endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,19 @@
+# Checks every PixelConvert path against scalar and measures its throughput:
+#   pixel_convert_test [--iterations N] [--size WxH] [--no-benchmark]
+# Returns non-zero when any path gives different bytes.
+
+CONFIG   += c++11 console force_debug_info
+CONFIG   -= app_bundle
+
+QT = core gui
+
+TARGET = pixel_convert_test
+TEMPLATE = app
+DESTDIR = $$PWD/../build/pixel_convert_test
+
+INCLUDEPATH += $$PWD/../show
+
+HEADERS += ../show/pixel_convert.h
+
+SOURCES += main.cpp \
+    ../show/pixel_convert.cpp
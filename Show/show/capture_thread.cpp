@@ -0,0 +1,76 @@
+#include "capture_thread.h"
+
+#include <chrono>
+
+CaptureThread::CaptureThread(const QString& name, const GrabFunction& grab, int minIntervalMs, QObject* parent)
+    : QThread(parent)
+    , m_name(name)
+    , m_grab(grab)
+    , m_minIntervalMs(minIntervalMs)
+    , m_stop(false)
+    , m_captureFps(0)
+{
+}
+
+CaptureThread::~CaptureThread()
+{
+    stop();
+    wait();
+}
+
+void CaptureThread::stop()
+{
+    m_stop = true;
+}
+
+qint64 CaptureThread::nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void CaptureThread::run()
+{
+    quint64 sequence = 0;
+    int framesInWindow = 0;
+    qint64 windowStart = nowUs();
+
+    while (!m_stop)
+    {
+        qint64 started = nowUs();
+
+        CapturedFrame& frame = m_mailbox.writeSlot();
+        // the old levels share the slot image, dropping them lets the grab
+        // reuse its pixels instead of allocating a new frame
+        frame.pyramid = ImagePyramid();
+        if (m_grab(frame.image) && !frame.image.isNull())
+        {
+            frame.capturedAtUs = nowUs();
+            // the downscaled levels are built here so paint never resamples
+            // the full frame
+            frame.pyramid = ImagePyramid(frame.image);
+            frame.sequence = ++sequence;
+            m_mailbox.publish();
+            framesInWindow++;
+        }
+        else
+        {
+            msleep(5);
+        }
+
+        qint64 now = nowUs();
+        if (now - windowStart >= 1000000)
+        {
+            m_captureFps = framesInWindow * 1e6 / (now - windowStart);
+            framesInWindow = 0;
+            windowStart = now;
+        }
+
+        // cameras pace themselves, screen grabs would otherwise spin
+        qint64 elapsedMs = (now - started) / 1000;
+        if (m_minIntervalMs > 0 && elapsedMs < m_minIntervalMs)
+        {
+            msleep(m_minIntervalMs - elapsedMs);
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QThread>
+#include <QImage>
+#include <QString>
+
+#include <atomic>
+#include <functional>
+
+#include "frame_mailbox.h"
+#include "image_pyramid.h"
+
+struct CapturedFrame
+{
+    QImage image;
+    ImagePyramid pyramid;
+    qint64 capturedAtUs = 0;
+    quint64 sequence = 0;
+};
+
+// Runs one capture source on its own thread and keeps only the newest frame,
+// so a blocking camera read or screen grab never stalls the GUI thread.
+class CaptureThread : public QThread
+{
+public:
+    // Returns false when no frame could be read, the thread then retries.
+    typedef std::function<bool(QImage&)> GrabFunction;
+
+    CaptureThread(const QString& name, const GrabFunction& grab, int minIntervalMs = 0, QObject* parent = nullptr);
+    ~CaptureThread();
+
+    void stop();
+
+    QString name() const { return m_name; }
+
+    // GUI side, see FrameMailbox.
+    bool takeLatest() { return m_mailbox.takeLatest(); }
+    const CapturedFrame& latest() const { return m_mailbox.front(); }
+
+    double captureFps() const { return m_captureFps.load(); }
+
+    // Monotonic clock the frame timestamps are taken from.
+    static qint64 nowUs();
+
+protected:
+    void run() override;
+
+private:
+    QString m_name;
+    GrabFunction m_grab;
+    int m_minIntervalMs;
+
+    FrameMailbox<CapturedFrame> m_mailbox;
+    std::atomic<bool> m_stop;
+    std::atomic<double> m_captureFps;
+};
@@ -1,8 +1,19 @@
 #include "down_cam.h"
 #include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QElapsedTimer>
+#include <QDebug>
 
-DownCam::DownCam(const QSizeF &size) : m_size(size)
+#include <climits>
+#include <cstring>
+
+// SHOW_NO_IMAGE_PYRAMID=1 always draws the full frame, to compare the paint
+// time histograms against
+static const bool s_usePyramid = !qEnvironmentVariableIsSet("SHOW_NO_IMAGE_PYRAMID");
+
+DownCam::DownCam(const QSizeF &size) : m_size(size), m_paintCount(0)
 {
+    memset(m_paintHistogram, 0, sizeof(m_paintHistogram));
 }
 
 QRectF DownCam::boundingRect() const
@@ -12,6 +23,14 @@ QRectF DownCam::boundingRect() const
 
 void DownCam::setImage(const QImage& stream)
 {
+    // no levels, building them here would cost the GUI thread what they save
+    setImage(ImagePyramid(stream, INT_MAX));
+}
+
+void DownCam::setImage(const ImagePyramid& stream)
+{
+    if (stream.cacheKey() == m_stream.cacheKey())
+        return;
     m_stream = stream;
     update();
 }
@@ -28,8 +47,46 @@ void DownCam::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, Q
 
     QRectF rect = boundingRect();
 
-    if(!m_stream.isNull())
-        painter->drawImage(rect, m_stream);
+    if(m_stream.isNull())
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (s_usePyramid)
+    {
+        qreal lod = option->levelOfDetailFromTransform(painter->worldTransform());
+        painter->drawImage(rect, m_stream.levelFor(rect.size() * lod));
+    }
+    else
+    {
+        painter->drawImage(rect, m_stream.base());
+    }
+
+    recordPaintTime(timer.nsecsElapsed());
+}
+
+void DownCam::recordPaintTime(qint64 nsecs)
+{
+    int bucket = 0;
+    for (qint64 us = nsecs / 1000; us > 0 && bucket < PaintBuckets - 1; us >>= 1)
+        bucket++;
+    m_paintHistogram[bucket]++;
+
+    if (++m_paintCount < PaintLogInterval)
+        return;
+
+    QString buckets;
+    for (int i = 0; i < PaintBuckets; i++)
+    {
+        if (m_paintHistogram[i])
+            buckets += QString(" <%1us:%2").arg(1 << i).arg(m_paintHistogram[i]);
+    }
+    qInfo().noquote() << "DownCam" << m_size.width() << "x" << m_size.height()
+                      << (s_usePyramid ? "pyramid" : "full frame") << "paint times" << buckets;
+
+    memset(m_paintHistogram, 0, sizeof(m_paintHistogram));
+    m_paintCount = 0;
 }
 
 void DownCam::mousePressEvent(QGraphicsSceneMouseEvent* event)
@@ -4,6 +4,8 @@
 #include <QGraphicsItem>
 #include <QGraphicsSceneMouseEvent>
 
+#include "image_pyramid.h"
+
 class DownCam : public QGraphicsItem
 {
 public:
@@ -13,6 +15,7 @@ public:
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *item, QWidget *widget) Q_DECL_OVERRIDE;
 
     void setImage(const QImage& stream);
+    void setImage(const ImagePyramid& stream);
     void setSize(const QSizeF &size);
 
 protected:
@@ -21,6 +24,14 @@ protected:
     void mouseReleaseEvent(QGraphicsSceneMouseEvent* event) override;
 
 private:
+    void recordPaintTime(qint64 nsecs);
+
     QSizeF m_size;
-    QImage m_stream;
+    ImagePyramid m_stream;
+
+    // paint time in power-of-two microsecond buckets, logged every
+    // PaintLogInterval paints
+    enum { PaintBuckets = 16, PaintLogInterval = 500 };
+    int m_paintHistogram[PaintBuckets];
+    int m_paintCount;
 };
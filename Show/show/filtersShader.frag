@@ -4,17 +4,39 @@ layout(location = 0) out vec4 fragColor;
 uniform sampler2D tex;
 in vec2 fragTexCoord;
 uniform vec2 imageSize;
+uniform vec2 targetSize;
 uniform mat3 textureMatrix;
+uniform int maxTaps;
 
-void main() {
-    // Calculate texture position based on homography resolution in pixels
-    vec2 texturePixelCoord = vec2(fragTexCoord.x * imageSize.x, fragTexCoord.y * imageSize.y);
-
+vec2 sourcePixel(vec2 texturePixelCoord) {
     float determinant = textureMatrix[2][0] * texturePixelCoord.x + textureMatrix[2][1] * texturePixelCoord.y + textureMatrix[2][2];
     float texureX = (textureMatrix[0][0] * texturePixelCoord.x + textureMatrix[0][1] * texturePixelCoord.y + textureMatrix[0][2]) / determinant;
     float texureY = (textureMatrix[1][0] * texturePixelCoord.x + textureMatrix[1][1] * texturePixelCoord.y + textureMatrix[1][2]) / determinant;
+    return vec2(texureX, texureY);
+}
+
+void main() {
+    // Calculate texture position based on homography resolution in pixels,
+    // the viewport covers targetSize pixels of the corrected frame
+    vec2 texturePixelCoord = fragTexCoord * targetSize;
+    vec2 source = sourcePixel(texturePixelCoord);
+
+    // When the output is smaller than the source, one output pixel covers
+    // several texels. Average a grid of bilinear taps spread over that
+    // footprint, so every covered texel counts instead of aliasing.
+    // CPU reference: keystone_reference.cpp
+    vec2 dx = dFdx(source);
+    vec2 dy = dFdy(source);
+    int tapsX = int(clamp(ceil(length(dx)), 1.0, float(maxTaps)));
+    int tapsY = int(clamp(ceil(length(dy)), 1.0, float(maxTaps)));
 
-    vec2 texCoord = vec2(texureX / imageSize.x, texureY / imageSize.y);
+    vec4 sum = vec4(0.0);
+    for (int j = 0; j < tapsY; j++) {
+        for (int i = 0; i < tapsX; i++) {
+            vec2 offset = (vec2(i, j) + 0.5) / vec2(tapsX, tapsY) - 0.5;
+            sum += texture(tex, (source + offset.x * dx + offset.y * dy) / imageSize);
+        }
+    }
 
-    fragColor = texture(tex, texCoord);
+    fragColor = sum / float(tapsX * tapsY);
 }
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+
+// Single producer / single consumer "latest value" mailbox.
+//
+// Three slots: the producer fills its back slot and publishes it, the
+// consumer swaps the newest published slot into its front slot. Neither side
+// ever waits for the other, a slow consumer simply skips stale values.
+template <typename T>
+class FrameMailbox
+{
+public:
+    FrameMailbox() : m_state(1), m_back(2), m_front(0) {}
+
+    // Producer side.
+    T& writeSlot() { return m_slots[m_back]; }
+    void publish()
+    {
+        m_back = m_state.exchange(m_back | FreshBit) & IndexMask;
+    }
+
+    // Consumer side. Returns false when nothing new was published since the
+    // last call, front() then still holds the previous value.
+    bool takeLatest()
+    {
+        if (!(m_state.load() & FreshBit))
+            return false;
+        m_front = m_state.exchange(m_front) & IndexMask;
+        return true;
+    }
+    const T& front() const { return m_slots[m_front]; }
+
+private:
+    enum { IndexMask = 3, FreshBit = 4 };
+
+    T m_slots[3];
+    std::atomic<int> m_state;   // index of the middle slot | FreshBit
+    int m_back;                 // producer only
+    int m_front;                // consumer only
+};
@@ -0,0 +1,62 @@
+#include "image_pyramid.h"
+
+ImagePyramid::ImagePyramid(const QImage& base, int minWidth)
+{
+    if (base.isNull())
+        return;
+
+    m_levels.append(base);
+    while (m_levels.last().width() / 2 >= minWidth && m_levels.last().height() / 2 > 0)
+        m_levels.append(halve(m_levels.last()));
+}
+
+QImage ImagePyramid::levelFor(const QSizeF& target) const
+{
+    if (isNull())
+        return QImage();
+
+    for (int i = m_levels.size() - 1; i > 0; i--)
+    {
+        const QImage& level = m_levels.at(i);
+        if (level.width() >= target.width() && level.height() >= target.height())
+            return level;
+    }
+    return m_levels.first();
+}
+
+QImage ImagePyramid::halve(const QImage& image)
+{
+    QImage source = image;
+    switch (source.format())
+    {
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+    case QImage::Format_RGB888:
+    case QImage::Format_Grayscale8:
+        break;
+    default:
+        // averaging straight alpha would bleed transparent colours
+        source = source.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+        break;
+    }
+
+    const int width = source.width() / 2;
+    const int height = source.height() / 2;
+    const int bpp = source.depth() / 8;
+    QImage result(width, height, source.format());
+
+    for (int y = 0; y < height; y++)
+    {
+        const uchar* top = source.constScanLine(2 * y);
+        const uchar* bottom = source.constScanLine(2 * y + 1);
+        uchar* out = result.scanLine(y);
+
+        // every format above is 8 bits per channel, average channel by channel
+        for (int x = 0; x < width; x++, top += 2 * bpp, bottom += 2 * bpp, out += bpp)
+        {
+            for (int c = 0; c < bpp; c++)
+                out[c] = (uchar)((top[c] + top[c + bpp] + bottom[c] + bottom[c + bpp] + 2) >> 2);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QImage>
+#include <QSizeF>
+#include <QVector>
+
+// A frame together with successively halved copies of it.
+//
+// Drawing a 4200x2800 frame into a 600x340 item makes the painter resample
+// the full image on every paint. The levels are built once per frame, on the
+// capture thread, with a 2x2 box filter; paint then picks the smallest level
+// that still covers the on-screen size. Implicitly shared like QImage.
+class ImagePyramid
+{
+public:
+    ImagePyramid() {}
+    // Halves base until the next level would be narrower than minWidth.
+    explicit ImagePyramid(const QImage& base, int minWidth = 128);
+
+    bool isNull() const { return m_levels.isEmpty(); }
+    qint64 cacheKey() const { return isNull() ? 0 : m_levels.first().cacheKey(); }
+
+    int levelCount() const { return m_levels.size(); }
+    const QImage& level(int index) const { return m_levels.at(index); }
+    QImage base() const { return isNull() ? QImage() : m_levels.first(); }
+
+    // Smallest level at least as large as target, the base if none is.
+    QImage levelFor(const QSizeF& target) const;
+
+    static QImage halve(const QImage& image);
+
+private:
+    QVector<QImage> m_levels;
+};
@@ -0,0 +1,119 @@
+#include "keystone_reference.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+class RenderRows : public cv::ParallelLoopBody
+{
+public:
+    RenderRows(const cv::Mat& source, const cv::Matx33d& inverse, const cv::Point2d& scale,
+               int maxTaps, cv::Mat& output)
+        : m_source(source), m_inverse(inverse), m_scale(scale), m_maxTaps(maxTaps), m_output(output)
+    {
+    }
+
+    void operator()(const cv::Range& rows) const override
+    {
+        const int channels = m_source.channels();
+        for (int y = rows.start; y < rows.end; y++)
+        {
+            uchar* out = m_output.ptr<uchar>(y);
+            for (int x = 0; x < m_output.cols; x++, out += channels)
+            {
+                const cv::Point2d target((x + 0.5) * m_scale.x, (y + 0.5) * m_scale.y);
+                const cv::Point2d p = sourcePixel(target);
+                // like dFdx / dFdy, the step to the neighbouring output pixel
+                const cv::Point2d dx = sourcePixel(target + cv::Point2d(m_scale.x, 0)) - p;
+                const cv::Point2d dy = sourcePixel(target + cv::Point2d(0, m_scale.y)) - p;
+                const int tapsX = taps(dx);
+                const int tapsY = taps(dy);
+
+                float sum[4] = { 0, 0, 0, 0 };
+                for (int j = 0; j < tapsY; j++)
+                {
+                    for (int i = 0; i < tapsX; i++)
+                    {
+                        const double ox = (i + 0.5) / tapsX - 0.5;
+                        const double oy = (j + 0.5) / tapsY - 0.5;
+                        addBilinear(p + ox * dx + oy * dy, sum);
+                    }
+                }
+
+                const float count = (float)(tapsX * tapsY);
+                for (int c = 0; c < channels; c++)
+                    out[c] = cv::saturate_cast<uchar>(sum[c] / count);
+            }
+        }
+    }
+
+private:
+    cv::Point2d sourcePixel(const cv::Point2d& target) const
+    {
+        const cv::Matx33d& M = m_inverse;
+        const double w = M(2, 0) * target.x + M(2, 1) * target.y + M(2, 2);
+        return cv::Point2d((M(0, 0) * target.x + M(0, 1) * target.y + M(0, 2)) / w,
+                           (M(1, 0) * target.x + M(1, 1) * target.y + M(1, 2)) / w);
+    }
+
+    int taps(const cv::Point2d& step) const
+    {
+        return std::max(1, std::min(m_maxTaps, (int)std::ceil(std::sqrt(step.dot(step)))));
+    }
+
+    void addBilinear(const cv::Point2d& p, float* sum) const
+    {
+        // texel centres sit at i + 0.5
+        const double fx = p.x - 0.5;
+        const double fy = p.y - 0.5;
+        const int x0 = cvFloor(fx);
+        const int y0 = cvFloor(fy);
+        const float ax = (float)(fx - x0);
+        const float ay = (float)(fy - y0);
+
+        const int channels = m_source.channels();
+        const int left = clamp(x0, m_source.cols) * channels;
+        const int right = clamp(x0 + 1, m_source.cols) * channels;
+        const uchar* top = m_source.ptr<uchar>(clamp(y0, m_source.rows));
+        const uchar* bottom = m_source.ptr<uchar>(clamp(y0 + 1, m_source.rows));
+
+        for (int c = 0; c < channels; c++)
+        {
+            const float upper = top[left + c] + (top[right + c] - top[left + c]) * ax;
+            const float lower = bottom[left + c] + (bottom[right + c] - bottom[left + c]) * ax;
+            sum[c] += upper + (lower - upper) * ay;
+        }
+    }
+
+    static int clamp(int i, int size)
+    {
+        return std::max(0, std::min(size - 1, i));
+    }
+
+    const cv::Mat& m_source;
+    cv::Matx33d m_inverse;
+    cv::Point2d m_scale;
+    int m_maxTaps;
+    cv::Mat& m_output;
+};
+
+}
+
+void renderKeystoneReference(const cv::Mat& source, const cv::Mat& homography,
+                             const cv::Size& correctedSize, const cv::Size& outputSize,
+                             int maxTaps, cv::Mat& output)
+{
+    CV_Assert(source.depth() == CV_8U && source.channels() <= 4);
+    CV_Assert(homography.rows == 3 && homography.cols == 3);
+    CV_Assert(maxTaps >= 1);
+
+    cv::Matx33d inverse = cv::Matx33d(cv::Mat_<double>(homography)).inv();
+    cv::Point2d scale((double)correctedSize.width / outputSize.width,
+                      (double)correctedSize.height / outputSize.height);
+
+    output.create(outputSize, source.type());
+    cv::parallel_for_(cv::Range(0, outputSize.height),
+                      RenderRows(source, inverse, scale, maxTaps, output));
+}
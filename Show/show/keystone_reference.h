@@ -0,0 +1,25 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+// CPU version of the single pass display warp in VideoWidget
+// (filtersShader.frag), for headless comparisons: against the GPU output for
+// accuracy, against KeystoneWarp plus cv::resize(INTER_AREA) for quality
+// and speed. Slow, every tap is computed in floating point.
+//
+// Each output pixel is mapped through the inverse homography into the
+// source. When the output is smaller than the source, the bilinear taps of
+// a grid over the pixel's source footprint are averaged, up to maxTaps per
+// axis.
+//
+// Coordinates follow the shader: output pixel (x, y) is gl_FragCoord
+// (x + 0.5, y + 0.5), so row 0 is the first row glReadPixels returns, and
+// texel i covers source coordinates [i, i + 1). Outside the source the edge
+// texels are repeated. GPUs filter with a few bits of sub-texel precision,
+// expect differences of a level or two.
+//
+// homography maps source to corrected pixels, like warpPerspective().
+// source is 8-bit with up to 4 channels.
+void renderKeystoneReference(const cv::Mat& source, const cv::Mat& homography,
+                             const cv::Size& correctedSize, const cv::Size& outputSize,
+                             int maxTaps, cv::Mat& output);
@@ -0,0 +1,81 @@
+#include "keystone_warp.h"
+
+#include <algorithm>
+#include <climits>
+#include <opencv2/imgproc.hpp>
+
+namespace
+{
+
+// Fills rows of the fixed-point table, same rounding as warpPerspective().
+class BuildRemapTable : public cv::ParallelLoopBody
+{
+public:
+    BuildRemapTable(const double* inverse, cv::Mat& map, cv::Mat& mapFraction)
+        : m_inverse(inverse), m_map(map), m_mapFraction(mapFraction)
+    {
+    }
+
+    void operator()(const cv::Range& rows) const override
+    {
+        const double* M = m_inverse;
+        for (int y = rows.start; y < rows.end; y++)
+        {
+            short* xy = m_map.ptr<short>(y);
+            ushort* alpha = m_mapFraction.ptr<ushort>(y);
+
+            double X0 = M[1] * y + M[2];
+            double Y0 = M[4] * y + M[5];
+            double W0 = M[7] * y + M[8];
+            for (int x = 0; x < m_map.cols; x++)
+            {
+                double W = W0 + M[6] * x;
+                W = W ? cv::INTER_TAB_SIZE / W : 0;
+                double fX = std::max((double)INT_MIN, std::min((double)INT_MAX, (X0 + M[0] * x) * W));
+                double fY = std::max((double)INT_MIN, std::min((double)INT_MAX, (Y0 + M[3] * x) * W));
+                int X = cv::saturate_cast<int>(fX);
+                int Y = cv::saturate_cast<int>(fY);
+
+                xy[x * 2] = cv::saturate_cast<short>(X >> cv::INTER_BITS);
+                xy[x * 2 + 1] = cv::saturate_cast<short>(Y >> cv::INTER_BITS);
+                alpha[x] = (ushort)((Y & (cv::INTER_TAB_SIZE - 1)) * cv::INTER_TAB_SIZE +
+                                    (X & (cv::INTER_TAB_SIZE - 1)));
+            }
+        }
+    }
+
+private:
+    const double* m_inverse;
+    cv::Mat& m_map;
+    cv::Mat& m_mapFraction;
+};
+
+}
+
+KeystoneWarp::KeystoneWarp()
+{
+}
+
+void KeystoneWarp::setHomography(const cv::Mat& matrix, const cv::Size& correctedSize, double outputScale)
+{
+    CV_Assert(matrix.rows == 3 && matrix.cols == 3);
+    CV_Assert(outputScale > 0 && outputScale <= 1);
+
+    cv::Size size(cvRound(correctedSize.width * outputScale), cvRound(correctedSize.height * outputScale));
+
+    // destination -> source, with the output scale folded in
+    cv::Mat scale = (cv::Mat_<double>(3, 3) << outputScale, 0, 0, 0, outputScale, 0, 0, 0, 1);
+    cv::Mat inverse;
+    cv::invert(scale * cv::Mat_<double>(matrix), inverse);
+
+    m_map.create(size, CV_16SC2);
+    m_mapFraction.create(size, CV_16UC1);
+    cv::parallel_for_(cv::Range(0, size.height),
+                      BuildRemapTable(inverse.ptr<double>(), m_map, m_mapFraction));
+}
+
+void KeystoneWarp::apply(const cv::Mat& src, cv::Mat& dst) const
+{
+    CV_Assert(isValid());
+    cv::remap(src, dst, m_map, m_mapFraction, cv::INTER_LINEAR, cv::BORDER_CONSTANT);
+}
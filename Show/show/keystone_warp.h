@@ -0,0 +1,32 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+// Keystone correction with a remap table that is built once per homography.
+//
+// warpPerspective() projects every destination pixel through the matrix on
+// each call, although the matrix only changes when the keystone is
+// recalibrated. KeystoneWarp does that projection once and keeps the result
+// in OpenCV's fixed-point layout (CV_16SC2 integer coordinates plus CV_16UC1
+// interpolation table indices), so every frame is a plain cv::remap: bilinear,
+// vectorized and split across cv::getNumThreads() workers. Runs on the CPU
+// only and needs no GL context.
+class KeystoneWarp
+{
+public:
+    KeystoneWarp();
+
+    // matrix maps source to destination pixels, like warpPerspective().
+    // outputScale < 1 builds a table for a proportionally smaller output
+    // that still covers the whole corrected area.
+    void setHomography(const cv::Mat& matrix, const cv::Size& correctedSize, double outputScale = 1.0);
+
+    bool isValid() const { return !m_map.empty(); }
+    cv::Size outputSize() const { return m_map.size(); }
+
+    void apply(const cv::Mat& src, cv::Mat& dst) const;
+
+private:
+    cv::Mat m_map;
+    cv::Mat m_mapFraction;
+};
@@ -1,9 +1,16 @@
 #include "mainwindow.h"
+#include "show_benchmark.h"
 
 #include <QApplication>
+#include <cstring>
 
 int main(int argc, char *argv[])
 {
+    if (argc > 1 && strcmp(argv[1], "--benchmark") == 0)
+    {
+        return runShowBenchmark(argc, argv);
+    }
+
     QApplication app(argc, argv);
     app.setAttribute(Qt::AA_DontCreateNativeWidgetSiblings);
 
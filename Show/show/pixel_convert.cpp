@@ -0,0 +1,569 @@
+#include "pixel_convert.h"
+
+#include <QByteArray>
+#include <QDebug>
+#include <atomic>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PIXEL_CONVERT_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PIXEL_CONVERT_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(PIXEL_CONVERT_X86) && !defined(_MSC_VER)
+// gcc and clang only emit these instructions in functions built for them
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSSE3
+#define TARGET_AVX2
+#endif
+
+namespace
+{
+
+// Fixed point luma of one B,G,R,A pixel:
+// ((b * B + g * G + r * R + round) >> shift) + offset
+struct LumaWeights
+{
+    int b, g, r;
+    int round;
+    int shift;
+    int offset;
+};
+
+// cv::cvtColor's BGR2GRAY weights 0.114, 0.587, 0.299 in 14 bits
+const LumaWeights GrayWeights = { 1868, 9617, 4899, 1 << 13, 14, 0 };
+// BT.601 studio range Y
+const LumaWeights YWeights = { 25, 129, 66, 128, 8, 16 };
+
+typedef void (*RowFunction)(const uchar* src, uchar* dst, int count);
+typedef void (*RowSwapFunction)(const uchar* src, uchar* dst, int count, bool swapRB);
+typedef void (*LumaFunction)(const uchar* src, uchar* dst, int count, const LumaWeights& weights);
+
+struct Kernels
+{
+    const char* name;
+    RowFunction swapRB24;
+    RowFunction swapRB32;
+    RowSwapFunction expand24To32;
+    RowSwapFunction pack32To24;
+    LumaFunction lumaRow;
+};
+
+// Scalar kernels, the reference for every other path
+
+void swapRB24Scalar(const uchar* src, uchar* dst, int count)
+{
+    for (int i = 0; i < count; i++, src += 3, dst += 3)
+    {
+        const uchar c0 = src[0];
+        const uchar c2 = src[2];
+        dst[0] = c2;
+        dst[1] = src[1];
+        dst[2] = c0;
+    }
+}
+
+void swapRB32Scalar(const uchar* src, uchar* dst, int count)
+{
+    for (int i = 0; i < count; i++, src += 4, dst += 4)
+    {
+        const uchar c0 = src[0];
+        const uchar c2 = src[2];
+        dst[0] = c2;
+        dst[1] = src[1];
+        dst[2] = c0;
+        dst[3] = src[3];
+    }
+}
+
+void expand24To32Scalar(const uchar* src, uchar* dst, int count, bool swapRB)
+{
+    const int first = swapRB ? 2 : 0;
+    const int last = 2 - first;
+    for (int i = 0; i < count; i++, src += 3, dst += 4)
+    {
+        dst[0] = src[first];
+        dst[1] = src[1];
+        dst[2] = src[last];
+        dst[3] = 255;
+    }
+}
+
+void pack32To24Scalar(const uchar* src, uchar* dst, int count, bool swapRB)
+{
+    const int first = swapRB ? 2 : 0;
+    const int last = 2 - first;
+    for (int i = 0; i < count; i++, src += 4, dst += 3)
+    {
+        dst[0] = src[first];
+        dst[1] = src[1];
+        dst[2] = src[last];
+    }
+}
+
+void lumaRowScalar(const uchar* src, uchar* dst, int count, const LumaWeights& w)
+{
+    for (int i = 0; i < count; i++, src += 4)
+        dst[i] = (uchar)(((src[0] * w.b + src[1] * w.g + src[2] * w.r + w.round) >> w.shift) + w.offset);
+}
+
+#ifdef PIXEL_CONVERT_X86
+
+// Every x86 kernel below loads and stores whole 16 or 32 byte blocks and
+// leaves the last few pixels of a row to the scalar kernel, so it never
+// touches memory past the row.
+
+TARGET_SSSE3 void swapRB24Sse(const uchar* src, uchar* dst, int count)
+{
+    // 5 pixels per block. The 16th byte is stored back unchanged and then
+    // rewritten by the next block, so in place works as well.
+    const __m128i mask = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+    int i = 0;
+    for (; i + 6 <= count; i += 5)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i * 3));
+        _mm_storeu_si128((__m128i*)(dst + i * 3), _mm_shuffle_epi8(v, mask));
+    }
+    swapRB24Scalar(src + i * 3, dst + i * 3, count - i);
+}
+
+TARGET_SSSE3 void swapRB32Sse(const uchar* src, uchar* dst, int count)
+{
+    const __m128i mask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_shuffle_epi8(v, mask));
+    }
+    swapRB32Scalar(src + i * 4, dst + i * 4, count - i);
+}
+
+TARGET_SSSE3 void expand24To32Sse(const uchar* src, uchar* dst, int count, bool swapRB)
+{
+    // 4 pixels out of each 16 byte load
+    const __m128i mask = swapRB
+        ? _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1)
+        : _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+    int i = 0;
+    for (; i + 6 <= count; i += 4)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i * 3));
+        _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_or_si128(_mm_shuffle_epi8(v, mask), alpha));
+    }
+    expand24To32Scalar(src + i * 3, dst + i * 4, count - i, swapRB);
+}
+
+TARGET_SSSE3 void pack32To24Sse(const uchar* src, uchar* dst, int count, bool swapRB)
+{
+    // 12 bytes out of each block, the 4 zero bytes after them are
+    // overwritten by the next block
+    const __m128i mask = swapRB
+        ? _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1)
+        : _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    int i = 0;
+    for (; i + 6 <= count; i += 4)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        _mm_storeu_si128((__m128i*)(dst + i * 3), _mm_shuffle_epi8(v, mask));
+    }
+    pack32To24Scalar(src + i * 4, dst + i * 3, count - i, swapRB);
+}
+
+TARGET_SSSE3 void lumaRowSse(const uchar* src, uchar* dst, int count, const LumaWeights& w)
+{
+    const __m128i weights = _mm_setr_epi16(w.b, w.g, w.r, 0, w.b, w.g, w.r, 0);
+    const __m128i round = _mm_set1_epi32(w.round);
+    const __m128i shift = _mm_cvtsi32_si128(w.shift);
+    const __m128i offset = _mm_set1_epi16(w.offset);
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i sums[4];
+        for (int k = 0; k < 4; k++)
+        {
+            // madd gives B*b + G*g and R*r + A*0 per pixel, hadd adds the pairs
+            __m128i v = _mm_loadu_si128((const __m128i*)(src + (i + 4 * k) * 4));
+            __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(v, zero), weights);
+            __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(v, zero), weights);
+            sums[k] = _mm_sra_epi32(_mm_add_epi32(_mm_hadd_epi32(lo, hi), round), shift);
+        }
+        __m128i y0 = _mm_add_epi16(_mm_packs_epi32(sums[0], sums[1]), offset);
+        __m128i y1 = _mm_add_epi16(_mm_packs_epi32(sums[2], sums[3]), offset);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(y0, y1));
+    }
+    lumaRowScalar(src + i * 4, dst + i, count - i, w);
+}
+
+TARGET_AVX2 void swapRB32Avx2(const uchar* src, uchar* dst, int count)
+{
+    const __m256i mask = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                                          2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(src + i * 4));
+        _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_shuffle_epi8(v, mask));
+    }
+    swapRB32Scalar(src + i * 4, dst + i * 4, count - i);
+}
+
+TARGET_AVX2 void lumaRowAvx2(const uchar* src, uchar* dst, int count, const LumaWeights& w)
+{
+    const __m256i weights = _mm256_setr_epi16(w.b, w.g, w.r, 0, w.b, w.g, w.r, 0,
+                                              w.b, w.g, w.r, 0, w.b, w.g, w.r, 0);
+    const __m256i round = _mm256_set1_epi32(w.round);
+    const __m128i shift = _mm_cvtsi32_si128(w.shift);
+    const __m256i offset = _mm256_set1_epi16(w.offset);
+    const __m256i zero = _mm256_setzero_si256();
+    // the packs work per 128 bit lane and leave groups of 4 pixels in the
+    // order 0 2 4 6 1 3 5 7, this puts them back
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    int i = 0;
+    for (; i + 32 <= count; i += 32)
+    {
+        __m256i sums[4];
+        for (int k = 0; k < 4; k++)
+        {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(src + (i + 8 * k) * 4));
+            __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi8(v, zero), weights);
+            __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi8(v, zero), weights);
+            sums[k] = _mm256_sra_epi32(_mm256_add_epi32(_mm256_hadd_epi32(lo, hi), round), shift);
+        }
+        __m256i y0 = _mm256_add_epi16(_mm256_packs_epi32(sums[0], sums[1]), offset);
+        __m256i y1 = _mm256_add_epi16(_mm256_packs_epi32(sums[2], sums[3]), offset);
+        __m256i y = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(y0, y1), order);
+        _mm256_storeu_si256((__m256i*)(dst + i), y);
+    }
+    lumaRowScalar(src + i * 4, dst + i, count - i, w);
+}
+
+bool cpuHasSsse3()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("ssse3");
+#endif
+}
+
+bool cpuHasAvx2()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    // the OS must save the ymm registers as well
+    const bool osSavesAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28))
+        && (_xgetbv(0) & 6) == 6;
+    if (!osSavesAvx)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // PIXEL_CONVERT_X86
+
+#ifdef PIXEL_CONVERT_NEON
+
+// vld3/vld4 split the channels into registers, so every kernel is a
+// register swap between a load and a store
+
+void swapRB24Neon(const uchar* src, uchar* dst, int count)
+{
+    int i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        uint8x16x3_t v = vld3q_u8(src + i * 3);
+        uint8x16_t c0 = v.val[0];
+        v.val[0] = v.val[2];
+        v.val[2] = c0;
+        vst3q_u8(dst + i * 3, v);
+    }
+    swapRB24Scalar(src + i * 3, dst + i * 3, count - i);
+}
+
+void swapRB32Neon(const uchar* src, uchar* dst, int count)
+{
+    int i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        uint8x16x4_t v = vld4q_u8(src + i * 4);
+        uint8x16_t c0 = v.val[0];
+        v.val[0] = v.val[2];
+        v.val[2] = c0;
+        vst4q_u8(dst + i * 4, v);
+    }
+    swapRB32Scalar(src + i * 4, dst + i * 4, count - i);
+}
+
+void expand24To32Neon(const uchar* src, uchar* dst, int count, bool swapRB)
+{
+    int i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        uint8x16x3_t v = vld3q_u8(src + i * 3);
+        uint8x16x4_t out;
+        out.val[0] = swapRB ? v.val[2] : v.val[0];
+        out.val[1] = v.val[1];
+        out.val[2] = swapRB ? v.val[0] : v.val[2];
+        out.val[3] = vdupq_n_u8(255);
+        vst4q_u8(dst + i * 4, out);
+    }
+    expand24To32Scalar(src + i * 3, dst + i * 4, count - i, swapRB);
+}
+
+void pack32To24Neon(const uchar* src, uchar* dst, int count, bool swapRB)
+{
+    int i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        uint8x16x4_t v = vld4q_u8(src + i * 4);
+        uint8x16x3_t out;
+        out.val[0] = swapRB ? v.val[2] : v.val[0];
+        out.val[1] = v.val[1];
+        out.val[2] = swapRB ? v.val[0] : v.val[2];
+        vst3q_u8(dst + i * 3, out);
+    }
+    pack32To24Scalar(src + i * 4, dst + i * 3, count - i, swapRB);
+}
+
+void lumaRowNeon(const uchar* src, uchar* dst, int count, const LumaWeights& w)
+{
+    const uint32x4_t round = vdupq_n_u32(w.round);
+    const int32x4_t shift = vdupq_n_s32(-w.shift);
+    const uint16x8_t offset = vdupq_n_u16(w.offset);
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        uint8x8x4_t v = vld4_u8(src + i * 4);
+        uint16x8_t b = vmovl_u8(v.val[0]);
+        uint16x8_t g = vmovl_u8(v.val[1]);
+        uint16x8_t r = vmovl_u8(v.val[2]);
+
+        uint32x4_t lo = vmull_n_u16(vget_low_u16(b), (uint16_t)w.b);
+        lo = vmlal_n_u16(lo, vget_low_u16(g), (uint16_t)w.g);
+        lo = vmlal_n_u16(lo, vget_low_u16(r), (uint16_t)w.r);
+        uint32x4_t hi = vmull_n_u16(vget_high_u16(b), (uint16_t)w.b);
+        hi = vmlal_n_u16(hi, vget_high_u16(g), (uint16_t)w.g);
+        hi = vmlal_n_u16(hi, vget_high_u16(r), (uint16_t)w.r);
+
+        lo = vshlq_u32(vaddq_u32(lo, round), shift);
+        hi = vshlq_u32(vaddq_u32(hi, round), shift);
+        uint16x8_t y = vaddq_u16(vcombine_u16(vmovn_u32(lo), vmovn_u32(hi)), offset);
+        vst1_u8(dst + i, vqmovn_u16(y));
+    }
+    lumaRowScalar(src + i * 4, dst + i, count - i, w);
+}
+
+#endif // PIXEL_CONVERT_NEON
+
+const Kernels ScalarKernels = { "scalar", swapRB24Scalar, swapRB32Scalar, expand24To32Scalar, pack32To24Scalar, lumaRowScalar };
+#ifdef PIXEL_CONVERT_X86
+const Kernels SseKernels = { "sse", swapRB24Sse, swapRB32Sse, expand24To32Sse, pack32To24Sse, lumaRowSse };
+// 3 byte pixels do not split evenly over 128 bit lanes, those stay on SSSE3
+const Kernels Avx2Kernels = { "avx2", swapRB24Sse, swapRB32Avx2, expand24To32Sse, pack32To24Sse, lumaRowAvx2 };
+#endif
+#ifdef PIXEL_CONVERT_NEON
+const Kernels NeonKernels = { "neon", swapRB24Neon, swapRB32Neon, expand24To32Neon, pack32To24Neon, lumaRowNeon };
+#endif
+
+// Every kernel set this build and CPU can run, scalar first
+std::vector<const Kernels*> availableKernels()
+{
+    std::vector<const Kernels*> available(1, &ScalarKernels);
+#ifdef PIXEL_CONVERT_X86
+    if (cpuHasSsse3())
+        available.push_back(&SseKernels);
+    if (cpuHasAvx2())
+        available.push_back(&Avx2Kernels);
+#endif
+#ifdef PIXEL_CONVERT_NEON
+    available.push_back(&NeonKernels);
+#endif
+    return available;
+}
+
+const Kernels& selectKernels()
+{
+    const QByteArray forced = qgetenv("SHOW_PIXEL_CONVERT");
+    const Kernels* selected = &ScalarKernels;
+
+#ifdef PIXEL_CONVERT_X86
+    if (forced != "scalar")
+    {
+        if (forced != "sse" && cpuHasAvx2())
+            selected = &Avx2Kernels;
+        else if (cpuHasSsse3())
+            selected = &SseKernels;
+    }
+#endif
+#ifdef PIXEL_CONVERT_NEON
+    if (forced != "scalar")
+        selected = &NeonKernels;
+#endif
+
+    qDebug() << "PixelConvert: using" << selected->name << "kernels";
+    return *selected;
+}
+
+std::atomic<const Kernels*>& activeKernels()
+{
+    static std::atomic<const Kernels*> active(&selectKernels());
+    return active;
+}
+
+const Kernels& kernels()
+{
+    return *activeKernels().load(std::memory_order_relaxed);
+}
+
+// U and V of one 2x2 block of B,G,R,A pixels
+inline void blockChroma(const uchar* top, const uchar* bottom, uchar& u, uchar& v)
+{
+    const int b = (top[0] + top[4] + bottom[0] + bottom[4] + 2) >> 2;
+    const int g = (top[1] + top[5] + bottom[1] + bottom[5] + 2) >> 2;
+    const int r = (top[2] + top[6] + bottom[2] + bottom[6] + 2) >> 2;
+    u = (uchar)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+    v = (uchar)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+}
+
+namespace PixelConvert
+{
+
+void swapRB24(const uchar* src, uchar* dst, int count)
+{
+    kernels().swapRB24(src, dst, count);
+}
+
+void swapRB32(const uchar* src, uchar* dst, int count)
+{
+    kernels().swapRB32(src, dst, count);
+}
+
+void expand24To32(const uchar* src, uchar* dst, int count, bool swapRB)
+{
+    kernels().expand24To32(src, dst, count, swapRB);
+}
+
+void pack32To24(const uchar* src, uchar* dst, int count, bool swapRB)
+{
+    kernels().pack32To24(src, dst, count, swapRB);
+}
+
+void bgraToGray(const uchar* src, uchar* dst, int count)
+{
+    kernels().lumaRow(src, dst, count, GrayWeights);
+}
+
+void bgrToGray(const uchar* src, uchar* dst, int count)
+{
+    const LumaWeights& w = GrayWeights;
+    for (int i = 0; i < count; i++, src += 3)
+        dst[i] = (uchar)((src[0] * w.b + src[1] * w.g + src[2] * w.r + w.round) >> w.shift);
+}
+
+void bgraToI420(const uchar* src, int srcStride, int width, int height,
+                uchar* y, int yStride, uchar* u, int uStride, uchar* v, int vStride)
+{
+    const Kernels& k = kernels();
+    for (int row = 0; row + 1 < height; row += 2)
+    {
+        const uchar* top = src + row * srcStride;
+        const uchar* bottom = top + srcStride;
+        k.lumaRow(top, y + row * yStride, width, YWeights);
+        k.lumaRow(bottom, y + (row + 1) * yStride, width, YWeights);
+
+        uchar* uRow = u + (row / 2) * uStride;
+        uchar* vRow = v + (row / 2) * vStride;
+        for (int x = 0; x < width / 2; x++)
+            blockChroma(top + x * 8, bottom + x * 8, uRow[x], vRow[x]);
+    }
+}
+
+void bgraToNV12(const uchar* src, int srcStride, int width, int height,
+                uchar* y, int yStride, uchar* uv, int uvStride)
+{
+    const Kernels& k = kernels();
+    for (int row = 0; row + 1 < height; row += 2)
+    {
+        const uchar* top = src + row * srcStride;
+        const uchar* bottom = top + srcStride;
+        k.lumaRow(top, y + row * yStride, width, YWeights);
+        k.lumaRow(bottom, y + (row + 1) * yStride, width, YWeights);
+
+        uchar* uvRow = uv + (row / 2) * uvStride;
+        for (int x = 0; x < width / 2; x++)
+            blockChroma(top + x * 8, bottom + x * 8, uvRow[2 * x], uvRow[2 * x + 1]);
+    }
+}
+
+QImage imageFromBgr(const uchar* data, int width, int height, int stride)
+{
+    QImage image(width, height, QImage::Format_RGB888);
+    const Kernels& k = kernels();
+    for (int row = 0; row < height; row++)
+        k.swapRB24(data + row * stride, image.scanLine(row), width);
+    return image;
+}
+
+QImage toRgb888(const QImage& image)
+{
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    if (image.format() == QImage::Format_RGB32 || image.format() == QImage::Format_ARGB32)
+    {
+        QImage result(image.size(), QImage::Format_RGB888);
+        const Kernels& k = kernels();
+        for (int row = 0; row < image.height(); row++)
+            k.pack32To24(image.constScanLine(row), result.scanLine(row), image.width(), true);
+        return result;
+    }
+#endif
+    return image.convertToFormat(QImage::Format_RGB888);
+}
+
+const char* instructionSet()
+{
+    return kernels().name;
+}
+
+QStringList availableInstructionSets()
+{
+    QStringList names;
+    for (const Kernels* k : availableKernels())
+        names << QString::fromLatin1(k->name);
+    return names;
+}
+
+bool setInstructionSet(const QString& name)
+{
+    for (const Kernels* k : availableKernels())
+    {
+        if (name == QLatin1String(k->name))
+        {
+            activeKernels().store(k);
+            return true;
+        }
+    }
+    return false;
+}
+
+}
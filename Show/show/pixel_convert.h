@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QImage>
+#include <QStringList>
+
+// Colour order and pixel format conversions for whole rows of 8-bit pixels.
+//
+// Every kernel has a scalar version plus SSSE3/AVX2 (x86, picked at runtime
+// from the CPU) or NEON (ARM) versions where they pay off. All versions use
+// the same integer math and give the same bytes. SHOW_PIXEL_CONVERT=scalar,
+// sse or avx2 in the environment forces a path, for comparisons.
+//
+// Counts are in pixels. "32 bit" is B,G,R,A in memory, which is how
+// QImage::Format_ARGB32 / RGB32 lie on little endian machines.
+namespace PixelConvert
+{
+    // BGR <-> RGB and BGRA <-> RGBA, src and dst may be the same row.
+    void swapRB24(const uchar* src, uchar* dst, int count);
+    void swapRB32(const uchar* src, uchar* dst, int count);
+
+    // 3 -> 4 bytes with alpha 255 and back, swapRB also swaps R and B.
+    void expand24To32(const uchar* src, uchar* dst, int count, bool swapRB);
+    void pack32To24(const uchar* src, uchar* dst, int count, bool swapRB);
+
+    // Y = 0.299 R + 0.587 G + 0.114 B, same weights and rounding as cv::cvtColor.
+    void bgraToGray(const uchar* src, uchar* dst, int count);
+    void bgrToGray(const uchar* src, uchar* dst, int count);
+
+    // BT.601 studio range 4:2:0, chroma is the average of each 2x2 block.
+    // width and height must be even.
+    void bgraToI420(const uchar* src, int srcStride, int width, int height,
+                    uchar* y, int yStride, uchar* u, int uStride, uchar* v, int vStride);
+    void bgraToNV12(const uchar* src, int srcStride, int width, int height,
+                    uchar* y, int yStride, uchar* uv, int uvStride);
+
+    // Format_RGB888 copy of BGR rows, e.g. a CV_8UC3 cv::Mat.
+    QImage imageFromBgr(const uchar* data, int width, int height, int stride);
+
+    // Like image.convertToFormat(QImage::Format_RGB888). RGB32 and ARGB32
+    // go through pack32To24 and drop alpha, anything else through Qt.
+    QImage toRgb888(const QImage& image);
+
+    // "scalar", "sse", "avx2" or "neon"
+    const char* instructionSet();
+
+    // The paths this build and CPU can run, "scalar" first. Switching is
+    // for tests and benchmarks, it must not race with running conversions.
+    // pixel_convert_test checks every path against scalar.
+    QStringList availableInstructionSets();
+    bool setInstructionSet(const QString& name);
+}
@@ -15,6 +15,7 @@
 #include "ui_presentation_mainwindow.h"
 #include "video_widget.h"
 #include "down_cam.h"
+#include "pixel_convert.h"
 
 /*
 QGraphicsEllipseItem  提供一个椭圆item
@@ -32,6 +33,8 @@ const QString PRESENT = "present";
 
 QStringList PresentMainWindow::m_matHardwareIds = { "HWP4239" };
 QStringList PresentMainWindow::m_monitorHardwareIds = { "HWP4627", "HWP425D" };
+// the down cam item is only 1920 wide, half of the corrected size is plenty
+double PresentMainWindow::m_downCamOutputScale = 0.5;
 
 static QHash<ScreenType, QString> ScreenTypeTranslationTable{
     { ScreenType::MonitorScreen, MONITOR },
@@ -57,6 +60,42 @@ PresentMainWindow::PresentMainWindow(QWidget *parent)
 
     m_scene = new QGraphicsScene; 
 
+    double coefficients[3][3] = { 1 };
+    QTransform invertedHomography = QTransform(
+        0.99800744125081942,
+        -0.12494066354552548,
+        -58.492698385016908,
+        0.0031995645556478947,
+        0.96248397740829172,
+        -333.29982033723468,
+        2.3323995676436789e-07,
+        -5.8578188344702079e-05,
+        1);
+
+    invertedHomography = invertedHomography.inverted();
+    coefficients[0][0] = invertedHomography.m11();
+    coefficients[0][1] = invertedHomography.m12();
+    coefficients[0][2] = invertedHomography.m13();
+    coefficients[1][0] = invertedHomography.m21();
+    coefficients[1][1] = invertedHomography.m22();
+    coefficients[1][2] = invertedHomography.m23();
+    coefficients[2][0] = invertedHomography.m31();
+    coefficients[2][1] = invertedHomography.m32();
+    coefficients[2][2] = invertedHomography.m33();
+
+    m_keyStone_matrix = cv::Mat(3, 3, CV_64F, coefficients).inv();
+    m_correctedSize = cv::Size(4200, 2800);
+
+    m_keystoneWarp.setHomography(m_keyStone_matrix, m_correctedSize, m_downCamOutputScale);
+
+    // capture runs on one thread per source, the GUI only swaps in the
+    // newest frames, see presentFrames()
+    m_metricsWindowStartUs = CaptureThread::nowUs();
+    m_presentTimer = new QTimer(this);
+    m_presentTimer->setInterval(16);
+    connect(m_presentTimer, &QTimer::timeout, this, &PresentMainWindow::presentFrames);
+    m_presentTimer->start();
+
     m_downCam.open(CV_CAP_DSHOW + 0);
     if (!m_downCam.isOpened() )
     {
@@ -67,6 +106,14 @@ PresentMainWindow::PresentMainWindow(QWidget *parent)
     m_downCam_item = new DownCam(QSize(1920,1080));
     m_downCam_item->setPos(0, 0);
     m_scene->addItem(m_downCam_item);
+    addCaptureSource("down cam", [this](QImage& image) {
+        if (!m_downCam.read(m_frame_downCam) || m_frame_downCam.empty())
+            return false;
+        cv::Mat frame_keyStone_downCam;
+        m_keystoneWarp.apply(m_frame_downCam, frame_keyStone_downCam);
+        image = cvMatToQImage(frame_keyStone_downCam);
+        return true;
+    }, 0, m_downCam_item, &m_image_downCam);
 
     m_webCam.open(CV_CAP_DSHOW + 1);
     if (!m_webCam.isOpened())
@@ -76,6 +123,12 @@ PresentMainWindow::PresentMainWindow(QWidget *parent)
     m_webCam_item = new DownCam(QSize(600, 340));
     m_webCam_item->setPos(1000, 600);
     m_scene->addItem(m_webCam_item);
+    addCaptureSource("web cam", [this](QImage& image) {
+        if (!m_webCam.read(m_frame_webCam) || m_frame_webCam.empty())
+            return false;
+        image = cvMatToQImage(m_frame_webCam);
+        return true;
+    }, 0, m_webCam_item, &m_image_webCam);
 
     m_mat_item = new DownCam(QSize(600, 340));
     m_mat_item->setPos(200, 100);
@@ -90,71 +143,105 @@ PresentMainWindow::PresentMainWindow(QWidget *parent)
     m_matScreen = findScreen(MatScreen);
     m_monitorScreen = findScreen(MonitorScreen);
 
-    double coefficients[3][3] = { 1 };
-    QTransform invertedHomography = QTransform(
-        0.99800744125081942,
-        -0.12494066354552548,
-        -58.492698385016908,
-        0.0031995645556478947,
-        0.96248397740829172,
-        -333.29982033723468,
-        2.3323995676436789e-07,
-        -5.8578188344702079e-05,
-        1);
-
-    invertedHomography = invertedHomography.inverted();
-    coefficients[0][0] = invertedHomography.m11();
-    coefficients[0][1] = invertedHomography.m12();
-    coefficients[0][2] = invertedHomography.m13();
-    coefficients[1][0] = invertedHomography.m21();
-    coefficients[1][1] = invertedHomography.m22();
-    coefficients[1][2] = invertedHomography.m23();
-    coefficients[2][0] = invertedHomography.m31();
-    coefficients[2][1] = invertedHomography.m32();
-    coefficients[2][2] = invertedHomography.m33();
-
-    m_keyStone_matrix = cv::Mat(3, 3, CV_64F, coefficients).inv();
-    m_correctedSize = cv::Size(4200, 2800);
+    if (m_matScreen)
+    {
+        addScreenCaptureSource("mat screen", m_matScreen->geometry(), m_mat_item, &m_image_mat);
+    }
+    if (m_monitorScreen)
+    {
+        addScreenCaptureSource("monitor screen", m_monitorScreen->geometry(), m_monitor_item, &m_image_monitor);
+    }
 }
 
 PresentMainWindow::~PresentMainWindow()
 {
+    // the capture threads still use the cameras
+    foreach(const CaptureSource& source, m_captureSources)
+    {
+        delete source.thread;
+    }
     m_downCam.release();
     delete ui;
 }
 
-void PresentMainWindow::paintEvent(QPaintEvent *event)
+void PresentMainWindow::addCaptureSource(const QString& name, const CaptureThread::GrabFunction& grab,
+                                         int minIntervalMs, DownCam* item, ImagePyramid* image)
 {
-    if (!m_downCam.isOpened() )
-        return;
+    CaptureSource source;
+    source.thread = new CaptureThread(name, grab, minIntervalMs);
+    source.item = item;
+    source.image = image;
+    source.ageSumUs = 0;
+    source.ageMaxUs = 0;
+    source.presented = 0;
+    m_captureSources.append(source);
+    source.thread->start();
+}
 
-    QTimer::singleShot(40, this, [this] {
-        m_downCam >> m_frame_downCam;
+void PresentMainWindow::addScreenCaptureSource(const QString& name, const QRect& geometry,
+                                               DownCam* item, ImagePyramid* image)
+{
+    // half the screen still covers the 600x340 items, the shared image is
+    // created on the capture thread the first time it grabs
+    auto capture = QSharedPointer<ScreenCapture>::create();
+    QSize outputSize = geometry.size() / 2;
+    addCaptureSource(name, [capture, geometry, outputSize](QImage& frame) {
+        if (!capture->isValid())
+        {
+            // a region that is set but not valid means setup already failed
+            if (!capture->region().isNull() || !capture->setup(geometry, outputSize))
+                return false;
+        }
+        return capture->grab(frame);
+    }, 40, item, image);
+    m_captureSources.last().screenCapture = capture;
+}
 
-        cv::Mat frame_keyStone_downCam;
-        warpPerspective(m_frame_downCam, frame_keyStone_downCam, m_keyStone_matrix, m_correctedSize);
-        //m_image_downCam = cvMatToQImage(m_frame_downCam);
-        m_image_downCam = cvMatToQImage(frame_keyStone_downCam);
-        m_downCam_item->setImage(m_image_downCam);
-    });
-
-    QTimer::singleShot(40, this, [this] {
-        m_webCam >> m_frame_webCam;
-        m_image_webCam = cvMatToQImage(m_frame_webCam);
-        m_webCam_item->setImage(m_image_webCam);
-    });
-
-    QTimer::singleShot(40, this, [this] {
-        QRect g = m_matScreen->geometry();
-        m_image_mat = m_matScreen->grabWindow(0, g.x(), g.y(), g.width(), g.height()).toImage();
-        m_mat_item->setImage(m_image_mat);
-    });
-
-    QTimer::singleShot(40, this, [this] {
-        QRect g = m_monitorScreen->geometry();
-        m_image_monitor = m_monitorScreen->grabWindow(0, g.x(), g.y(), g.width(), g.height()).toImage();
-        m_monitor_item->setImage(m_image_monitor);
-    });
+void PresentMainWindow::presentFrames()
+{
+    qint64 now = CaptureThread::nowUs();
+    for (CaptureSource& source : m_captureSources)
+    {
+        if (!source.thread->takeLatest())
+            continue;
+
+        const CapturedFrame& frame = source.thread->latest();
+        *source.image = frame.pyramid;
+        source.item->setImage(frame.pyramid);
+
+        qint64 age = now - frame.capturedAtUs;
+        source.ageSumUs += age;
+        source.ageMaxUs = qMax(source.ageMaxUs, age);
+        source.presented++;
+    }
+
+    if (now - m_metricsWindowStartUs >= 5000000)
+        logCaptureMetrics(now);
+}
+
+void PresentMainWindow::logCaptureMetrics(qint64 nowUs)
+{
+    double seconds = (nowUs - m_metricsWindowStartUs) / 1e6;
+    for (CaptureSource& source : m_captureSources)
+    {
+        qInfo().nospace() << source.thread->name()
+            << ": capture " << QString::number(source.thread->captureFps(), 'f', 1) << " fps"
+            << ", presented " << QString::number(source.presented / seconds, 'f', 1) << " fps"
+            << ", age at paint avg " << (source.presented ? source.ageSumUs / source.presented / 1000.0 : 0.0) << " ms"
+            << " max " << source.ageMaxUs / 1000.0 << " ms";
+        if (source.screenCapture)
+        {
+            ScreenCaptureStats stats = source.screenCapture->stats();
+            qInfo().nospace() << source.thread->name()
+                << ": grab avg " << stats.averageGrabUs / 1000.0 << " ms"
+                << " max " << stats.maxGrabUs / 1000.0 << " ms"
+                << ", " << stats.bytesPerGrab << " bytes copied per frame";
+        }
+        source.ageSumUs = 0;
+        source.ageMaxUs = 0;
+        source.presented = 0;
+    }
+    m_metricsWindowStartUs = nowUs;
 }
 
 QScreen* PresentMainWindow::findScreen(const ScreenType& type, int* index)
@@ -196,6 +283,10 @@ void PresentMainWindow::setHardwareIds(QStringList monitorHardwareIds, QStringLi
     m_matHardwareIds = matHardwareIds;
 }
 
+void PresentMainWindow::setDownCamOutputScale(double scale) {
+    m_downCamOutputScale = qBound(0.01, scale, 1.0);
+}
+
 //[hardware]
 //.mat_ids = HWP4239
 //.monitor_ids = HWP4627, HWP425D
@@ -329,6 +420,8 @@ QMap<QString, QString> PresentMainWindow::getScreenNames()
     return screenMap;
 }
 
+// The returned image owns its pixels, frames are handed between threads and
+// outlive the Mat they were read into.
 QImage PresentMainWindow::cvMatToQImage(const cv::Mat& inMat)
 {
     switch (inMat.type())
@@ -341,16 +434,14 @@ QImage PresentMainWindow::cvMatToQImage(const cv::Mat& inMat)
             static_cast<int>(inMat.step),
             QImage::Format_ARGB32);
 
-        return image;
+        return image.copy();
     }
 
     // 8-bit, 3 channel
     case CV_8UC3:
     {
-        QImage image(inMat.data, inMat.cols, inMat.rows,
-            static_cast<int>(inMat.step), QImage::Format_RGB888);
-
-        return image.rgbSwapped();
+        return PixelConvert::imageFromBgr(inMat.data, inMat.cols, inMat.rows,
+            static_cast<int>(inMat.step));
     }
 
     // 8-bit, 1 channel
@@ -361,7 +452,7 @@ QImage PresentMainWindow::cvMatToQImage(const cv::Mat& inMat)
             static_cast<int>(inMat.step),
             QImage::Format_Grayscale8);
 
-        return image;
+        return image.copy();
     }
 
     default:
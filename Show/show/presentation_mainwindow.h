@@ -35,6 +35,8 @@
 #define PRESENTATION_MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QVector>
+#include <QSharedPointer>
 
 #include <opencv2/opencv.hpp>
 #include <opencv2/core.hpp>
@@ -46,9 +48,14 @@
 #include "opencv2/imgproc.hpp"
 #include <Windows.h>
 
+#include "keystone_warp.h"
+#include "capture_thread.h"
+#include "screen_capture.h"
+
 QT_BEGIN_NAMESPACE
 class QGraphicsScene;
 class QSplitter;
+class QTimer;
 class DownCam;
 QT_END_NAMESPACE
 
@@ -72,10 +79,10 @@ public:
     PresentMainWindow(QWidget *parent = 0);
     ~PresentMainWindow();
 
-    QImage m_image_downCam;
-    QImage m_image_webCam;
-    QImage m_image_mat;
-    QImage m_image_monitor;
+    ImagePyramid m_image_downCam;
+    ImagePyramid m_image_webCam;
+    ImagePyramid m_image_mat;
+    ImagePyramid m_image_monitor;
 
 
     static QScreen* findScreen(const ScreenType& type, int* index = nullptr);
@@ -88,14 +95,35 @@ public:
 
     static QStringList matHardwareIds() { return m_matHardwareIds; }
 
+    // size of the keystone corrected down cam frame relative to the 4200x2800
+    // corrected area, (0, 1]. Takes effect for windows created afterwards.
+    static void setDownCamOutputScale(double scale);
+
+    static double downCamOutputScale() { return m_downCamOutputScale; }
+
 
     static QMap<QString, QString> getScreenNames();
-protected:
-    void paintEvent(QPaintEvent *event) override;
 
 private slots:
+    void presentFrames();
 
 private:    
+    struct CaptureSource
+    {
+        CaptureThread* thread;
+        DownCam* item;
+        ImagePyramid* image;
+        QSharedPointer<ScreenCapture> screenCapture;
+        qint64 ageSumUs;
+        qint64 ageMaxUs;
+        int presented;
+    };
+
+    void addCaptureSource(const QString& name, const CaptureThread::GrabFunction& grab, int minIntervalMs,
+                          DownCam* item, ImagePyramid* image);
+    void addScreenCaptureSource(const QString& name, const QRect& geometry, DownCam* item, ImagePyramid* image);
+    void logCaptureMetrics(qint64 nowUs);
+
     cv::Mat hwnd2mat(HWND hwnd);
     QImage cvMatToQImage(const cv::Mat& inMat);
 
@@ -119,9 +147,15 @@ private:
 
     static QStringList m_monitorHardwareIds;
     static QStringList m_matHardwareIds;
+    static double m_downCamOutputScale;
 
     cv::Mat m_keyStone_matrix;
     cv::Size m_correctedSize;
+    KeystoneWarp m_keystoneWarp;
+
+    QVector<CaptureSource> m_captureSources;
+    QTimer* m_presentTimer;
+    qint64 m_metricsWindowStartUs;
 };
 
 #endif // PRESENTATION_MAINWINDOW_H
@@ -0,0 +1,317 @@
+#include "screen_capture.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <Windows.h>
+#else
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+#endif
+
+ScreenCapture::ScreenCapture()
+#ifdef Q_OS_WIN
+    : m_screenDC(nullptr)
+    , m_memoryDC(nullptr)
+    , m_bitmap(nullptr)
+    , m_previousBitmap(nullptr)
+#else
+    : m_display(nullptr)
+    , m_shmImage(nullptr)
+    , m_shmInfo(nullptr)
+#endif
+    , m_bytesPerPlatformGrab(0)
+    , m_grabs(0)
+    , m_totalGrabUs(0)
+    , m_maxGrabUs(0)
+    , m_bytesPerGrab(0)
+{
+}
+
+ScreenCapture::~ScreenCapture()
+{
+    release();
+}
+
+bool ScreenCapture::setup(const QRect& region, const QSize& outputSize)
+{
+    release();
+
+    m_region = region;
+    QSize size = outputSize.isEmpty() ? region.size() : outputSize.boundedTo(region.size());
+    if (region.isEmpty() || size.isEmpty())
+        return false;
+
+    m_image = QImage(size, QImage::Format_RGB32);
+    if (!setupPlatform())
+    {
+        qWarning() << "ScreenCapture: cannot set up shared memory capture of" << region;
+        release();
+        return false;
+    }
+    return true;
+}
+
+void ScreenCapture::release()
+{
+    releasePlatform();
+    m_image = QImage();
+}
+
+bool ScreenCapture::grab()
+{
+    if (!isValid())
+        return false;
+
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = grabPlatform();
+    if (ok)
+        recordGrab(timer.nsecsElapsed() / 1000, m_bytesPerPlatformGrab);
+    return ok;
+}
+
+bool ScreenCapture::grab(QImage& copy)
+{
+    if (!isValid())
+        return false;
+
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = grabPlatform();
+    if (ok)
+    {
+        // the capture thread hands back the same mailbox slot every few
+        // frames, once nothing else holds it the pixels go straight into it
+        if (copy.isDetached() && copy.size() == m_image.size() && copy.format() == m_image.format())
+        {
+            int rowBytes = m_image.width() * 4;
+            for (int y = 0; y < m_image.height(); y++)
+                memcpy(copy.scanLine(y), m_image.constScanLine(y), rowBytes);
+        }
+        else
+        {
+            copy = m_image.copy();
+        }
+        recordGrab(timer.nsecsElapsed() / 1000, m_bytesPerPlatformGrab + m_image.byteCount());
+    }
+    return ok;
+}
+
+ScreenCaptureStats ScreenCapture::stats() const
+{
+    ScreenCaptureStats stats;
+    stats.grabs = m_grabs;
+    stats.averageGrabUs = stats.grabs ? m_totalGrabUs / stats.grabs : 0;
+    stats.maxGrabUs = m_maxGrabUs;
+    stats.bytesPerGrab = m_bytesPerGrab;
+    return stats;
+}
+
+void ScreenCapture::recordGrab(qint64 elapsedUs, qint64 bytes)
+{
+    m_grabs++;
+    m_totalGrabUs += elapsedUs;
+    if (elapsedUs > m_maxGrabUs)
+        m_maxGrabUs = elapsedUs;
+    m_bytesPerGrab = bytes;
+}
+
+#ifdef Q_OS_WIN
+
+bool ScreenCapture::setupPlatform()
+{
+    HDC screenDC = GetDC(NULL);
+    HDC memoryDC = CreateCompatibleDC(screenDC);
+    m_screenDC = screenDC;
+    m_memoryDC = memoryDC;
+
+    BITMAPINFO bmi;
+    ZeroMemory(&bmi, sizeof(bmi));
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = m_image.width();
+    bmi.bmiHeader.biHeight = -m_image.height();  // top-down, like QImage
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    void* bits = nullptr;
+    HBITMAP bitmap = CreateDIBSection(memoryDC, &bmi, DIB_RGB_COLORS, &bits, NULL, 0);
+    if (!bitmap || !bits)
+        return false;
+    m_bitmap = bitmap;
+    m_previousBitmap = SelectObject(memoryDC, bitmap);
+    SetStretchBltMode(memoryDC, COLORONCOLOR);
+
+    // the DIB rows are DWORD aligned, which for 32 bit pixels is exactly
+    // what QImage expects
+    m_image = QImage(static_cast<uchar*>(bits), m_image.width(), m_image.height(),
+                     m_image.width() * 4, QImage::Format_RGB32);
+    m_bytesPerPlatformGrab = m_image.byteCount();
+    return true;
+}
+
+void ScreenCapture::releasePlatform()
+{
+    if (m_memoryDC)
+    {
+        if (m_previousBitmap)
+            SelectObject(static_cast<HDC>(m_memoryDC), m_previousBitmap);
+        DeleteDC(static_cast<HDC>(m_memoryDC));
+    }
+    if (m_bitmap)
+        DeleteObject(static_cast<HBITMAP>(m_bitmap));
+    if (m_screenDC)
+        ReleaseDC(NULL, static_cast<HDC>(m_screenDC));
+
+    m_screenDC = nullptr;
+    m_memoryDC = nullptr;
+    m_bitmap = nullptr;
+    m_previousBitmap = nullptr;
+    m_bytesPerPlatformGrab = 0;
+}
+
+bool ScreenCapture::grabPlatform()
+{
+    HDC memoryDC = static_cast<HDC>(m_memoryDC);
+    HDC screenDC = static_cast<HDC>(m_screenDC);
+    BOOL ok;
+    if (m_image.size() == m_region.size())
+    {
+        ok = BitBlt(memoryDC, 0, 0, m_image.width(), m_image.height(),
+                    screenDC, m_region.x(), m_region.y(), SRCCOPY);
+    }
+    else
+    {
+        ok = StretchBlt(memoryDC, 0, 0, m_image.width(), m_image.height(),
+                        screenDC, m_region.x(), m_region.y(), m_region.width(), m_region.height(), SRCCOPY);
+    }
+    // GDI may batch the blit, the DIB bits are only current after a flush
+    GdiFlush();
+    return ok != 0;
+}
+
+#else
+
+bool ScreenCapture::setupPlatform()
+{
+    Display* display = XOpenDisplay(NULL);
+    if (!display)
+        return false;
+    m_display = display;
+    if (!XShmQueryExtension(display))
+        return false;
+
+    int screen = DefaultScreen(display);
+    Visual* visual = DefaultVisual(display, screen);
+    int depth = DefaultDepth(display, screen);
+    if (depth != 24 && depth != 32)
+        return false;
+
+    XShmSegmentInfo* info = new XShmSegmentInfo;
+    memset(info, 0, sizeof(XShmSegmentInfo));
+    info->shmid = -1;
+    m_shmInfo = info;
+
+    XImage* image = XShmCreateImage(display, visual, depth, ZPixmap, NULL, info,
+                                    m_region.width(), m_region.height());
+    if (!image)
+        return false;
+    m_shmImage = image;
+
+    info->shmid = shmget(IPC_PRIVATE, image->bytes_per_line * image->height, IPC_CREAT | 0600);
+    if (info->shmid < 0)
+        return false;
+    char* address = static_cast<char*>(shmat(info->shmid, NULL, 0));
+    if (address == reinterpret_cast<char*>(-1))
+        return false;
+    info->shmaddr = image->data = address;
+    info->readOnly = False;
+    if (!XShmAttach(display, info))
+    {
+        shmdt(address);
+        info->shmaddr = NULL;
+        return false;
+    }
+    XSync(display, False);
+    // removed once both sides have detached
+    shmctl(info->shmid, IPC_RMID, NULL);
+
+    m_bytesPerPlatformGrab = qint64(image->bytes_per_line) * image->height;
+    if (m_image.size() == m_region.size())
+    {
+        m_image = QImage(reinterpret_cast<uchar*>(image->data), image->width, image->height,
+                         image->bytes_per_line, QImage::Format_RGB32);
+    }
+    else
+    {
+        m_sampleColumns.resize(m_image.width());
+        for (int x = 0; x < m_image.width(); x++)
+            m_sampleColumns[x] = (2 * x + 1) * m_region.width() / (2 * m_image.width());
+        m_bytesPerPlatformGrab += m_image.byteCount();
+    }
+    return true;
+}
+
+void ScreenCapture::releasePlatform()
+{
+    Display* display = static_cast<Display*>(m_display);
+    XShmSegmentInfo* info = static_cast<XShmSegmentInfo*>(m_shmInfo);
+    XImage* image = static_cast<XImage*>(m_shmImage);
+
+    if (info && info->shmaddr)
+    {
+        XShmDetach(display, info);
+        XSync(display, False);
+        shmdt(info->shmaddr);
+    }
+    else if (info && info->shmid >= 0)
+    {
+        shmctl(info->shmid, IPC_RMID, NULL);
+    }
+    if (image)
+    {
+        image->data = NULL;
+        XDestroyImage(image);
+    }
+    delete info;
+    if (display)
+        XCloseDisplay(display);
+
+    m_display = nullptr;
+    m_shmImage = nullptr;
+    m_shmInfo = nullptr;
+    m_sampleColumns.clear();
+    m_bytesPerPlatformGrab = 0;
+}
+
+bool ScreenCapture::grabPlatform()
+{
+    Display* display = static_cast<Display*>(m_display);
+    XImage* image = static_cast<XImage*>(m_shmImage);
+    if (!XShmGetImage(display, DefaultRootWindow(display), image, m_region.x(), m_region.y(), AllPlanes))
+        return false;
+
+    if (m_sampleColumns.isEmpty())
+        return true;
+
+    // X has no scaled grab, point sample the region down into m_image
+    const int* columns = m_sampleColumns.constData();
+    for (int y = 0; y < m_image.height(); y++)
+    {
+        int sourceY = (2 * y + 1) * m_region.height() / (2 * m_image.height());
+        const quint32* source = reinterpret_cast<const quint32*>(image->data + sourceY * image->bytes_per_line);
+        quint32* target = reinterpret_cast<quint32*>(m_image.scanLine(y));
+        for (int x = 0; x < m_image.width(); x++)
+            target[x] = source[columns[x]];
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <QImage>
+#include <QRect>
+#include <QSize>
+#include <QVector>
+
+#include <atomic>
+
+struct ScreenCaptureStats
+{
+    qint64 grabs;
+    qint64 averageGrabUs;
+    qint64 maxGrabUs;
+    qint64 bytesPerGrab;
+};
+
+// Grabs one screen region into a persistent shared-memory image.
+//
+// The image is set up once: a DIB section selected into a memory DC on
+// Windows, an MIT-SHM segment on X11. Every grab lets the window system
+// write straight into it instead of allocating and copying a fresh bitmap.
+// On Windows the region is scaled to the output size by StretchBlt while it
+// is copied; on X11 the full region is fetched and point sampled down.
+// Not thread safe, create and use it on the capturing thread.
+class ScreenCapture
+{
+public:
+    ScreenCapture();
+    ~ScreenCapture();
+
+    // region is in virtual desktop pixels, an empty outputSize keeps its size.
+    bool setup(const QRect& region, const QSize& outputSize = QSize());
+    void release();
+    bool isValid() const { return !m_image.isNull(); }
+
+    QRect region() const { return m_region; }
+    QSize outputSize() const { return m_image.size(); }
+
+    // Refreshes image(), which points into the shared memory and is only
+    // valid until the next grab or release.
+    bool grab();
+    const QImage& image() const { return m_image; }
+
+    // grab() plus a copy of the result the caller may keep. An unshared
+    // copy of the right size and format is overwritten in place, anything
+    // else is replaced by a newly allocated image.
+    bool grab(QImage& copy);
+
+    ScreenCaptureStats stats() const;
+
+private:
+    bool setupPlatform();
+    void releasePlatform();
+    bool grabPlatform();
+    void recordGrab(qint64 elapsedUs, qint64 bytes);
+
+    QRect m_region;
+    QImage m_image;
+
+#ifdef Q_OS_WIN
+    void* m_screenDC;
+    void* m_memoryDC;
+    void* m_bitmap;
+    void* m_previousBitmap;
+#else
+    void* m_display;
+    void* m_shmImage;
+    void* m_shmInfo;
+    QVector<int> m_sampleColumns;
+#endif
+    qint64 m_bytesPerPlatformGrab;
+
+    std::atomic<qint64> m_grabs;
+    std::atomic<qint64> m_totalGrabUs;
+    std::atomic<qint64> m_maxGrabUs;
+    std::atomic<qint64> m_bytesPerGrab;
+};
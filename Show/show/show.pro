@@ -14,7 +14,15 @@ HEADERS += mainwindow.h \
     mainwindowGL.h \
     mygraphicsscene.h \
     presentation_mainwindow.h \
-    down_cam.h
+    down_cam.h \
+    keystone_warp.h \
+    frame_mailbox.h \
+    capture_thread.h \
+    image_pyramid.h \
+    screen_capture.h \
+    pixel_convert.h \
+    keystone_reference.h \
+    show_benchmark.h
 
 SOURCES += main.cpp \
     video_widget.cpp \
@@ -23,13 +31,21 @@ SOURCES += main.cpp \
     mainwindowGL.cpp \
     mygraphicsscene.cpp \
     presentation_mainwindow.cpp \
-    down_cam.cpp
+    down_cam.cpp \
+    keystone_warp.cpp \
+    capture_thread.cpp \
+    image_pyramid.cpp \
+    screen_capture.cpp \
+    pixel_convert.cpp \
+    keystone_reference.cpp \
+    show_benchmark.cpp
 
 QT += widgets
 QT += opengl
 
 LIBS += $$PWD/../OpenCV/lib/opencv_world320.lib
 win32:LIBS += -lUser32 -lShell32 -lWtsapi32 -lwevtapi -lgdi32
+unix:!macx:LIBS += -lX11 -lXext
 
 FORMS += \
     mainwindow.ui \
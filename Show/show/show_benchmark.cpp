@@ -0,0 +1,386 @@
+#include "show_benchmark.h"
+#include "keystone_reference.h"
+#include "keystone_warp.h"
+#include "video_widget.h"
+
+#include <QApplication>
+#include <QImage>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/core/ocl.hpp>
+#include <opencv2/imgproc.hpp>
+
+using namespace std;
+using namespace cv;
+
+namespace
+{
+
+// Distinct frames, so consecutive iterations do not hit a warm cache
+const int FramesPerSource = 4;
+
+struct Options
+{
+    string mode;
+    int iterations = 50;
+    vector<int> threadCounts;
+    double scale = 0.5;
+    cv::Size frameSize = cv::Size(4416, 3312);
+    bool hardwareGl = false;
+};
+
+vector<string> split(const string& text, char separator)
+{
+    vector<string> parts;
+    stringstream stream(text);
+    string part;
+    while (getline(stream, part, separator))
+    {
+        if (!part.empty())
+            parts.push_back(part);
+    }
+    return parts;
+}
+
+Mat syntheticFrame(Size size, int type, int seed)
+{
+    // gradients plus noise, so interpolation has real work
+    Mat frame(size, type);
+    RNG rng(seed);
+    rng.fill(frame, RNG::UNIFORM, Scalar::all(0), Scalar::all(256));
+    Mat gradient(size, type);
+    for (int y = 0; y < size.height; y++)
+        gradient.row(y).setTo(Scalar::all((y * 255) / size.height));
+    addWeighted(frame, 0.25, gradient, 0.75, 0, frame);
+    return frame;
+}
+
+double percentile(vector<double> values, double p)
+{
+    if (values.empty())
+        return 0;
+    sort(values.begin(), values.end());
+    size_t index = min(values.size() - 1, (size_t)(p * (values.size() - 1) + 0.5));
+    return values[index];
+}
+
+void printStep(const string& step, const vector<double>& times)
+{
+    cout << "  " << left << setw(28) << step << right << fixed << setprecision(2)
+         << " p50 " << setw(8) << percentile(times, 0.50)
+         << " p90 " << setw(8) << percentile(times, 0.90)
+         << " p99 " << setw(8) << percentile(times, 0.99)
+         << " max " << setw(8) << percentile(times, 1.00) << " ms" << endl;
+}
+
+double elapsedMs(int64 from, int64 to)
+{
+    return (to - from) * 1000.0 / getTickFrequency();
+}
+
+// The down cam calibration of PresentMainWindow, source -> corrected pixels.
+// It inverts the matrix twice on the way, which cancels out.
+Mat downCamHomography()
+{
+    return (Mat_<double>(3, 3) << 0.99800744125081942, -0.12494066354552548, -58.492698385016908,
+                                  0.0031995645556478947, 0.96248397740829172, -333.29982033723468,
+                                  2.3323995676436789e-07, -5.8578188344702079e-05, 1);
+}
+
+vector<double> nsecsToMs(const vector<qint64>& nsecs)
+{
+    vector<double> ms;
+    for (qint64 value : nsecs)
+        ms.push_back(value / 1e6);
+    return ms;
+}
+
+template <typename Step>
+vector<double> timeStep(const vector<Mat>& frames, int iterations, Step step)
+{
+    // warm up allocations and the thread pool
+    for (int n = 0; n < 3; n++)
+        step(frames[n % frames.size()]);
+
+    vector<double> times;
+    for (int n = 0; n < iterations; n++)
+    {
+        int64 start = getTickCount();
+        step(frames[n % frames.size()]);
+        times.push_back(elapsedMs(start, getTickCount()));
+    }
+    return times;
+}
+
+int runKeystone(const Options& options)
+{
+    const Size sourceSize(4416, 3312);
+    const Size correctedSize(4200, 2800);
+    const Mat homography = downCamHomography();
+
+    vector<Mat> frames;
+    for (int i = 0; i < FramesPerSource; i++)
+        frames.push_back(syntheticFrame(sourceSize, CV_8UC3, i));
+
+    cout << "keystone " << sourceSize.width << "x" << sourceSize.height << " -> "
+         << correctedSize.width << "x" << correctedSize.height << ", output scale " << options.scale << endl;
+
+    for (int threads : options.threadCounts)
+    {
+        setNumThreads(threads);
+        cout << endl << threads << " thread(s), " << options.iterations << " iterations:" << endl;
+
+        // the table is built once per calibration, show what that costs
+        KeystoneWarp fullWarp, scaledWarp;
+        int64 start = getTickCount();
+        fullWarp.setHomography(homography, correctedSize, 1.0);
+        double buildMs = elapsedMs(start, getTickCount());
+        scaledWarp.setHomography(homography, correctedSize, options.scale);
+        cout << "  remap table build " << fixed << setprecision(2) << buildMs << " ms" << endl;
+
+        Mat warped, remapped, scaled, resized;
+        printStep("warpPerspective", timeStep(frames, options.iterations, [&](const Mat& frame) {
+            warpPerspective(frame, warped, homography, correctedSize, INTER_LINEAR, BORDER_CONSTANT);
+        }));
+        printStep("KeystoneWarp", timeStep(frames, options.iterations, [&](const Mat& frame) {
+            fullWarp.apply(frame, remapped);
+        }));
+
+        const Size outputSize = scaledWarp.outputSize();
+        stringstream scaledName;
+        scaledName << "KeystoneWarp " << outputSize.width << "x" << outputSize.height;
+        printStep(scaledName.str(), timeStep(frames, options.iterations, [&](const Mat& frame) {
+            scaledWarp.apply(frame, scaled);
+        }));
+        printStep("warpPerspective + resize", timeStep(frames, options.iterations, [&](const Mat& frame) {
+            warpPerspective(frame, warped, homography, correctedSize, INTER_LINEAR, BORDER_CONSTANT);
+            cv::resize(warped, resized, outputSize, 0, 0, INTER_AREA);
+        }));
+
+        // same table rounding as warpPerspective, anything but 0 is a bug
+        warpPerspective(frames[0], warped, homography, correctedSize, INTER_LINEAR, BORDER_CONSTANT);
+        fullWarp.apply(frames[0], remapped);
+        cout << "  max difference to warpPerspective: " << norm(warped, remapped, NORM_INF) << endl;
+    }
+    return 0;
+}
+
+// Streams camera frames through VideoWidget like the presentation window
+// would: setFrame() for every frame, then a paint. The widget is never shown,
+// grabFramebuffer() paints it offscreen and reads the result back, which
+// waits for the GPU to finish the frame.
+int runUpload(int argc, char* argv[], const Options& options)
+{
+    // Mesa's llvmpipe (opengl32sw) on Windows, so the numbers do not depend
+    // on the GPU and build machines without one can run it
+    if (!options.hardwareGl)
+        QCoreApplication::setAttribute(Qt::AA_UseSoftwareOpenGL);
+    QCoreApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
+    QApplication app(argc, argv);
+
+    VideoWidget widget;
+    widget.resize(1920, 1080);
+
+    QVector<QImage> frames;
+    for (int i = 0; i < FramesPerSource; i++)
+    {
+        Mat frame = syntheticFrame(options.frameSize, CV_8UC3, i);
+        frames.append(QImage(frame.data, frame.cols, frame.rows, (int)frame.step, QImage::Format_RGB888).copy());
+    }
+
+    // warm up: context, shaders, texture and upload buffers
+    for (int n = 0; n < 3; n++)
+    {
+        widget.setFrame(frames[n % frames.size()]);
+        if (widget.grabFramebuffer().isNull())
+        {
+            cout << "Cannot render VideoWidget offscreen" << endl;
+            return -1;
+        }
+    }
+    widget.takeTimings();
+
+    widget.makeCurrent();
+    const GLubyte* renderer = widget.context()->functions()->glGetString(GL_RENDERER);
+    cout << "upload " << options.frameSize.width << "x" << options.frameSize.height << " frames, "
+         << options.iterations << " iterations, renderer " << (renderer ? (const char*)renderer : "unknown") << endl;
+    widget.doneCurrent();
+
+    vector<double> setFrame, paint;
+    vector<qint64> copy, upload, paintCpu;
+    for (int n = 0; n < options.iterations; n++)
+    {
+        int64 start = getTickCount();
+        widget.setFrame(frames[n % frames.size()]);
+        int64 queued = getTickCount();
+        widget.grabFramebuffer();
+        int64 painted = getTickCount();
+
+        setFrame.push_back(elapsedMs(start, queued));
+        paint.push_back(elapsedMs(queued, painted));
+
+        const VideoWidgetTimings timings = widget.takeTimings();
+        copy.push_back(timings.copyNsecs);
+        upload.push_back(timings.uploadNsecs);
+        paintCpu.push_back(timings.paintNsecs);
+    }
+
+    printStep("setFrame (convert)", setFrame);
+    printStep("copy into unpack buffer", nsecsToMs(copy));
+    printStep("upload (texture from buffer)", nsecsToMs(upload));
+    printStep("paintGL", nsecsToMs(paintCpu));
+    printStep("paint + readback", paint);
+    return 0;
+}
+
+void printError(const string& name, const Mat& output, const Mat& reference)
+{
+    const double maxError = norm(output, reference, NORM_INF);
+    const double meanError = norm(output, reference, NORM_L1) / (reference.total() * reference.channels());
+    cout << "  " << left << setw(28) << name << right << fixed << setprecision(3)
+         << " max error " << setw(4) << (int)maxError << " mean error " << setw(7) << meanError << endl;
+}
+
+// The display pass of VideoWidget and the CPU path it replaces, both against
+// renderKeystoneReference(). The GPU filters with a few bits of sub-texel
+// precision, a max error of a level or two is expected; anything larger
+// means the shader samples the wrong texels.
+int runDisplay(int argc, char* argv[], const Options& options)
+{
+    if (!options.hardwareGl)
+        QCoreApplication::setAttribute(Qt::AA_UseSoftwareOpenGL);
+    QCoreApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
+    QApplication app(argc, argv);
+
+    const Size correctedSize(4200, 2800);
+    const QRect displayRect = VideoWidget::displayRect();
+    const Size outputSize(displayRect.width(), displayRect.height());
+    const Mat homography = downCamHomography();
+    const Mat source = syntheticFrame(options.frameSize, CV_8UC3, 0);
+
+    cout << "display " << source.cols << "x" << source.rows << " -> " << correctedSize.width << "x"
+         << correctedSize.height << " shown at " << outputSize.width << "x" << outputSize.height
+         << ", " << options.iterations << " iterations" << endl;
+
+    Mat reference;
+    int64 start = getTickCount();
+    renderKeystoneReference(source, homography, correctedSize, outputSize, VideoWidget::maxDisplayTaps(), reference);
+    cout << "  reference " << fixed << setprecision(2) << elapsedMs(start, getTickCount()) << " ms" << endl;
+
+    // the texture is RGB, so the bytes go in and come back in the same order
+    VideoWidget widget;
+    widget.resize(displayRect.right() + 1, displayRect.bottom() + 1);
+    const QImage frame(source.data, source.cols, source.rows, (int)source.step, QImage::Format_RGB888);
+
+    // the first paints create the context and fill the upload ring
+    vector<double> paint;
+    QImage grabbed;
+    for (int n = -3; n < options.iterations; n++)
+    {
+        widget.setFrame(frame);
+        int64 paintStart = getTickCount();
+        grabbed = widget.grabFramebuffer();
+        if (grabbed.isNull())
+        {
+            cout << "Cannot render VideoWidget offscreen" << endl;
+            return -1;
+        }
+        if (n >= 0)
+            paint.push_back(elapsedMs(paintStart, getTickCount()));
+    }
+
+    // grabFramebuffer() flips to top down, the reference is in GL row order
+    QImage shown = grabbed.mirrored().copy(displayRect).convertToFormat(QImage::Format_RGB888);
+    if (shown.width() != outputSize.width || shown.height() != outputSize.height)
+    {
+        cout << "Framebuffer is " << grabbed.width() << "x" << grabbed.height() << ", too small" << endl;
+        return -1;
+    }
+    const Mat gpu(shown.height(), shown.width(), CV_8UC3, shown.bits(), shown.bytesPerLine());
+    printStep("GPU paint + readback", paint);
+    printError("GPU display pass", gpu, reference);
+
+    // repeated edges like the shader, a black border would dominate the error
+    Mat warped, resized;
+    printStep("warpPerspective + resize", timeStep(vector<Mat>(1, source), options.iterations, [&](const Mat& input) {
+        warpPerspective(input, warped, homography, correctedSize, INTER_LINEAR, BORDER_REPLICATE);
+        cv::resize(warped, resized, outputSize, 0, 0, INTER_AREA);
+    }));
+    printError("warpPerspective + resize", resized, reference);
+    return 0;
+}
+
+}
+
+int runShowBenchmark(int argc, char* argv[])
+{
+    Options options;
+    for (int i = 2; i < argc; i++)
+    {
+        string arg = argv[i];
+        string value = i + 1 < argc ? argv[i + 1] : "";
+        if (arg == "--iterations" && !value.empty())
+        {
+            options.iterations = max(1, atoi(value.c_str()));
+            i++;
+        }
+        else if (arg == "--threads" && !value.empty())
+        {
+            for (const string& count : split(value, ','))
+                options.threadCounts.push_back(max(1, atoi(count.c_str())));
+            i++;
+        }
+        else if (arg == "--scale" && !value.empty())
+        {
+            options.scale = min(1.0, max(0.01, atof(value.c_str())));
+            i++;
+        }
+        else if (arg == "--size" && !value.empty())
+        {
+            int width = 0, height = 0;
+            if (sscanf(value.c_str(), "%dx%d", &width, &height) == 2 && width > 0 && height > 0)
+                options.frameSize = Size(width, height);
+            i++;
+        }
+        else if (arg == "--hardware-gl")
+        {
+            options.hardwareGl = true;
+        }
+        else if (options.mode.empty() && arg.compare(0, 2, "--") != 0)
+        {
+            options.mode = arg;
+        }
+    }
+
+    if (options.threadCounts.empty())
+    {
+        int cores = getNumberOfCPUs();
+        for (int count = 1; count < cores; count *= 2)
+            options.threadCounts.push_back(count);
+        options.threadCounts.push_back(cores);
+    }
+
+    // CPU only, the results must not depend on which OpenCL device is around
+    ocl::setUseOpenCL(false);
+
+    if (options.mode == "keystone")
+        return runKeystone(options);
+    if (options.mode == "upload")
+        return runUpload(argc, argv, options);
+    if (options.mode == "display")
+        return runDisplay(argc, argv, options);
+
+    cout << "Unknown benchmark '" << options.mode << "', see show_benchmark.h" << endl;
+    return -1;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+// Headless benchmarks of the display paths of WT_Show, on synthetic frames.
+// Print per step latency percentiles, need no cameras or display.
+//
+//   WT_Show --benchmark keystone [--iterations N] [--threads 1,2,4] [--scale 0.5]
+//       KeystoneWarp against cv::warpPerspective, 4416x3312 -> 4200x2800
+//   WT_Show --benchmark upload [--iterations N] [--size 4416x3312] [--hardware-gl]
+//       VideoWidget frame streaming on software GL, copy / upload / paint times
+//   WT_Show --benchmark display [--iterations N] [--size 4416x3312] [--hardware-gl]
+//       the display warp on the GPU and warpPerspective + resize, timed and
+//       compared with renderKeystoneReference(); odd widths check the upload
+int runShowBenchmark(int argc, char* argv[]);
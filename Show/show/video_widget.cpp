@@ -1,6 +1,20 @@
 #include "video_widget.h"
+#include "pixel_convert.h"
 
 #include <QApplication>
+#include <QOpenGLPixelTransferOptions>
+
+#include <cstring>
+
+// frame copies in flight, see CombinedFilterData::uploadBuffers
+static const int UploadBufferCount = 3;
+// paints between two timing log lines
+static const int TimingLogInterval = 100;
+// where the corrected frame is shown, in widget framebuffer pixels
+static const QRect DisplayRect(0, 0, 1920, 1080);
+// taps per axis the display pass averages at most, enough for shrinking
+// the 4200x2800 corrected frame down to a 1050x700 window
+static const int MaxDisplayTaps = 4;
 
 /*
 [Resolutions]
@@ -48,6 +62,24 @@ VideoWidget::VideoWidget(QWidget* parent)
     QPalette palette = this->palette();
     palette.setColor(QPalette::Background, Qt::black);
     setPalette(palette);
+
+    memset(&m_timings, 0, sizeof(m_timings));
+
+    m_twoPassDisplay = qEnvironmentVariableIsSet("SHOW_KEYSTONE_TWO_PASS");
+    m_captureRequested = false;
+}
+
+void VideoWidget::setFrame(const QImage& frame)
+{
+    // the texture is RGB8, convert once here instead of per upload
+    m_pendingFrame = PixelConvert::toRgb888(frame);
+    update();
+}
+
+void VideoWidget::requestCapture()
+{
+    m_captureRequested = true;
+    update();
 }
 
 //void VideoWidget::initializeGL()
@@ -78,52 +110,184 @@ void VideoWidget::paintGL()
     f->glClearColor(0, 0, 0, 1);
     f->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    const auto context = QOpenGLContext::currentContext();
-    QSize frameSize(4200, 2800);
-    if ( !m_frameBuffers.contains(context))
+    QElapsedTimer paintTimer;
+    paintTimer.start();
+
+    QSize imageSize = !m_pendingFrame.isNull() ? m_pendingFrame.size() :
+                      m_contextData ? m_contextData->imageSize : QSize(4416, 3312);
+    if (!m_contextData || m_contextData->imageSize != imageSize)
     {
-        m_frameBuffers.insert(context, QSharedPointer<QOpenGLFramebufferObject>::create(frameSize));
+        m_contextData = combinedInit(imageSize);
     }
 
-    if (m_frameBuffers.contains(context))
+    uploadFilledBuffer(m_contextData);
+
+    if (m_contextData->hasFrame)
     {
-        uchar* sourceImageData = new uchar[4416*3312];
-        QSize imageSize(4416, 3312);
-        convert(sourceImageData, imageSize, m_frameBuffers[context].data());
+        // The full-size corrected frame is only rendered when it is needed as
+        // such, the display pass below warps and shrinks in one go.
+        if (m_twoPassDisplay || m_captureRequested)
+        {
+            const auto context = QOpenGLContext::currentContext();
+            QSize frameSize(4200, 2800);
+            if ( !m_frameBuffers.contains(context))
+            {
+                m_frameBuffers.insert(context, QSharedPointer<QOpenGLFramebufferObject>::create(frameSize));
+            }
+            QOpenGLFramebufferObject* frameBuffer = m_frameBuffers[context].data();
+
+            combined(frameBuffer, m_contextData);
+
+            if (m_captureRequested)
+            {
+                m_captureRequested = false;
+                emit frameCaptured(frameBuffer->toImage());
+            }
+
+            if (m_twoPassDisplay)
+            {
+                // Blit to target framebuffer ...
+                QRect source(0,0,4200,2800);
+
+                QOpenGLFramebufferObject::blitFramebuffer(0, DisplayRect, frameBuffer, source,
+                                                          // SPROUTSW-4416 - Using linear sampling instead of default nearest
+                                                          GL_COLOR_BUFFER_BIT, GL_LINEAR);
+            }
+        }
+
+        if (!m_twoPassDisplay)
+        {
+            display(m_contextData);
+        }
     }
 
-    // Blit to target framebuffer ...
-    QRect source(0,0,4200,2800);
-    QRect destination(0,0,1920,1080);
+    // copy the next frame while the GPU works on this one. It reaches the
+    // texture at the start of the next paint, so ask for that paint right
+    // away, or the last frame of a stream would wait for an unrelated repaint.
+    if (!m_pendingFrame.isNull())
+    {
+        fillUploadBuffer(m_contextData, m_pendingFrame);
+        m_pendingFrame = QImage();
+        if (m_contextData->filledUploadBuffer >= 0)
+        {
+            update();
+        }
+    }
 
-    QSharedPointer<QOpenGLFramebufferObject> frameBuffer =
-            m_frameBuffers.contains(context) ? m_frameBuffers[context] :
-                                               QSharedPointer<QOpenGLFramebufferObject>();
+    m_timings.paintNsecs += paintTimer.nsecsElapsed();
+    if (++m_timings.paints >= TimingLogInterval)
+    {
+        logTimings();
+    }
+}
+
+void VideoWidget::createUploadBuffers(QSharedPointer<CombinedFilterData> &data)
+{
+    const int frameBytes = data->imageSize.width() * data->imageSize.height() * 3;
 
-    QOpenGLFramebufferObject::blitFramebuffer(0, destination, frameBuffer.data(), source,
-                                              // SPROUTSW-4416 - Using linear sampling instead of default nearest
-                                              GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    for (int i = 0; i < UploadBufferCount; i++)
+    {
+        auto buffer = QSharedPointer<QOpenGLBuffer>::create(QOpenGLBuffer::PixelUnpackBuffer);
+        buffer->create();
+        buffer->setUsagePattern(QOpenGLBuffer::StreamDraw);
+        buffer->bind();
+        buffer->allocate(frameBytes);
+        buffer->release();
+        data->uploadBuffers.append(buffer);
+    }
 
+    data->nextUploadBuffer = 0;
+    data->filledUploadBuffer = -1;
+    data->hasFrame = false;
 }
 
-bool VideoWidget::convert(uchar* sourceImageData, QSize imageSize, QOpenGLFramebufferObject* glFrameBuffer)
+void VideoWidget::uploadFilledBuffer(QSharedPointer<CombinedFilterData> &data)
 {
-    bool result = false;
-    //const auto context = QOpenGLContext::currentContext();
+    if (data->filledUploadBuffer < 0)
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // with an unpack buffer bound the data pointer is an offset into it and
+    // the driver does the transfer asynchronously. Rows are packed tightly,
+    // the default alignment of 4 would skew widths with width * 3 % 4 != 0.
+    QOpenGLPixelTransferOptions transferOptions;
+    transferOptions.setAlignment(1);
 
-    if (!m_contextData)
+    auto buffer = data->uploadBuffers[data->filledUploadBuffer];
+    buffer->bind();
+    data->inputTexture->setData(data->pixelFormat, QOpenGLTexture::UInt8, static_cast<const void*>(nullptr), &transferOptions);
+    buffer->release();
+
+    data->filledUploadBuffer = -1;
+    data->hasFrame = true;
+
+    m_timings.uploadNsecs += timer.nsecsElapsed();
+    m_timings.frames++;
+}
+
+void VideoWidget::fillUploadBuffer(QSharedPointer<CombinedFilterData> &data, const QImage &frame)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    const int rowBytes = data->imageSize.width() * 3;
+    const int frameBytes = rowBytes * data->imageSize.height();
+
+    auto buffer = data->uploadBuffers[data->nextUploadBuffer];
+    buffer->bind();
+    // invalidating lets the driver hand out fresh storage instead of waiting
+    // for a transfer that may still read the old contents
+    uchar* target = static_cast<uchar*>(buffer->mapRange(0, frameBytes,
+        QOpenGLBuffer::RangeWrite | QOpenGLBuffer::RangeInvalidateBuffer));
+    if (target)
     {
-        m_contextData = combinedInit(imageSize);
+        for (int y = 0; y < data->imageSize.height(); y++)
+        {
+            memcpy(target + y * rowBytes, frame.constScanLine(y), rowBytes);
+        }
+        buffer->unmap();
+
+        data->filledUploadBuffer = data->nextUploadBuffer;
+        data->nextUploadBuffer = (data->nextUploadBuffer + 1) % data->uploadBuffers.size();
     }
-
-    if (m_contextData)
+    else
     {
-        combined(sourceImageData, imageSize, glFrameBuffer, m_contextData);
-
-        result = true;
+        qWarning() << this << "Failed to map the upload buffer, frame dropped";
     }
+    buffer->release();
 
-    return result;
+    m_timings.copyNsecs += timer.nsecsElapsed();
+}
+
+VideoWidgetTimings VideoWidget::takeTimings()
+{
+    VideoWidgetTimings timings = m_timings;
+    memset(&m_timings, 0, sizeof(m_timings));
+    return timings;
+}
+
+const QRect& VideoWidget::displayRect()
+{
+    return DisplayRect;
+}
+
+int VideoWidget::maxDisplayTaps()
+{
+    return MaxDisplayTaps;
+}
+
+void VideoWidget::logTimings()
+{
+    const int frames = qMax(1, m_timings.frames);
+    qDebug() << this << "Streamed" << m_timings.frames << "frames in" << m_timings.paints << "paints:"
+             << "copy" << m_timings.copyNsecs / frames / 1e6 << "ms,"
+             << "upload" << m_timings.uploadNsecs / frames / 1e6 << "ms,"
+             << "paint" << m_timings.paintNsecs / m_timings.paints / 1e6 << "ms"
+             << (m_twoPassDisplay ? "(two pass)" : "(single pass)");
+
+    memset(&m_timings, 0, sizeof(m_timings));
 }
 
 QSharedPointer<CombinedFilterData> VideoWidget::combinedInit(const QSize& imageSize)
@@ -131,7 +295,8 @@ QSharedPointer<CombinedFilterData> VideoWidget::combinedInit(const QSize& imageS
     auto data = QSharedPointer<CombinedFilterData>::create();
 
     data->imageSize = imageSize;
-    data->pixelFormat = QOpenGLTexture::PixelFormat::BGR;//QImage::Format_RGB888;
+    data->pixelFormat = QOpenGLTexture::PixelFormat::RGB;//QImage::Format_RGB888;
+    data->interpolationType = InterpolationType::Linear;
 
     data->filtersProgram = createAndCompileShaderProgram(":/filtersShader");
 
@@ -141,6 +306,9 @@ QSharedPointer<CombinedFilterData> VideoWidget::combinedInit(const QSize& imageS
 
     data->keystoneCorrectedSize = QSize(4200,2800);
 
+    data->inputTexture = createTexture(data->imageSize, data->interpolationType);
+    createUploadBuffers(data);
+
     QTransform keystoneCorrectionTransformation = {
     0.99800744125081942,
     -0.12494066354552548,
@@ -167,8 +335,7 @@ QSharedPointer<CombinedFilterData> VideoWidget::combinedInit(const QSize& imageS
     return data;
 }
 
-void VideoWidget::combined(uchar* sourceImageData, QSize sourceImageSize,
-                                  QOpenGLFramebufferObject *frameBuffer,
+void VideoWidget::combined(QOpenGLFramebufferObject *frameBuffer,
                                   QSharedPointer<CombinedFilterData>& data)
 {
     const auto functions = QOpenGLContext::currentContext()->functions();
@@ -176,12 +343,12 @@ void VideoWidget::combined(uchar* sourceImageData, QSize sourceImageSize,
     GLint viewport[4];
 
     functions->glGetIntegerv(GL_VIEWPORT, viewport);
-    functions->glViewport(0, 0, sourceImageSize.width(), sourceImageSize.height());
+    functions->glViewport(0, 0, data->imageSize.width(), data->imageSize.height());
 
     QOpenGLFramebufferObject *finalFrameBuffer = frameBuffer;
-    QScopedPointer<QOpenGLFramebufferObject> mirrorFrameBuffer;
 
-    runCorrectionFiltersProgram(finalFrameBuffer, data, sourceImageData);
+    // one texel per pixel, single taps keep the output identical to a plain warp
+    runCorrectionFiltersProgram(finalFrameBuffer, data, data->imageSize, 1);
 
     data->vertexArrayObject->release();
     frameBuffer->release();
@@ -189,19 +356,39 @@ void VideoWidget::combined(uchar* sourceImageData, QSize sourceImageSize,
     functions->glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
 }
 
+void VideoWidget::display(QSharedPointer<CombinedFilterData> &data)
+{
+    const auto functions = QOpenGLContext::currentContext()->functions();
+
+    GLint viewport[4];
+
+    functions->glGetIntegerv(GL_VIEWPORT, viewport);
+    functions->glViewport(DisplayRect.x(), DisplayRect.y(), DisplayRect.width(), DisplayRect.height());
+
+    // The viewport spans the corrected frame, so each display pixel maps
+    // through the homography straight to the camera texels under it and
+    // averages them, see filtersShader.frag.
+    functions->glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
+    runCorrectionFiltersProgram(nullptr, data, data->keystoneCorrectedSize, MaxDisplayTaps);
+
+    data->vertexArrayObject->release();
+
+    functions->glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
 void VideoWidget::runCorrectionFiltersProgram(QOpenGLFramebufferObject *frameBuffer,
                                                      QSharedPointer<CombinedFilterData> &data,
-                                                     const void* inputBuffer)
+                                                     QSize targetSize, int maxTaps)
 {
     const auto functions = QOpenGLContext::currentContext()->functions();
 
-    auto inputTexture = createTexture(data->imageSize, data->interpolationType);
+    auto inputTexture = data->inputTexture;
 
     auto const imageSize = data->imageSize;
 
-    inputTexture->setData(data->pixelFormat, QOpenGLTexture::UInt8, inputBuffer);
-
-    frameBuffer->bind();
+    // no frame buffer draws into whatever is bound
+    if (frameBuffer)
+        frameBuffer->bind();
     inputTexture->bind();
 
     const auto textureMatrix = data->textureMatrix;
@@ -210,6 +397,8 @@ void VideoWidget::runCorrectionFiltersProgram(QOpenGLFramebufferObject *frameBuf
     data->filtersProgram->setUniformValue("projectionMatrix", data->projectionMatrix);
     data->filtersProgram->setUniformValue("textureMatrix", textureMatrix);
     data->filtersProgram->setUniformValue("imageSize", QVector2D(imageSize.width(), imageSize.height()));
+    data->filtersProgram->setUniformValue("targetSize", QVector2D(targetSize.width(), targetSize.height()));
+    data->filtersProgram->setUniformValue("maxTaps", maxTaps);
     data->filtersProgram->setUniformValue("tex", 0);
 
     data->vertexArrayObject->bind();
@@ -15,6 +15,9 @@
 #include <QOpenGLShaderProgram>
 #include <QOpenGLBuffer>
 #include <QOpenGLTexture>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QVector>
 
 enum InterpolationType
 {
@@ -43,6 +46,28 @@ struct CombinedFilterData
     QOpenGLTexture::PixelFormat pixelFormat;
 
     InterpolationType interpolationType;
+
+    // Persistent input texture, fed through a ring of pixel unpack buffers:
+    // paint N uploads the buffer filled during paint N-1 and then fills the
+    // next one, so the copy of frame N+1 overlaps the draw of frame N.
+    QSharedPointer<QOpenGLTexture> inputTexture;
+
+    QVector<QSharedPointer<QOpenGLBuffer>> uploadBuffers;
+
+    int nextUploadBuffer;
+
+    int filledUploadBuffer;
+
+    bool hasFrame;
+};
+
+struct VideoWidgetTimings
+{
+    qint64 copyNsecs;
+    qint64 uploadNsecs;
+    qint64 paintNsecs;
+    int frames;
+    int paints;
 };
 
 class VideoWidget : public QOpenGLWidget, protected QOpenGLFunctions
@@ -51,13 +76,30 @@ class VideoWidget : public QOpenGLWidget, protected QOpenGLFunctions
 public:
     VideoWidget(QWidget *parent = 0);
 
+    // Copy, upload and paint times since the last call (or the last log line,
+    // they are logged and reset every 100 paints).
+    VideoWidgetTimings takeTimings();
+
+    // Where paintGL draws the corrected frame, in framebuffer pixels with
+    // the origin at the bottom left, and the taps per axis it averages.
+    static const QRect& displayRect();
+    static int maxDisplayTaps();
+
 public slots:
+    // Queues a 4416x3312 camera frame. The next paint copies it to an upload
+    // buffer and schedules the paint that moves it to the texture and shows it.
+    void setFrame(const QImage& frame);
+
+    // The next paint also renders the full 4200x2800 keystone corrected
+    // frame and hands it out through frameCaptured().
+    void requestCapture();
 
 public slots:
     
 private slots:
 
 signals:
+    void frameCaptured(const QImage& frame);
 
 protected:
 //    virtual void initializeGL() override;
@@ -65,21 +107,31 @@ protected:
     virtual void paintGL() override;
 
 private:    
-    bool convert(uchar* sourceImageData, QSize imageSize, QOpenGLFramebufferObject* frameBuffer);
     QSharedPointer<CombinedFilterData> combinedInit(const QSize &imageSize);
 
-    void combined(uchar* sourceImageData, QSize sourceImageSize, QOpenGLFramebufferObject *frameBuffer,
-                  QSharedPointer<CombinedFilterData> &data);
+    void combined(QOpenGLFramebufferObject *frameBuffer, QSharedPointer<CombinedFilterData> &data);
+    void display(QSharedPointer<CombinedFilterData> &data);
     void runCorrectionFiltersProgram(QOpenGLFramebufferObject *targetFrameBuffer,
                                        QSharedPointer<CombinedFilterData> &data,
-                                       const void * inputBuffer);
+                                       QSize targetSize, int maxTaps);
     void buildVertexBuffer(QSharedPointer<CombinedFilterData> data);
     QSharedPointer<QOpenGLShaderProgram> createAndCompileShaderProgram(QString programName);
     void readAndCompileShaderFile(QOpenGLShader *shader, QString shaderFileName);
     QSharedPointer<QOpenGLTexture> createTexture(QSize size, InterpolationType interpolationType, QOpenGLTexture::TextureFormat format = QOpenGLTexture::RGB8_UNorm);
+    void createUploadBuffers(QSharedPointer<CombinedFilterData> &data);
+    void uploadFilledBuffer(QSharedPointer<CombinedFilterData> &data);
+    void fillUploadBuffer(QSharedPointer<CombinedFilterData> &data, const QImage &frame);
+    void logTimings();
 
     QMap<QOpenGLContext*, QSharedPointer<QOpenGLFramebufferObject>> m_frameBuffers;
     QSharedPointer<CombinedFilterData> m_contextData;
+
+    QImage m_pendingFrame;
+    VideoWidgetTimings m_timings;
+
+    // SHOW_KEYSTONE_TWO_PASS brings back the full-size render plus blit
+    bool m_twoPassDisplay;
+    bool m_captureRequested;
 };
 
 #endif
@@ -1,14 +1,19 @@
 #include "imagesegmentation.h"
 #include "cvmatandqimage.h"
+#include "sharedframe.h"
 #include "opencv2/imgproc/imgproc.hpp"
 using namespace cv;
 
 //*****************************************************************************
 int ImageSegmentation::GetImages(QImage input, QList<QImage>& output, QList<QPoint>& positions)
 {
-	Mat image = image2Mat(input);
-	if (image.rows == 0 && image.cols == 0)
+	//adopt the pixels instead of converting them when the layout allows it
+	if (input.format() != QImage::Format_RGB32 && input.format() != QImage::Format_ARGB32)
+		input = input.convertToFormat(QImage::Format_ARGB32);
+	SharedFrame source = SharedFrame::fromImage(std::move(input));
+	if (source.isNull())
 		return -1; //no image
+	Mat image = source.mat();
 
 	Mat frame(image);
 	//proceed frame for easier detection
@@ -39,12 +44,13 @@ int ImageSegmentation::GetImages(QImage input, QList<QImage>& output, QList<QPoi
 
 		Mat mask = Mat::zeros(frame.rows, frame.cols, CV_8UC1);
 		drawContours(mask, contours, (int) i, Scalar(255), CV_FILLED);
-		Mat crop(image.rows, image.cols, CV_8UC4);
+		//only the bounds are kept, the item is the view of its own frame
+		SharedFrame item(bounds.height, bounds.width, CV_8UC4, source.colorOrder());
+		Mat crop = item.mat();
 		crop.setTo(Scalar(0, 0, 0, 0));
-		image.copyTo(crop, mask);
-		Mat result(crop, bounds);
+		image(bounds).copyTo(crop, mask(bounds));
 		positions.append(QPoint(bounds.x, bounds.y));
-		output.append(mat2Image(result));
+		output.append(item.image());
 	}
 	if (output.empty())
 		return -3; //empty list
@@ -0,0 +1,316 @@
+#include "sharedframe.h"
+#include <QImage>
+#include <QDebug>
+#include <atomic>
+
+namespace cv {
+namespace {
+
+std::atomic<quint64> copiesAvoided(0);
+std::atomic<quint64> bytesNotCopied(0);
+std::atomic<quint64> copiesMade(0);
+std::atomic<quint64> bytesCopied(0);
+
+void countAvoided(size_t bytes)
+{
+    ++copiesAvoided;
+    bytesNotCopied += bytes;
+}
+
+void countCopied(size_t bytes)
+{
+    ++copiesMade;
+    bytesCopied += bytes;
+}
+
+bool isAligned(size_t value)
+{
+    return (value & (SharedFrame::Alignment - 1)) == 0;
+}
+
+// both the start and every row must keep the alignment the frame promises
+bool canAdopt(const void *ptr, size_t step)
+{
+    return isAligned(reinterpret_cast<size_t>(ptr)) && isAligned(step);
+}
+
+MatColorOrder getColorOrderOfRGB32Format()
+{
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+        return MCO_BGRA;
+#else
+        return MCO_ARGB;
+#endif
+}
+
+void releaseImageView(void *info)
+{
+    delete static_cast<std::shared_ptr<void> *>(info);
+}
+
+/* Frees the UMatData of mat() views, whose userdata is a reference to the
+ * frame buffer. It never allocates: the views leave Mat::allocator unset,
+ * so create() on one falls back to the default allocator.
+ */
+class BufferViewAllocator : public MatAllocator
+{
+public:
+    UMatData *allocate(int, const int *, int, void *, size_t *, int, UMatUsageFlags) const
+    {
+        return 0;
+    }
+
+    bool allocate(UMatData *, int, UMatUsageFlags) const
+    {
+        return false;
+    }
+
+    void deallocate(UMatData *u) const
+    {
+        if (!u)
+            return;
+        delete static_cast<std::shared_ptr<void> *>(u->userdata);
+        delete u;
+    }
+};
+
+// never destroyed, a Mat view may be released during static destruction
+const MatAllocator *bufferViewAllocator()
+{
+    static const BufferViewAllocator *allocator = new BufferViewAllocator;
+    return allocator;
+}
+
+} //namespace
+
+/* Owns the pixels, or keeps the adopted Mat / QImage alive
+ */
+struct SharedFrame::Buffer
+{
+    std::unique_ptr<uchar[]> storage;
+    cv::Mat adoptedMat;
+    QImage adoptedImage;
+    uchar *data;
+    std::atomic<bool> counted{false};
+
+    // a buffer avoids one copy, however many views are taken of it
+    void countAvoidedOnce(size_t bytes)
+    {
+        if (!counted.exchange(true))
+            countAvoided(bytes);
+    }
+};
+
+SharedFrame::SharedFrame()
+    : m_rows(0), m_cols(0), m_type(0), m_step(0), m_order(MCO_BGR)
+{
+}
+
+SharedFrame::SharedFrame(int rows, int cols, int type, MatColorOrder order)
+    : m_rows(rows), m_cols(cols), m_type(type), m_order(order)
+{
+    Q_ASSERT(rows > 0 && cols > 0);
+
+    size_t rowBytes = cols * CV_ELEM_SIZE(type);
+    m_step = cv::alignSize(rowBytes, Alignment);
+
+    m_buffer = std::make_shared<Buffer>();
+    m_buffer->storage.reset(new uchar[m_step * rows + Alignment]);
+    m_buffer->data = cv::alignPtr(m_buffer->storage.get(), Alignment);
+}
+
+SharedFrame SharedFrame::fromMat(const cv::Mat &mat, MatColorOrder order)
+{
+    if (mat.empty() || mat.dims != 2)
+        return SharedFrame();
+
+    if (!canAdopt(mat.data, mat.step)) {
+        SharedFrame frame(mat.rows, mat.cols, mat.type(), order);
+        mat.copyTo(frame.view());
+        countCopied(mat.rows * mat.cols * mat.elemSize());
+        return frame;
+    }
+
+    SharedFrame frame;
+    frame.m_rows = mat.rows;
+    frame.m_cols = mat.cols;
+    frame.m_type = mat.type();
+    frame.m_step = mat.step;
+    frame.m_order = order;
+    frame.m_buffer = std::make_shared<Buffer>();
+    frame.m_buffer->adoptedMat = mat;
+    frame.m_buffer->data = mat.data;
+    frame.m_buffer->countAvoidedOnce(mat.step * mat.rows);
+    return frame;
+}
+
+SharedFrame SharedFrame::fromImage(QImage img)
+{
+    if (img.isNull())
+        return SharedFrame();
+
+    QImage source = std::move(img);
+    MatColorOrder order = MCO_BGR;
+    int channels = 0;
+    switch (source.format()) {
+    case QImage::Format_RGB888:
+        order = MCO_RGB;
+        channels = 3;
+        break;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    case QImage::Format_BGR888:
+        order = MCO_BGR;
+        channels = 3;
+        break;
+#endif
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+        order = getColorOrderOfRGB32Format();
+        channels = 4;
+        break;
+    case QImage::Format_RGBX8888:
+    case QImage::Format_RGBA8888:
+    case QImage::Format_RGBA8888_Premultiplied:
+        order = MCO_RGBA;
+        channels = 4;
+        break;
+    case QImage::Format_Alpha8:
+    case QImage::Format_Grayscale8:
+        channels = 1;
+        break;
+    default:
+        // no Mat layout for it, a copy is unavoidable
+        source = source.convertToFormat(QImage::Format_ARGB32);
+        countCopied(source.byteCount());
+        order = getColorOrderOfRGB32Format();
+        channels = 4;
+        break;
+    }
+
+    // writing through a shared image would detach it, which is a copy
+    // anyway, so make that copy aligned
+    const uchar *bits = source.constBits();
+    if (!canAdopt(bits, source.bytesPerLine()) || !source.isDetached()) {
+        SharedFrame frame(source.height(), source.width(), CV_8UC(channels), order);
+        cv::Mat(source.height(), source.width(), CV_8UC(channels),
+                const_cast<uchar *>(bits), source.bytesPerLine()).copyTo(frame.view());
+        countCopied(source.byteCount());
+        return frame;
+    }
+
+    SharedFrame frame;
+    frame.m_rows = source.height();
+    frame.m_cols = source.width();
+    frame.m_type = CV_8UC(channels);
+    frame.m_step = source.bytesPerLine();
+    frame.m_order = order;
+    frame.m_buffer = std::make_shared<Buffer>();
+    // moved, so bits() finds the image unshared and does not detach it
+    frame.m_buffer->adoptedImage = std::move(source);
+    frame.m_buffer->data = frame.m_buffer->adoptedImage.bits();
+    frame.m_buffer->countAvoidedOnce(frame.m_step * frame.m_rows);
+    return frame;
+}
+
+uchar *SharedFrame::data() const
+{
+    return m_buffer ? m_buffer->data : 0;
+}
+
+cv::Mat SharedFrame::mat() const
+{
+    if (!m_buffer)
+        return cv::Mat();
+
+    m_buffer->countAvoidedOnce(m_step * m_rows);
+
+    // like the QImage view it holds its own reference, see image()
+    cv::Mat shared = view();
+    UMatData *u = new UMatData(bufferViewAllocator());
+    u->data = u->origdata = m_buffer->data;
+    u->size = m_step * m_rows;
+    u->userdata = new std::shared_ptr<void>(m_buffer);
+    u->refcount = 1;
+    shared.u = u;
+    return shared;
+}
+
+cv::Mat SharedFrame::view() const
+{
+    return cv::Mat(m_rows, m_cols, m_type, m_buffer->data, m_step);
+}
+
+QImage::Format SharedFrame::imageFormat() const
+{
+    switch (m_type) {
+    case CV_8UC1:
+        return QImage::Format_Grayscale8;
+    case CV_8UC3:
+        if (m_order == MCO_RGB)
+            return QImage::Format_RGB888;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+        if (m_order == MCO_BGR)
+            return QImage::Format_BGR888;
+#endif
+        return QImage::Format_Invalid;
+    case CV_8UC4:
+        if (m_order == getColorOrderOfRGB32Format())
+            return QImage::Format_ARGB32;
+        if (m_order == MCO_RGBA)
+            return QImage::Format_RGBA8888;
+        return QImage::Format_Invalid;
+    default:
+        return QImage::Format_Invalid;
+    }
+}
+
+QImage SharedFrame::image() const
+{
+    if (!m_buffer)
+        return QImage();
+
+    QImage::Format format = imageFormat();
+    if (format == QImage::Format_Invalid) {
+        // no matching layout, convert like mat2Image() does
+        QImage image = mat2Image(view(), m_order);
+        countCopied(image.byteCount());
+        return image;
+    }
+
+    // the view holds its own reference, it may outlive every SharedFrame
+    m_buffer->countAvoidedOnce(m_step * m_rows);
+    return QImage(m_buffer->data, m_cols, m_rows, static_cast<int>(m_step), format,
+                  releaseImageView, new std::shared_ptr<void>(m_buffer));
+}
+
+SharedFrame SharedFrame::clone() const
+{
+    if (!m_buffer)
+        return SharedFrame();
+
+    SharedFrame frame(m_rows, m_cols, m_type, m_order);
+    view().copyTo(frame.view());
+    countCopied(m_rows * m_cols * CV_ELEM_SIZE(m_type));
+    return frame;
+}
+
+SharedFrame::Counters SharedFrame::counters()
+{
+    Counters counters;
+    counters.copiesAvoided = copiesAvoided;
+    counters.bytesNotCopied = bytesNotCopied;
+    counters.copiesMade = copiesMade;
+    counters.bytesCopied = bytesCopied;
+    return counters;
+}
+
+void SharedFrame::resetCounters()
+{
+    copiesAvoided = 0;
+    bytesNotCopied = 0;
+    copiesMade = 0;
+    bytesCopied = 0;
+}
+
+} //namespace cv
@@ -0,0 +1,92 @@
+#ifndef SHAREDFRAME_H
+#define SHAREDFRAME_H
+
+#include <QImage>
+#include <memory>
+#include <opencv2/core/core.hpp>
+
+#include "cvmatandqimage.h"
+
+namespace cv
+{
+
+	/* Frame buffer shared between cv::Mat and QImage views
+	 *
+	 * - The pixels live in one reference counted allocation. Its start is
+	 *   64-byte aligned and its rows are padded to a multiple of 64 bytes,
+	 *   so SIMD kernels and texture uploads can use it as it is.
+	 *
+	 * - mat() and image() are views onto the same pixels, nothing is copied.
+	 *   Each view holds a reference to the buffer, so it stays valid after
+	 *   the last SharedFrame is gone.
+	 *
+	 * - colorOrder() describes the channel layout. Consumers should pick a
+	 *   matching format (GL_BGR, QImage::Format_ARGB32 on little endian, ...)
+	 *   rather than swap channels. imageFormat() is Format_Invalid when QImage
+	 *   has no such layout, e.g. 3 channel BGR before Qt 5.14; image() then
+	 *   returns a converted copy.
+	 *
+	 * - fromMat() and fromImage() adopt the source pixels when their start
+	 *   and row step are already 64-byte aligned and copy them once
+	 *   otherwise. An adopted Mat stays shared with the source, like any
+	 *   Mat copy. An image is only adopted when nothing else references it,
+	 *   pass it with std::move; writing through the frame can then never
+	 *   change another QImage.
+	 *
+	 * - Every buffer that is adopted or viewed without a copy counts once,
+	 *   and every copy that had to be made is counted, process wide. See
+	 *   counters().
+	 */
+	class SharedFrame
+	{
+	public:
+		enum { Alignment = 64 };
+
+		SharedFrame();
+		SharedFrame(int rows, int cols, int type, MatColorOrder order = MCO_BGR);
+
+		static SharedFrame fromMat(const cv::Mat &mat, MatColorOrder order = MCO_BGR);
+		static SharedFrame fromImage(QImage img);
+
+		bool isNull() const { return !m_buffer; }
+		int rows() const { return m_rows; }
+		int cols() const { return m_cols; }
+		int type() const { return m_type; }
+		size_t step() const { return m_step; }
+		MatColorOrder colorOrder() const { return m_order; }
+		uchar *data() const;
+
+		cv::Mat mat() const;
+		QImage::Format imageFormat() const;
+		QImage image() const;
+
+		// Deep copy into a new aligned buffer.
+		SharedFrame clone() const;
+
+		struct Counters
+		{
+			quint64 copiesAvoided;
+			quint64 bytesNotCopied;
+			quint64 copiesMade;
+			quint64 bytesCopied;
+		};
+		static Counters counters();
+		static void resetCounters();
+
+	private:
+		struct Buffer;
+
+		// mat() without a reference or counting, for internal copies
+		cv::Mat view() const;
+
+		std::shared_ptr<Buffer> m_buffer;
+		int m_rows;
+		int m_cols;
+		int m_type;
+		size_t m_step;
+		MatColorOrder m_order;
+	};
+
+} //namespace cv
+
+#endif // SHAREDFRAME_H
@@ -1,5 +1,7 @@
 #include "contours_parser.h"
 
+#include <limits>
+
 ContoursParser::ContoursParser()
 {
 }
@@ -16,31 +18,187 @@ int ContoursParser::parseNumber(QString s)
     return n;
 }
 
+namespace
+{
+
+inline bool isSeparator(ushort c)
+{
+    return c == ' ' || c == ',' || c == '\t' || c == '\n' || c == '\r';
+}
+
+inline bool isDigit(ushort c)
+{
+    return c >= '0' && c <= '9';
+}
+
+double scaleByPowerOf10(double value, int exponent)
+{
+    static const double powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const int maxPower = 22;
+
+    while (exponent > maxPower && value != 0.0 && value < 1e300)
+    {
+        value *= powers[maxPower];
+        exponent -= maxPower;
+    }
+    while (exponent < -maxPower && value != 0.0)
+    {
+        value /= powers[maxPower];
+        exponent += maxPower;
+    }
+
+    if (exponent > maxPower || exponent < -maxPower)
+        return value;
+    return exponent >= 0 ? value * powers[exponent] : value / powers[-exponent];
+}
+
+// SVG number at pos: [+-]digits[.digits][(e|E)[+-]digits], digits may be empty on one side of the dot.
+// Advances pos past it, or leaves it and returns false when there is no number.
+bool parseSvgNumber(const ushort*& pos, const ushort* end, double& value)
+{
+    const ushort* p = pos;
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-'))
+    {
+        negative = *p == '-';
+        ++p;
+    }
+
+    // 19 significant digits fit into 64 bits, the rest only moves the exponent
+    quint64 mantissa = 0;
+    int significant = 0;
+    int exponent = 0;
+    bool anyDigit = false;
+
+    for (; p < end && isDigit(*p); ++p)
+    {
+        anyDigit = true;
+        if (significant < 19)
+        {
+            mantissa = mantissa * 10 + (*p - '0');
+            significant += mantissa != 0 ? 1 : 0;
+        }
+        else
+        {
+            exponent++;
+        }
+    }
+
+    if (p < end && *p == '.')
+    {
+        for (++p; p < end && isDigit(*p); ++p)
+        {
+            anyDigit = true;
+            if (significant < 19)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                significant += mantissa != 0 ? 1 : 0;
+                exponent--;
+            }
+        }
+    }
+
+    if (!anyDigit)
+        return false;
+
+    // An 'e' without digits after it is not part of the number
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        const ushort* e = p + 1;
+        bool negativeExponent = false;
+        if (e < end && (*e == '+' || *e == '-'))
+        {
+            negativeExponent = *e == '-';
+            ++e;
+        }
+
+        if (e < end && isDigit(*e))
+        {
+            int exponentValue = 0;
+            for (; e < end && isDigit(*e); ++e)
+            {
+                if (exponentValue < 100000)
+                    exponentValue = exponentValue * 10 + (*e - '0');
+            }
+            exponent += negativeExponent ? -exponentValue : exponentValue;
+            p = e;
+        }
+    }
+
+    double result = scaleByPowerOf10(double(mantissa), exponent);
+    value = negative ? -result : result;
+    pos = p;
+    return true;
+}
+
+}
+
 void ContoursParser::parsePoints(const QString& points)
 {
-    m_result.contours.clear();
+    // Reads the attribute in place, numbers are separated by whitespace, commas or just by their sign or dot
+    // ("1-2", "1.5.5"). Every number takes two characters except the first, so n points need at least
+    // 4n - 1 characters and the polygon can be sized once up front.
+    QPolygon& contours = m_result.contours;
+    int capacity = (points.size() + 1) / 4;
+    contours.resize(capacity);
+
+    QPoint* out = contours.data();
+    int count = 0;
+    double coordinates[2];
+    int pending = 0;
 
-    QStringList list = points.split(' ', QString::SkipEmptyParts);
-    for (QString point : list)
+    const ushort* p = points.utf16();
+    const ushort* end = p + points.size();
+
+    while (true)
     {
-        QStringList coords = point.split(',');
-        if (coords.size() != 2)
+        while (p < end && isSeparator(*p))
+            ++p;
+        if (p == end)
+            break;
+
+        double value;
+        if (!parseSvgNumber(p, end, value))
         {
-            qWarning() << "Failed to parse SVG point" << point;
+            const ushort* bad = p;
+            while (p < end && !isSeparator(*p))
+                ++p;
+            qWarning() << "Failed to parse SVG point" << QString::fromUtf16(bad, int(p - bad));
             m_result.warnings++;
+            pending = 0;
+            continue;
         }
 
-        bool okX, okY;
-        QPoint p;
-        p.setX(coords[0].toInt(&okX));
-        p.setY(coords[1].toInt(&okY));
-        if (!okX || !okY)
+        // qRound is undefined outside the int range, the bound is symmetric because
+        // older qRound computes int(d - 1) for negative values
+        const double limit = std::numeric_limits<int>::max();
+        if (!(value >= -limit && value <= limit))
         {
-            qWarning() << "Failed to parse SVG point" << point;
+            qWarning() << "SVG point out of range" << value;
             m_result.warnings++;
+            value = value < 0 ? -limit : limit;
+        }
+
+        coordinates[pending++] = value;
+        if (pending == 2)
+        {
+            Q_ASSERT(count < capacity);
+            out[count++] = QPoint(qRound(coordinates[0]), qRound(coordinates[1]));
+            pending = 0;
         }
-        m_result.contours.append(p);
     }
+
+    if (pending != 0)
+    {
+        qWarning() << "Failed to parse SVG points, odd number of coordinates";
+        m_result.warnings++;
+    }
+
+    // Shrinking keeps the allocation
+    contours.resize(count);
 }
 
 void ContoursParser::parseSvgSize(const QXmlAttributes& atts)
@@ -1,12 +1,113 @@
 ﻿#include "frame_counting.h"
 
 #include <QDebug>
+#include <QFile>
+#include <QGuiApplication>
+#include <QPainter>
+#include <QScreen>
+#include <QWindow>
+#include <QtMath>
 
+#include <chrono>
+
+#include "global_utilities.h"
+
+// When the screen does not report its refresh rate
 const int DEFAULT_FPS = 60;
 
+FrameTimeHistogram::FrameTimeHistogram()
+    : m_buckets(Powers * SubBuckets, 0), m_count(0), m_max(0)
+{
+}
+
+int FrameTimeHistogram::bucketOf(qint64 ns)
+{
+    if (ns < SubBuckets)
+        return int(qMax<qint64>(ns, 0));
+
+    int power = 63 - qCountLeadingZeroBits(quint64(ns));
+    int sub = int((ns >> (power - SubBucketBits)) & (SubBuckets - 1));
+    int bucket = (power - SubBucketBits + 1) * SubBuckets + sub;
+    return qMin(bucket, int(Powers * SubBuckets) - 1);
+}
+
+qint64 FrameTimeHistogram::upperBoundOf(int bucket)
+{
+    if (bucket < SubBuckets)
+        return bucket;
+
+    int power = bucket / SubBuckets + SubBucketBits - 1;
+    int sub = bucket % SubBuckets;
+    return ((qint64(SubBuckets + sub + 1)) << (power - SubBucketBits)) - 1;
+}
+
+void FrameTimeHistogram::record(qint64 ns)
+{
+    m_buckets[bucketOf(ns)]++;
+    m_count++;
+    m_max = qMax(m_max, ns);
+}
+
+void FrameTimeHistogram::reset()
+{
+    m_buckets.fill(0);
+    m_count = 0;
+    m_max = 0;
+}
+
+qint64 FrameTimeHistogram::percentile(double p) const
+{
+    if (m_count == 0)
+        return 0;
+
+    quint64 rank = quint64(qCeil(p / 100.0 * m_count));
+    quint64 seen = 0;
+    for (int i = 0; i < m_buckets.size(); i++)
+    {
+        seen += m_buckets[i];
+        if (seen >= qMax<quint64>(rank, 1))
+            return qMin(upperBoundOf(i), m_max);
+    }
+    return m_max;
+}
+
+quint64 FrameTimeHistogram::countAbove(qint64 ns) const
+{
+    // Whole buckets above the one holding ns, an approximation within one bucket
+    quint64 result = 0;
+    for (int i = bucketOf(ns) + 1; i < m_buckets.size(); i++)
+        result += m_buckets[i];
+    return result;
+}
+
+namespace {
+
+QString millis(qint64 ns)
+{
+    return QString::number(ns / 1000000.0, 'f', 2);
+}
+
+QString describe(const QString& name, const FrameTimeHistogram& histogram)
+{
+    return QString("%1 p50 %2 p95 %3 p99 %4 max %5 ms").arg(name)
+            .arg(millis(histogram.percentile(50))).arg(millis(histogram.percentile(95)))
+            .arg(millis(histogram.percentile(99))).arg(millis(histogram.maximum()));
+}
+
+QString json(const QString& name, const FrameTimeHistogram& histogram, qint64 longFrameNs)
+{
+    return QString("\"%1\":{\"count\":%2,\"p50_ns\":%3,\"p95_ns\":%4,\"p99_ns\":%5,\"max_ns\":%6,\"long\":%7}")
+            .arg(name).arg(histogram.count()).arg(histogram.percentile(50)).arg(histogram.percentile(95))
+            .arg(histogram.percentile(99)).arg(histogram.maximum()).arg(histogram.countAbove(longFrameNs));
+}
+
+}
+
 FrameCounting::FrameCounting(bool showFps, QWidget *parent)
-  : QWidget(parent), m_showFps(showFps)
+  : QWidget(parent), m_paintStartNs(0), m_lastPaintStartNs(-1), m_arrivalNs(-1),
+    m_showFps(showFps)
 {
+    // The histograms are always collected, showFps only adds the overlay
     if (!m_showFps)
         return;
 
@@ -28,15 +129,69 @@ FrameCounting::FrameCounting(bool showFps, QWidget *parent)
     setGeometry(0, 0, 500, 500);
 }
 
+FrameCounting::~FrameCounting()
+{
+    auto fileName = GlobalUtilities::settingsSnapshot()->value("frame_stats_file", QString()).toString();
+    if (!fileName.isEmpty())
+        dump(fileName);
+}
+
+qreal FrameCounting::refreshRate() const
+{
+    QWindow* window = this->window()->windowHandle();
+    QScreen* screen = window && window->screen() ? window->screen() : QGuiApplication::primaryScreen();
+    qreal rate = screen ? screen->refreshRate() : 0;
+    return rate > 0 ? rate : DEFAULT_FPS;
+}
+
+qint64 FrameCounting::longFrameNs() const
+{
+    // A frame that took longer than one and a half refresh periods missed at least one vsync
+    return qint64(1.5e9 / refreshRate());
+}
+
+qint64 FrameCounting::nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 void FrameCounting::start()
 {
-    m_paint_time.restart();
+    m_paintStartNs = nowNs();
+
+    if (m_lastPaintStartNs >= 0)
+    {
+        qint64 interval = m_paintStartNs - m_lastPaintStartNs;
+        if (m_showFps)
+            m_second.interval.record(interval);
+        m_total.interval.record(interval);
+    }
+    m_lastPaintStartNs = m_paintStartNs;
 }
 
 void FrameCounting::end()
 {
-    m_frame_counts++;
-    m_arr_paint_time.push_back(m_paint_time.elapsed());
+    qint64 endNs = nowNs();
+    // The one second window is only read, and reset, by the overlay
+    if (m_showFps)
+        m_second.paint.record(endNs - m_paintStartNs);
+    m_total.paint.record(endNs - m_paintStartNs);
+
+    if (m_arrivalNs >= 0)
+    {
+        if (m_showFps)
+            m_second.latency.record(endNs - m_arrivalNs);
+        m_total.latency.record(endNs - m_arrivalNs);
+        m_arrivalNs = -1;
+    }
+}
+
+void FrameCounting::frameArrived(qint64 timestampNs)
+{
+    // Only the oldest frame not painted yet counts, it waited the longest
+    if (m_arrivalNs < 0)
+        m_arrivalNs = timestampNs >= 0 ? timestampNs : nowNs();
 }
 
 void FrameCounting::paintEvent(QPaintEvent* paintEvent)
@@ -47,53 +202,65 @@ void FrameCounting::paintEvent(QPaintEvent* paintEvent)
     QPainter painter(this);
 
     QPen pen;
-    pen.setColor(Qt::blue);
+    pen.setColor(Qt::red);
     QFont font;
     font.setFamily("Segoe UI");
     font.setBold(true);
-    font.setPointSize(20);
-    font.setUnderline(true);
-    font.setOverline(true);
+    font.setPointSize(12);
     painter.setFont(font);
     painter.setPen(pen);
 
-    QString data = QString("%1ms").arg(m_paint_time_avg);
-    painter.drawText(100, 50, data);
-
-    pen.setColor(Qt::red);
-    painter.setPen(pen);
-    data = QString("%1fps").arg(m_frame_counts_avg);
-    painter.drawText(20, 50, data);
+    int y = 30;
+    for (const auto& line : m_overlay)
+    {
+        painter.drawText(20, y, line);
+        y += painter.fontMetrics().height();
+        pen.setColor(Qt::blue);
+        painter.setPen(pen);
+    }
 
     QWidget::paintEvent(paintEvent);
 }
 
 void FrameCounting::onTimerOut()
 {
-    m_frame_counts_avg = m_frame_counts;
-    m_frame_counts = 0;
+    // Follows the window to another screen
+    qint64 longFrame = longFrameNs();
 
-    if (m_arr_paint_time.empty())
-    {
-        m_frame_counts_avg = DEFAULT_FPS;
-        m_paint_time_avg = 0;
-        return;
-    }
+    m_overlay.clear();
+    m_overlay << QString("%1 fps, %2 long frames (> %3 ms)")
+                 .arg(m_second.paint.count()).arg(m_second.interval.countAbove(longFrame)).arg(millis(longFrame));
+    m_overlay << describe("interval", m_second.interval);
+    m_overlay << describe("paint", m_second.paint);
+    if (m_second.latency.count() > 0)
+        m_overlay << describe("latency", m_second.latency);
 
-    float nTotalTime = 0.0;
-    for (auto time : m_arr_paint_time)
+    m_second.interval.reset();
+    m_second.paint.reset();
+    m_second.latency.reset();
+    update();
+}
+
+bool FrameCounting::dump(const QString& fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
     {
-        nTotalTime += time;
+        qWarning() << "Cannot write frame statistics to" << fileName << file.errorString();
+        return false;
     }
-    m_paint_time_avg = nTotalTime / m_arr_paint_time.size();
-    m_arr_paint_time.clear();
+
+    QString widget = parentWidget() ? parentWidget()->metaObject()->className() : objectName();
+    qint64 longFrame = longFrameNs();
+    QString line = QString("{\"widget\":\"%1\",\"refresh_hz\":%2,%3,%4,%5}\n").arg(widget).arg(refreshRate())
+            .arg(json("interval", m_total.interval, longFrame))
+            .arg(json("paint", m_total.paint, longFrame))
+            .arg(json("latency", m_total.latency, longFrame));
+    file.write(line.toUtf8());
+    return true;
 }
 
 QSharedPointer<FrameCounting::Counting> FrameCounting::count()
 {
-    if (m_showFps)
-    {
-        return QSharedPointer<Counting>::create(this);
-    }
-    return QSharedPointer<Counting>();
+    return QSharedPointer<Counting>::create(this);
 }
\ No newline at end of file
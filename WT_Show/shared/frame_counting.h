@@ -2,8 +2,36 @@
 #define FRAME_COUNTING_H
 
 #include <QWidget>
+#include <QTimer>
 #include <QVector>
 
+/* Fixed size histogram of durations in nanoseconds, recording never allocates.
+ * Buckets are log-linear: 16 per power of two, so a percentile is within 1/16 (6%) of the recorded value.
+ */
+class FrameTimeHistogram
+{
+public:
+    FrameTimeHistogram();
+
+    void record(qint64 ns);
+    void reset();
+
+    quint64 count() const { return m_count; }
+    qint64 maximum() const { return m_max; }
+    qint64 percentile(double p) const;      // p in [0, 100]
+    quint64 countAbove(qint64 ns) const;
+
+private:
+    enum { SubBuckets = 16, SubBucketBits = 4, Powers = 48 };
+
+    static int bucketOf(qint64 ns);
+    static qint64 upperBoundOf(int bucket);
+
+    QVector<quint32> m_buckets;
+    quint64 m_count;
+    qint64 m_max;
+};
+
 class FrameCounting : public QWidget
 {
     Q_OBJECT
@@ -17,8 +45,21 @@ class FrameCounting : public QWidget
 
 public:
     FrameCounting(bool showFps=false, QWidget *parent = nullptr);
+    ~FrameCounting();
     QSharedPointer<Counting> count();    
 
+    /* A new frame arrived and the next paint will show it. timestampNs is a std::chrono::steady_clock time stamp
+     * taken where the frame was produced, or now if it is not given. Gives the arrival to paint latency.
+     */
+    void frameArrived(qint64 timestampNs = -1);
+
+    /* Appends the statistics since creation to fileName as one JSON line, for comparing runs.
+     * Done automatically on destruction when the frame_stats_file setting is set, with or without showFps.
+     */
+    bool dump(const QString& fileName) const;
+
+    static qint64 nowNs();
+
 protected:
     void paintEvent(QPaintEvent *event) override;
 
@@ -29,13 +70,25 @@ private:
     void start();
     void end();
 
+    // Of the screen the window is on, long frames are those over one and a half refresh periods
+    qreal refreshRate() const;
+    qint64 longFrameNs() const;
+
+    struct Histograms
+    {
+        FrameTimeHistogram interval;    // paint start to paint start
+        FrameTimeHistogram paint;       // paint duration
+        FrameTimeHistogram latency;     // frame arrival to paint end
+    };
+
 private: 
     QTimer m_fpsTimer;
-    int m_paint_time_avg;
-    QVector<int> m_arr_paint_time;
-    QTime m_paint_time;
-    int m_frame_counts;
-    int m_frame_counts_avg;
+    qint64 m_paintStartNs;
+    qint64 m_lastPaintStartNs;
+    qint64 m_arrivalNs;
+    Histograms m_second;                // current one second window
+    Histograms m_total;                 // since creation
+    QStringList m_overlay;              // last second, shown by paintEvent
 
     bool m_showFps;
 };
@@ -49,15 +49,22 @@ void GlobalUtilities::setLayoutDirection(Qt::LayoutDirection direction)
 QSharedPointer<hp::fortis::Settings> GlobalUtilities::applicationSettings()
 {
     QString path = QString("HP/%1").arg(QApplication::instance()->applicationName());
+    SettingsStore::instance()->countBackingStoreRead();
     return QSharedPointer<hp::fortis::Settings>::create(path);
 }
 
 QSharedPointer<hp::fortis::Settings> GlobalUtilities::applicationSettings(QString group)
 {
     QString path = QString("HP/%1").arg(QApplication::instance()->applicationName());
+    SettingsStore::instance()->countBackingStoreRead();
     return QSharedPointer<hp::fortis::Settings>::create(path, group);
 }
 
+QSharedPointer<const SettingsSnapshot> GlobalUtilities::settingsSnapshot(QString group)
+{
+    return SettingsStore::instance()->snapshot(group);
+}
+
 QScreen* GlobalUtilities::findScreen(const ScreenType& type, int* index)
 {
     QScreen* result = nullptr;
@@ -7,6 +7,7 @@
 
 #include "shared_global.h"
 #include "settings.h"
+#include "settings_snapshot.h"
 
 class SHAREDSHARED_EXPORT GlobalUtilities
 {
@@ -27,6 +28,11 @@ public:
 
     static QSharedPointer<hp::fortis::Settings> applicationSettings(QString group);
 
+    /*! \brief Cached, read only view of a settings group, see SettingsStore. Prefer it over applicationSettings()
+     *         unless you write settings.
+     */
+    static QSharedPointer<const SettingsSnapshot> settingsSnapshot(QString group = QString());
+
     static QScreen* findScreen(const ScreenType& type, int* index = nullptr);
 
     static QRect findScreenGeometry(const ScreenType &type);
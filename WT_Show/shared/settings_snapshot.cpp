@@ -0,0 +1,192 @@
+#include "settings_snapshot.h"
+#include "settings.h"
+
+#include <QApplication>
+#include <QFileSystemWatcher>
+#include <QSettings>
+#include <QFileInfo>
+#include <QDebug>
+
+namespace {
+
+const int ReportIntervalMs = 60 * 1000;
+
+}
+
+SettingsSnapshot::SettingsSnapshot(const QString &group, const QHash<QString, QVariant> &values)
+    : m_group(group)
+    , m_values(values)
+{
+}
+
+QVariant SettingsSnapshot::value(const QString &key, const QVariant &defaultValue) const
+{
+    auto it = m_values.constFind(key);
+
+    if (it != m_values.constEnd()) {
+        return it.value();
+    }
+
+    SettingsStore::instance()->recordDefault(m_group, key, defaultValue);
+    return defaultValue;
+}
+
+SettingsStore* SettingsStore::instance()
+{
+    // Owned by the application and living in the main thread, whichever thread asks first
+    static SettingsStore *store = [] {
+        auto app = QCoreApplication::instance();
+        auto result = new SettingsStore;
+        result->moveToThread(app->thread());
+        result->setParent(app);
+        return result;
+    }();
+
+    return store;
+}
+
+SettingsStore::SettingsStore()
+    : m_watcher(new QFileSystemWatcher(this))
+    , m_reportTimer(this)
+    , m_reportedReads(0)
+{
+    m_path = hp::fortis::Settings(packageName()).defaultPath() + "/config.ini";
+    countBackingStoreRead();
+    watch();
+
+    connect(m_watcher, &QFileSystemWatcher::fileChanged, this, &SettingsStore::onFileChanged);
+
+    m_reportTimer.setInterval(ReportIntervalMs);
+    connect(&m_reportTimer, &QTimer::timeout, this, &SettingsStore::onReportTimer);
+    QMetaObject::invokeMethod(&m_reportTimer, "start", Qt::QueuedConnection);
+}
+
+QString SettingsStore::packageName() const
+{
+    return QString("HP/%1").arg(QCoreApplication::instance()->applicationName());
+}
+
+QSharedPointer<const SettingsSnapshot> SettingsStore::snapshot(const QString &group)
+{
+    {
+        QReadLocker locker(&m_lock);
+        auto it = m_snapshots.constFind(group);
+
+        if (it != m_snapshots.constEnd()) {
+            return it.value();
+        }
+    }
+
+    auto loaded = load(group);
+
+    QWriteLocker locker(&m_lock);
+    // Another thread may have loaded it meanwhile, keep the first one
+    auto it = m_snapshots.constFind(group);
+    if (it != m_snapshots.constEnd()) {
+        return it.value();
+    }
+
+    m_snapshots.insert(group, loaded);
+    return loaded;
+}
+
+void SettingsStore::setValue(const QString &group, const QString &key, const QVariant &value)
+{
+    countBackingStoreRead();
+
+    {
+        hp::fortis::Settings settings(packageName(), group);
+        settings.setValue(key, value);
+    }
+
+    reload(group);
+    watch();
+}
+
+void SettingsStore::recordDefault(const QString &group, const QString &key, const QVariant &defaultValue)
+{
+    {
+        QMutexLocker locker(&m_defaultsMutex);
+        QString id = group + '/' + key;
+
+        if (m_recordedDefaults.contains(id)) {
+            return;
+        }
+
+        m_recordedDefaults.insert(id);
+    }
+
+    // hp::fortis::Settings::value writes ".key = default" for missing keys, keep doing so for discoverability
+    countBackingStoreRead();
+    hp::fortis::Settings settings(packageName(), group);
+    settings.value(key, defaultValue);
+    QMetaObject::invokeMethod(this, "watch", Qt::QueuedConnection);
+}
+
+void SettingsStore::watch()
+{
+    // The file may not exist before the first write, and QSettings saves by replacing it, which drops it from the watcher
+    if (QFileInfo::exists(m_path) && !m_watcher->files().contains(m_path)) {
+        m_watcher->addPath(m_path);
+    }
+}
+
+QSharedPointer<const SettingsSnapshot> SettingsStore::load(const QString &group)
+{
+    countBackingStoreRead();
+
+    QSettings settings(m_path, QSettings::IniFormat);
+    if (!group.isEmpty()) {
+        settings.beginGroup(group);
+    }
+
+    QHash<QString, QVariant> values;
+    for (auto key : settings.allKeys()) {
+        values.insert(key, settings.value(key));
+    }
+
+    return QSharedPointer<const SettingsSnapshot>::create(group, values);
+}
+
+void SettingsStore::reload(const QString &group)
+{
+    auto loaded = load(group);
+    bool changedGroup = false;
+
+    {
+        QWriteLocker locker(&m_lock);
+        auto previous = m_snapshots.value(group);
+        changedGroup = !previous || !(*previous == *loaded);
+        m_snapshots.insert(group, loaded);
+    }
+
+    if (changedGroup) {
+        emit changed(group);
+    }
+}
+
+void SettingsStore::onFileChanged()
+{
+    watch();
+
+    QStringList groups;
+    {
+        QReadLocker locker(&m_lock);
+        groups = m_snapshots.keys();
+    }
+
+    for (const auto &group : groups) {
+        reload(group);
+    }
+}
+
+void SettingsStore::onReportTimer()
+{
+    quint64 reads = backingStoreReads();
+
+    if (reads != m_reportedReads) {
+        qDebug() << this << "Settings backing store reads in the last minute:" << reads - m_reportedReads
+                 << "total:" << reads;
+        m_reportedReads = reads;
+    }
+}
@@ -0,0 +1,103 @@
+/*! \file settings_snapshot.h
+ *  \brief In-memory, immutable copies of the application settings groups, reloaded when config.ini changes.
+ */
+
+#ifndef SETTINGS_SNAPSHOT_H
+#define SETTINGS_SNAPSHOT_H
+
+#include "shared_global.h"
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QReadWriteLock>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QTimer>
+#include <QVariant>
+#include <QAtomicInteger>
+
+class QFileSystemWatcher;
+
+/*! \brief Values of one settings group as they were when it was loaded. Never changes, safe to read from any thread.
+ */
+class SHAREDSHARED_EXPORT SettingsSnapshot
+{
+public:
+    SettingsSnapshot(const QString &group, const QHash<QString, QVariant> &values);
+
+    /*! \brief Same contract as hp::fortis::Settings::value, a missing key is recorded as default in the backing store
+     *         (once per key).
+     */
+    QVariant value(const QString &key, const QVariant &defaultValue = QVariant()) const;
+
+    /*! \brief Typed accessor, e.g. get<int>("quality", 100)
+     */
+    template <class T>
+    T get(const QString &key, const T &defaultValue) const {
+        return value(key, QVariant::fromValue(defaultValue)).template value<T>();
+    }
+
+    bool contains(const QString &key) const { return m_values.contains(key); }
+    QStringList keys() const { return m_values.keys(); }
+    QString group() const { return m_group; }
+
+    bool operator==(const SettingsSnapshot &other) const { return m_values == other.m_values; }
+
+private:
+    QString m_group;
+    QHash<QString, QVariant> m_values;
+};
+
+/*! \brief Loads each settings group once and hands out shared snapshots of it.
+ *  \details config.ini is watched; when it changes, the loaded groups are read again, their snapshots are swapped and
+ *  \details changed() is emitted for the groups whose values differ. Readers holding an old snapshot keep a consistent
+ *  \details view until they ask again. Reads of the backing store are counted and reported once a minute.
+ */
+class SHAREDSHARED_EXPORT SettingsStore : public QObject
+{
+    Q_OBJECT
+public:
+    static SettingsStore* instance();
+
+    QSharedPointer<const SettingsSnapshot> snapshot(const QString &group = QString());
+
+    /*! \brief Writes through to the backing store and swaps the group snapshot right away.
+     */
+    void setValue(const QString &group, const QString &key, const QVariant &value);
+
+    /*! \brief Number of times the backing store was opened, also counting GlobalUtilities::applicationSettings().
+     */
+    quint64 backingStoreReads() const { return m_backingStoreReads.load(); }
+    void countBackingStoreRead() { m_backingStoreReads.fetchAndAddRelaxed(1); }
+
+    void recordDefault(const QString &group, const QString &key, const QVariant &defaultValue);
+
+Q_SIGNALS:
+    void changed(const QString &group);
+
+private Q_SLOTS:
+    void watch();
+    void onFileChanged();
+    void onReportTimer();
+
+private:
+    SettingsStore();
+
+    QString packageName() const;
+    QSharedPointer<const SettingsSnapshot> load(const QString &group);
+    void reload(const QString &group);
+
+    QReadWriteLock m_lock;
+    QHash<QString, QSharedPointer<const SettingsSnapshot>> m_snapshots;
+    QMutex m_defaultsMutex;
+    QSet<QString> m_recordedDefaults;
+
+    QString m_path;
+    QFileSystemWatcher *m_watcher;
+    QTimer m_reportTimer;
+    QAtomicInteger<quint64> m_backingStoreReads;
+    quint64 m_reportedReads;
+};
+
+#endif // SETTINGS_SNAPSHOT_H
@@ -11,13 +11,15 @@ export(INCLUDEPATH)
 SOURCES += \
     $$PWD/single_instance.cpp \
     $$PWD/frame_counting.cpp \
-    $$PWD/global_utilities.cpp
+    $$PWD/global_utilities.cpp \
+    $$PWD/settings_snapshot.cpp
 
 HEADERS += \
     $$PWD/shared_global.h \
     $$PWD/single_instance.h \
     $$PWD/frame_counting.h \
-    $$PWD/global_utilities.h
+    $$PWD/global_utilities.h \
+    $$PWD/settings_snapshot.h
 
 RESOURCES += \
     $$PWD/shared.qrc \
@@ -0,0 +1,305 @@
+#include "contours_parser.h"
+#include "svg_xml_handler.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+
+const int FrameWidth = 4200;
+const int FrameHeight = 2800;
+
+struct Options
+{
+    int points = 200000;
+    int iterations = 20;
+    QString writeDir;
+};
+
+// Coordinates as the segmentation writes them, or with fractions and
+// exponents as other SVG tools do. The fractions stay clear of .5 so the
+// rounding of the expected points is unambiguous.
+enum Notation
+{
+    Integers,
+    Decimals,
+    Exponents
+};
+
+struct GeneratedFile
+{
+    const char* name;
+    Notation notation;
+    QString points;
+    QByteArray document;
+    QPolygon expected;
+};
+
+// A closed random walk, like a dense outline traced around an object
+QPolygon outline(int count, quint32 seed)
+{
+    QPolygon polygon(count);
+    int x = FrameWidth / 2;
+    int y = FrameHeight / 2;
+    for (int i = 0; i < count; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        x = qBound(0, x + int((seed >> 16) % 7) - 3, FrameWidth - 1);
+        y = qBound(0, y + int((seed >> 24) % 7) - 3, FrameHeight - 1);
+        polygon[i] = QPoint(x, y);
+    }
+    return polygon;
+}
+
+QString coordinate(int value, int index, Notation notation)
+{
+    double fraction = index % 2 == 0 ? 0.25 : -0.25;
+    switch (notation)
+    {
+    case Decimals:
+        return QString::number(value + fraction, 'f', 2);
+    case Exponents:
+        return QString::number(value + fraction, 'e', 6);
+    default:
+        return QString::number(value);
+    }
+}
+
+GeneratedFile generate(const char* name, Notation notation, const QPolygon& polygon)
+{
+    GeneratedFile file;
+    file.name = name;
+    file.notation = notation;
+    file.expected = polygon;
+
+    QStringList pairs;
+    pairs.reserve(polygon.size());
+    for (int i = 0; i < polygon.size(); i++)
+    {
+        pairs << coordinate(polygon[i].x(), i, notation) + QLatin1Char(',')
+                 + coordinate(polygon[i].y(), i + 1, notation);
+    }
+    file.points = pairs.join(QLatin1Char(' '));
+
+    file.document = QStringLiteral("<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%1\" height=\"%2\">\n"
+                                   "<polyline points=\"%3\"/>\n</svg>\n")
+            .arg(FrameWidth).arg(FrameHeight).arg(file.points).toUtf8();
+    return file;
+}
+
+// parsePoints as it was before it read the attribute in place, kept to
+// compare against. It only reads integers.
+QPolygon splitPoints(const QString& points)
+{
+    QPolygon contours;
+    QStringList list = points.split(' ', QString::SkipEmptyParts);
+    for (QString point : list)
+    {
+        QStringList coords = point.split(',');
+        if (coords.size() != 2)
+            continue;
+        contours.append(QPoint(coords[0].toInt(), coords[1].toInt()));
+    }
+    return contours;
+}
+
+// The path SvgParser::parseContours takes, without its success check
+ContoursParseResult parseDocument(const QByteArray& bytes)
+{
+    QXmlInputSource source;
+    source.setData(bytes);
+
+    QXmlSimpleReader xmlReader;
+    ContoursParser parser;
+    SvgXmlHandler handler(parser);
+    xmlReader.setContentHandler(&handler);
+    xmlReader.setErrorHandler(&handler);
+    xmlReader.parse(&source);
+    return parser.result();
+}
+
+ContoursParseResult parsePointsOnly(const QString& points)
+{
+    ContoursParser parser;
+    parser.parsePoints(points);
+    return parser.result();
+}
+
+// Median of the iterations, in milliseconds
+double timeMs(int iterations, const function<void ()>& run)
+{
+    run();
+    vector<double> times;
+    for (int n = 0; n < iterations; n++)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        run();
+        times.push_back(timer.nsecsElapsed() / 1e6);
+    }
+    sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+void printTime(const string& name, double ms, int bytes)
+{
+    cout << "  " << left << setw(30) << name << right << fixed << setprecision(2)
+         << setw(10) << ms << " ms" << setprecision(0)
+         << setw(8) << bytes / (ms / 1e3) / 1e6 << " MB/s" << endl;
+}
+
+bool check(const string& name, const ContoursParseResult& result, const QPolygon& expected)
+{
+    if (result.contours == expected && result.warnings == 0)
+        return true;
+
+    cout << "  " << name << ": " << result.contours.size() << " points, "
+         << result.warnings << " warnings, expected " << expected.size() << " points" << endl;
+    return false;
+}
+
+int droppedWarnings = 0;
+
+void dropWarnings(QtMsgType type, const QMessageLogContext& context, const QString& message)
+{
+    Q_UNUSED(type);
+    Q_UNUSED(context);
+    Q_UNUSED(message);
+    droppedWarnings++;
+}
+
+// Coordinates beyond int are clamped with a warning, malformed ones are skipped
+bool checkEdgeCases()
+{
+    struct EdgeCase
+    {
+        const char* points;
+        QPolygon expected;
+        int warnings;
+    };
+    const int limit = numeric_limits<int>::max();
+    const EdgeCase cases[] = {
+        { "1e300,-1e300", QPolygon() << QPoint(limit, -limit), 2 },
+        { "1e99999 -1e99999", QPolygon() << QPoint(limit, -limit), 2 },
+        { "2147483647,-2147483647.4", QPolygon() << QPoint(limit, -limit), 1 },
+        { "1.5e3,-2.5E-1", QPolygon() << QPoint(1500, 0), 0 },
+        { "1-2 .5.5", QPolygon() << QPoint(1, -2) << QPoint(1, 1), 0 },
+        { "1,2 x 3,4", QPolygon() << QPoint(1, 2) << QPoint(3, 4), 1 },
+    };
+
+    bool ok = true;
+    QtMessageHandler previous = qInstallMessageHandler(dropWarnings);
+    for (const EdgeCase& edge : cases)
+    {
+        ContoursParseResult result = parsePointsOnly(QString::fromLatin1(edge.points));
+        if (result.contours != edge.expected || result.warnings != edge.warnings)
+        {
+            qInstallMessageHandler(previous);
+            cout << "  \"" << edge.points << "\" gives " << result.contours.size()
+                 << " points and " << result.warnings << " warnings" << endl;
+            previous = qInstallMessageHandler(dropWarnings);
+            ok = false;
+        }
+    }
+    qInstallMessageHandler(previous);
+    return ok;
+}
+
+void usage()
+{
+    cout << "usage: svg_bench [--points N] [--iterations N] [--write DIR]" << endl
+         << "  Generates contour files of N points (default 200000) with integer," << endl
+         << "  decimal and exponent coordinates, checks that ContoursParser reads them" << endl
+         << "  back and prints the median time of parsePoints and of the whole file." << endl
+         << "  --write also saves the generated files to DIR." << endl;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--points" && i + 1 < argc)
+        {
+            options.points = max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--iterations" && i + 1 < argc)
+        {
+            options.iterations = max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--write" && i + 1 < argc)
+        {
+            options.writeDir = QString::fromLocal8Bit(argv[++i]);
+        }
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    bool ok = checkEdgeCases();
+    cout << "edge cases: " << (ok ? "ok" : "FAILED") << endl;
+
+    const QPolygon polygon = outline(options.points, 2017);
+    const vector<GeneratedFile> files = {
+        generate("integers", Integers, polygon),
+        generate("decimals", Decimals, polygon),
+        generate("exponents", Exponents, polygon),
+    };
+
+    for (const GeneratedFile& file : files)
+    {
+        cout << file.name << ": " << file.expected.size() << " points, "
+             << file.document.size() / 1024 << " KB" << endl;
+
+        if (!options.writeDir.isEmpty())
+        {
+            QFile out(QDir(options.writeDir).filePath(QStringLiteral("contours_%1.svg").arg(file.name)));
+            if (!out.open(QIODevice::WriteOnly) || out.write(file.document) != file.document.size())
+                cout << "  cannot write " << out.fileName().toStdString() << endl;
+        }
+
+        ok = check("parsePoints", parsePointsOnly(file.points), file.expected) && ok;
+        ok = check("file", parseDocument(file.document), file.expected) && ok;
+
+        const int pointBytes = file.points.size() * int(sizeof(QChar));
+        printTime("parsePoints", timeMs(options.iterations, [&]() {
+            parsePointsOnly(file.points);
+        }), pointBytes);
+
+        if (file.notation == Integers)
+        {
+            ok = (splitPoints(file.points) == file.expected) && ok;
+            printTime("parsePoints (split, toInt)", timeMs(options.iterations, [&]() {
+                splitPoints(file.points);
+            }), pointBytes);
+        }
+
+        printTime("file", timeMs(options.iterations, [&]() {
+            parseDocument(file.document);
+        }), file.document.size());
+    }
+
+    if (!ok)
+        cout << "FAILED" << endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,23 @@
+# Parses large generated contour files with ContoursParser and prints the time per file:
+#   svg_bench [--points N] [--iterations N] [--write DIR]
+# Returns non-zero when a parsed contour differs from the generated one.
+
+CONFIG   += c++11 console force_debug_info
+CONFIG   -= app_bundle
+
+QT = core gui xml
+
+TARGET = svg_bench
+TEMPLATE = app
+DESTDIR = $$PWD/../../build/svg_bench
+
+INCLUDEPATH += $$PWD/.. $$PWD/../Svg
+
+HEADERS += \
+    ../Svg/contours_parser.h \
+    ../Svg/svg_xml_handler.h \
+    ../Svg/svg_parse_result.h
+
+SOURCES += main.cpp \
+    ../Svg/contours_parser.cpp \
+    ../Svg/svg_xml_handler.cpp
@@ -22,6 +22,7 @@ public:
     Q_INVOKABLE explicit AbstractCommand(QObject *parent = 0) : QObject(parent)
     {
         m_bInWorkerThread = false;
+        m_bReusable = false;
     }
 
     virtual ~AbstractCommand()
@@ -47,6 +48,19 @@ public:
      * If it involves GUI classes creation, it MUST BE SET TO FALSE
      ***********************************************************************************************************************/
     ADD_CLASS_FIELD(bool, bInWorkerThread, getInWorkerThread, setInWorkerThread)
+
+     /**********************************************************************************************************************
+     @brief:  The resource (model, device, file...) this command touches.
+     * Commands of the same resource never run at the same time, commands of different resources may.
+     * Commands that leave it empty share one resource, they run one at a time like all commands used to.
+     ***********************************************************************************************************************/
+    ADD_CLASS_FIELD(QString, strResource, getResource, setResource)
+
+     /**********************************************************************************************************************
+     @brief:  execute() keeps no state between calls, so one instance may serve many requests, one at a time.
+     * The front controller then pools instances instead of creating one per request.
+     ***********************************************************************************************************************/
+    ADD_CLASS_FIELD(bool, bReusable, getReusable, setReusable)
 };
 
 #endif // ABSTRACTCOMMAND_H
@@ -25,6 +25,7 @@ HEADERS += \
     cmdevt.h \
     abstractcommand.h \
     cmdevt.h \
+    commandexecutor.h \
     def.h \
     event.h \
     eventbus.h \
@@ -42,6 +43,7 @@ SOURCES += \
     updateuievt.cpp \
     cmdevt.cpp \
     cmdevt.cpp \
+    commandexecutor.cpp \
     event.cpp \
     eventbus.cpp \
     eventparam.cpp \
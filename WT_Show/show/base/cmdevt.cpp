@@ -1,17 +1,19 @@
 #include "cmdevt.h"
 
+static const int s_nCommandNameKey = EventParam::internKey(QStringLiteral("command_name"));
+
 CmdEvt::CmdEvt(const QString& strCommandName) :
     Event(_EXE_COMMAND_REQUEST_EVENT)
 {
-    Event::setParameter("command_name", strCommandName);
+    getParameters().setParameter(s_nCommandNameKey, strCommandName);
 }
 
-QString CmdEvt::getCommandName()
+QString CmdEvt::getCommandName() const
 {
-    return Event::getParameter("command_name").toString();
+    return getParameters().getParameter(s_nCommandNameKey).toString();
 }
 
 void CmdEvt::setCommandName(const QString& strCommandName)
 {
-    Event::setParameter("command_name", strCommandName);
+    getParameters().setParameter(s_nCommandNameKey, strCommandName);
 }
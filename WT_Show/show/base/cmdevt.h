@@ -12,7 +12,7 @@ class CmdEvt : public Event
 public:
     CmdEvt(const QString& strCommandName);
 
-    QString getCommandName();
+    QString getCommandName() const;
     void setCommandName(const QString& strCommandName);
 };
 
@@ -0,0 +1,188 @@
+#include "commandexecutor.h"
+
+#include <QDebug>
+#include <QRunnable>
+#include <QThread>
+#include <cstring>
+
+/// commands executed between two statistics log lines
+static const quint64 s_nStatisticsLogInterval = 1000;
+
+namespace
+{
+class LaneRunnable : public QRunnable
+{
+public:
+    explicit LaneRunnable(const std::function<void ()>& run) : m_run(run) {}
+    void run() override { m_run(); }
+
+private:
+    std::function<void ()> m_run;
+};
+}
+
+CommandExecutor::CommandExecutor()
+{
+    m_nMaxPending = 1000;
+    m_nPending = 0;
+    m_nExecuted = 0;
+    m_cPool.setMaxThreadCount(QThread::idealThreadCount());
+    m_cClock.start();
+}
+
+CommandExecutor::~CommandExecutor()
+{
+    waitForDone();
+}
+
+void CommandExecutor::submit(const QString& strResource, const QString& strCommandClass, const CommandTask& task)
+{
+    QMutexLocker cLocker(&m_cMutex);
+    if( m_nPending >= m_nMaxPending )
+    {
+        qWarning() << "Too Many Commands Pending...Waiting...";
+        while( m_nPending >= m_nMaxPending )
+            m_cNotFull.wait(&m_cMutex);
+        qWarning() << "Command Queue Not Full...Moving on...";
+    }
+
+    QSharedPointer<Lane> pcLane = xLane(strResource);
+
+    PendingCommand cCommand;
+    cCommand.strCommandClass = strCommandClass;
+    cCommand.task = task;
+    cCommand.nQueuedAtUs = xNowUs();
+    cCommand.nQueueDepth = pcLane->cPending.size();
+    pcLane->cPending.enqueue(cCommand);
+    m_nPending++;
+
+    if( !pcLane->bScheduled )
+    {
+        pcLane->bScheduled = true;
+        xSchedule(pcLane);
+    }
+}
+
+void CommandExecutor::runHere(const QString& strResource, const QString& strCommandClass, const CommandTask& task)
+{
+    QSharedPointer<Lane> pcLane;
+    {
+        QMutexLocker cLocker(&m_cMutex);
+        pcLane = xLane(strResource);
+    }
+
+    qint64 nWaitUs = 0;
+    qint64 nExecUs = 0;
+    {
+        const qint64 nArrivedUs = xNowUs();
+        QMutexLocker cRunLocker(&pcLane->cRunMutex);
+        const qint64 nStartUs = xNowUs();
+        nWaitUs = nStartUs - nArrivedUs;
+        task();
+        nExecUs = xNowUs() - nStartUs;
+    }
+
+    QMutexLocker cLocker(&m_cMutex);
+    xRecord(strCommandClass, 0, nWaitUs, nExecUs);
+}
+
+QHash<QString, CommandStatistics> CommandExecutor::getStatistics() const
+{
+    QMutexLocker cLocker(&m_cMutex);
+    return m_cStatistics;
+}
+
+void CommandExecutor::logStatistics() const
+{
+    QHash<QString, CommandStatistics> cStatistics = getStatistics();
+    for( QHash<QString, CommandStatistics>::const_iterator i = cStatistics.constBegin(); i != cStatistics.constEnd(); ++i )
+    {
+        const CommandStatistics& rcStat = i.value();
+        const quint64 nCount = qMax<quint64>(1, rcStat.nExecuted);
+        qDebug() << QString("%1: %2 executed, wait avg %3 max %4 us, exec avg %5 max %6 us, queue depth max %7")
+                    .arg(i.key()).arg(rcStat.nExecuted)
+                    .arg(rcStat.nTotalWaitUs / nCount).arg(rcStat.nMaxWaitUs)
+                    .arg(rcStat.nTotalExecUs / nCount).arg(rcStat.nMaxExecUs)
+                    .arg(rcStat.nMaxQueueDepth);
+    }
+}
+
+void CommandExecutor::waitForDone()
+{
+    m_cPool.waitForDone();
+}
+
+QSharedPointer<CommandExecutor::Lane> CommandExecutor::xLane(const QString& strResource)
+{
+    QSharedPointer<Lane>& pcLane = m_cLanes[strResource];
+    if( pcLane.isNull() )
+        pcLane = QSharedPointer<Lane>::create();
+    return pcLane;
+}
+
+void CommandExecutor::xSchedule(const QSharedPointer<Lane>& pcLane)
+{
+    m_cPool.start(new LaneRunnable([this, pcLane]() { xRunNext(pcLane); }));
+}
+
+void CommandExecutor::xRunNext(const QSharedPointer<Lane>& pcLane)
+{
+    PendingCommand cCommand;
+    {
+        QMutexLocker cLocker(&m_cMutex);
+        cCommand = pcLane->cPending.dequeue();
+    }
+
+    /// a main-thread command of the same resource may hold the lane, that time is waiting too
+    qint64 nStartUs = 0;
+    qint64 nExecUs = 0;
+    {
+        QMutexLocker cRunLocker(&pcLane->cRunMutex);
+        nStartUs = xNowUs();
+        cCommand.task();
+        nExecUs = xNowUs() - nStartUs;
+    }
+
+    bool bLogStatistics = false;
+    {
+        QMutexLocker cLocker(&m_cMutex);
+        m_nPending--;
+        xRecord(cCommand.strCommandClass, cCommand.nQueueDepth, nStartUs - cCommand.nQueuedAtUs, nExecUs);
+        bLogStatistics = m_nExecuted % s_nStatisticsLogInterval == 0;
+
+        /// one command per pool slot, so a busy resource cannot starve the others
+        if( pcLane->cPending.isEmpty() )
+            pcLane->bScheduled = false;
+        else
+            xSchedule(pcLane);
+    }
+    m_cNotFull.wakeAll();
+
+    if( bLogStatistics )
+        logStatistics();
+}
+
+void CommandExecutor::xRecord(const QString& strCommandClass, int nQueueDepth, qint64 nWaitUs, qint64 nExecUs)
+{
+    QHash<QString, CommandStatistics>::iterator i = m_cStatistics.find(strCommandClass);
+    if( i == m_cStatistics.end() )
+    {
+        CommandStatistics cEmpty;
+        memset(&cEmpty, 0, sizeof(cEmpty));
+        i = m_cStatistics.insert(strCommandClass, cEmpty);
+    }
+
+    CommandStatistics& rcStat = i.value();
+    rcStat.nExecuted++;
+    rcStat.nMaxQueueDepth = qMax(rcStat.nMaxQueueDepth, nQueueDepth);
+    rcStat.nTotalWaitUs += nWaitUs;
+    rcStat.nMaxWaitUs = qMax(rcStat.nMaxWaitUs, nWaitUs);
+    rcStat.nTotalExecUs += nExecUs;
+    rcStat.nMaxExecUs = qMax(rcStat.nMaxExecUs, nExecUs);
+    m_nExecuted++;
+}
+
+qint64 CommandExecutor::xNowUs() const
+{
+    return m_cClock.nsecsElapsed() / 1000;
+}
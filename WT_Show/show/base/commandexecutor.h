@@ -0,0 +1,86 @@
+#ifndef COMMANDEXECUTOR_H
+#define COMMANDEXECUTOR_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QQueue>
+#include <QSharedPointer>
+#include <QString>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <functional>
+#include "def.h"
+
+typedef std::function<void ()> CommandTask;
+
+struct CommandStatistics
+{
+    quint64 nExecuted;
+    int nMaxQueueDepth;     ///< most commands of the same resource found waiting ahead of one
+    qint64 nTotalWaitUs;    ///< queued or blocked until it could start
+    qint64 nMaxWaitUs;
+    qint64 nTotalExecUs;
+    qint64 nMaxExecUs;
+};
+
+ /**********************************************************************************************************************
+ @brief: The CommandExecutor class
+ *  Runs commands on a thread pool. Every command names the resource it touches: commands of the same resource
+ *  run one at a time, in the order they were submitted, commands of different resources run in parallel.
+ *  Queue depth, wait and execution time are recorded per command class.
+ ***********************************************************************************************************************/
+class CommandExecutor
+{
+public:
+    CommandExecutor();
+    ~CommandExecutor();
+
+    /// queue a command for the pool, blocks while getMaxPending() commands are already waiting
+    void submit(const QString& strResource, const QString& strCommandClass, const CommandTask& task);
+
+    /// run a command in the calling thread, still exclusive with the pool commands of its resource
+    void runHere(const QString& strResource, const QString& strCommandClass, const CommandTask& task);
+
+    QHash<QString, CommandStatistics> getStatistics() const;
+    void logStatistics() const;
+
+    void waitForDone();
+
+private:
+    struct PendingCommand
+    {
+        QString strCommandClass;
+        CommandTask task;
+        qint64 nQueuedAtUs;
+        int nQueueDepth;
+    };
+
+    /// commands of one resource
+    struct Lane
+    {
+        Lane() : cRunMutex(QMutex::Recursive), bScheduled(false) {}
+
+        QMutex cRunMutex;           ///< held while one of its commands runs, recursive like the old global lock
+        QQueue<PendingCommand> cPending;
+        bool bScheduled;            ///< a pool thread is about to run the head of cPending
+    };
+
+    QSharedPointer<Lane> xLane(const QString& strResource);
+    void xSchedule(const QSharedPointer<Lane>& pcLane);
+    void xRunNext(const QSharedPointer<Lane>& pcLane);
+    void xRecord(const QString& strCommandClass, int nQueueDepth, qint64 nWaitUs, qint64 nExecUs);
+    qint64 xNowUs() const;
+
+    ADD_CLASS_FIELD(int, nMaxPending, getMaxPending, setMaxPending)
+    ADD_CLASS_FIELD_PRIVATE(QThreadPool, cPool)
+    ADD_CLASS_FIELD_PRIVATE(mutable QMutex, cMutex)    ///< guards lanes, pending count and statistics
+    ADD_CLASS_FIELD_PRIVATE(QWaitCondition, cNotFull)
+    ADD_CLASS_FIELD_PRIVATE(CONCATE(QHash<QString, QSharedPointer<Lane>>), cLanes)
+    ADD_CLASS_FIELD_PRIVATE(int, nPending)
+    ADD_CLASS_FIELD_PRIVATE(quint64, nExecuted)
+    ADD_CLASS_FIELD_PRIVATE(CONCATE(QHash<QString, CommandStatistics>), cStatistics)
+    ADD_CLASS_FIELD_PRIVATE(QElapsedTimer, cClock)
+};
+
+#endif // COMMANDEXECUTOR_H
@@ -6,19 +6,25 @@
 
 Event::Event( const QString& strEvtName )
 {
-    this->m_strEvtName = strEvtName;
+    setEvtName(strEvtName);
     static struct Initialize
     {
         Initialize() 
         {
-            qRegisterMetaType<QSharedPointer<Event>>("QSharedPointer<Event>");
+            qRegisterMetaType<QSharedPointer<const Event>>("QSharedPointer<const Event>");
         }
     } initialize;
 }
 
 Event::Event()
 {
-    this->m_strEvtName = "UNKNOWN";
+    setEvtName("UNKNOWN");
+}
+
+void Event::setEvtName(const QString& strEvtName)
+{
+    m_strEvtName = strEvtName;
+    m_nTopic = EventBus::internTopic(strEvtName);
 }
 
 bool Event::hasParameter(QString strParam) const
@@ -2,7 +2,6 @@
 #define EVENT_H
 
 #include <QString>
-#include <QMap>
 #include <QVariant>
 #include <QSharedPointer>
 #include "def.h"
@@ -16,6 +15,8 @@ class EventBus;
  *  If you want to create an custom event by inherit Event, you MUST re implement the 'clone' method in this class.
  *  This can be done by adding VIRTUAL_COPY_PATTERN(subclass name) in the subclass. 
  *  Otherwise the application may crash.
+ *  Posted events are immutable: modules in the posting thread get the posted object itself, modules in other
+ *  threads share one copy through a QSharedPointer<const Event>.
  ***********************************************************************************************************************/
 class Event
 {
@@ -32,11 +33,14 @@ public:
     bool setParameter(const QString& strParam, const QVariant& rvValue);
     void dispatch(EventBus *pcEventBus = nullptr) const;
 
+    void setEvtName(const QString& strEvtName);
+
 protected:
-    ADD_CLASS_FIELD(QString, strEvtName, getEvtName, setEvtName) 
+    ADD_CLASS_FIELD_NOSETTER(QString, strEvtName, getEvtName)
+    ADD_CLASS_FIELD_NOSETTER(int, nTopic, getTopic)     ///< interned event name, see EventBus::internTopic
     ADD_CLASS_FIELD_NOSETTER(EventParam, cParameters, getParameters)
 };
 
-Q_DECLARE_METATYPE(QSharedPointer<Event>)
+Q_DECLARE_METATYPE(QSharedPointer<const Event>)
 
 #endif // EVENT_H
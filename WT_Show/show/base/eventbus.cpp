@@ -1,9 +1,12 @@
 #include "eventbus.h"
+#include "moduledelegate.h"
 #include <QDebug>
+#include <QHash>
+#include <QThread>
 
 SINGLETON_PATTERN_IMPLIMENT(EventBus)
 
-EventBus::EventBus()
+EventBus::EventBus() : m_nPosts(0), m_nDeliveries(0), m_nClones(0)
 {
 }
 
@@ -14,22 +17,117 @@ EventBus *EventBus::create()
 
 bool EventBus::registerModule(ModuleDelegate* pModule)
 {
-    connect(this, SIGNAL(eventTriggered(QSharedPointer<Event>) ),
-            pModule, SLOT(fire(QSharedPointer<Event>) ),
-            Qt::AutoConnection );
+    foreach(int nTopic, pModule->getTopics())
+        subscribe(pModule, nTopic);
     return true;
 }
 
 bool EventBus::unregisterModule(ModuleDelegate *pcModule)
 {
-    return disconnect(this, nullptr, pcModule, nullptr);
+    bool bRemoved = false;
+    QWriteLocker cLocker(&m_cSubscribersLock);
+    for(int i = 0; i < m_cSubscribers.size(); i++)
+        bRemoved |= m_cSubscribers[i].removeAll(pcModule) > 0;
+    return bRemoved;
+}
+
+bool EventBus::subscribe(ModuleDelegate *pcModule, int nTopic)
+{
+    QWriteLocker cLocker(&m_cSubscribersLock);
+    if( nTopic >= m_cSubscribers.size() )
+        m_cSubscribers.resize(nTopic + 1);
+
+    QVector<QPointer<ModuleDelegate>>& rcTopicSubscribers = m_cSubscribers[nTopic];
+    if( rcTopicSubscribers.contains(pcModule) )
+        return false;
+    rcTopicSubscribers.append(pcModule);
+    return true;
+}
+
+bool EventBus::unsubscribe(ModuleDelegate *pcModule, int nTopic)
+{
+    QWriteLocker cLocker(&m_cSubscribersLock);
+    if( nTopic < 0 || nTopic >= m_cSubscribers.size() )
+        return false;
+    return m_cSubscribers[nTopic].removeAll(pcModule) > 0;
+}
+
+int EventBus::internTopic(const QString& strEvtName)
+{
+    static QHash<QString, int> s_cTopics;
+    static QReadWriteLock s_cTopicsLock;
+
+    {
+        QReadLocker cReadLocker(&s_cTopicsLock);
+        QHash<QString, int>::const_iterator i = s_cTopics.constFind(strEvtName);
+        if( i != s_cTopics.constEnd() )
+            return i.value();
+    }
+
+    QWriteLocker cWriteLocker(&s_cTopicsLock);
+    QHash<QString, int>::iterator i = s_cTopics.find(strEvtName);
+    if( i == s_cTopics.end() )
+        i = s_cTopics.insert(strEvtName, s_cTopics.size());
+    return i.value();
 }
 
 void EventBus::post(const Event& rcEvt) const
-{    
-    QSharedPointer<Event> pcEvtCopy( rcEvt.clone() );
+{
+    m_nPosts.fetchAndAddRelaxed(1);
+
+    /// modules in this thread get the posted event itself, the others share one copy made on demand
+    QSharedPointer<const Event> pcEvtCopy;
+    foreach(const QPointer<ModuleDelegate>& pcModule, xSubscribersOf(rcEvt.getTopic()))
+    {
+        if( pcModule.isNull() )
+            continue;
+
+        m_nDeliveries.fetchAndAddRelaxed(1);
+        if( pcModule->thread() == QThread::currentThread() )
+        {
+            pcModule->fire(rcEvt);
+        }
+        else
+        {
+            if( pcEvtCopy.isNull() )
+            {
+                pcEvtCopy = QSharedPointer<const Event>( rcEvt.clone() );
+                m_nClones.fetchAndAddRelaxed(1);
+            }
+            xQueue(pcModule.data(), pcEvtCopy);
+        }
+    }
+}
+
+void EventBus::post(const QSharedPointer<const Event>& pcEvt) const
+{
+    m_nPosts.fetchAndAddRelaxed(1);
 
-    /// notify modules
-    emit eventTriggered(pcEvtCopy);
+    foreach(const QPointer<ModuleDelegate>& pcModule, xSubscribersOf(pcEvt->getTopic()))
+    {
+        if( pcModule.isNull() )
+            continue;
+
+        m_nDeliveries.fetchAndAddRelaxed(1);
+        if( pcModule->thread() == QThread::currentThread() )
+            pcModule->fire(*pcEvt);
+        else
+            xQueue(pcModule.data(), pcEvt);
+    }
+}
+
+QVector<QPointer<ModuleDelegate>> EventBus::xSubscribersOf(int nTopic) const
+{
+    /// implicitly shared copy, handlers may (un)subscribe while it is delivered
+    QReadLocker cLocker(&m_cSubscribersLock);
+    if( nTopic >= 0 && nTopic < m_cSubscribers.size() )
+        return m_cSubscribers[nTopic];
+    return QVector<QPointer<ModuleDelegate>>();
 }
 
+void EventBus::xQueue(ModuleDelegate *pcModule, const QSharedPointer<const Event>& pcEvt) const
+{
+    /// same rule as Qt::AutoConnection: other threads get it through their event loop
+    QMetaObject::invokeMethod(pcModule, "fire", Qt::QueuedConnection,
+                              Q_ARG(QSharedPointer<const Event>, pcEvt));
+}
@@ -5,12 +5,23 @@
 #include <QObject>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QPointer>
+#include <QReadWriteLock>
 #include <QSharedPointer>
+#include <QVector>
+#include <QAtomicInteger>
 #include "def.h"
 #include "event.h"
 #include "module.h"
 
 class ModuleDelegate;
+
+ /**********************************************************************************************************************
+ @brief: The EventBus class
+ *  Routes every posted event to the modules subscribed to its name, and only to those.
+ *  Event names are interned to integer topic ids, the bus keeps one subscriber list per topic.
+ *  Modules living in the posting thread are called directly, others through their event loop.
+ ***********************************************************************************************************************/
 class EventBus : public QObject
 {
     Q_OBJECT
@@ -22,11 +33,33 @@ public:
     bool registerModule(ModuleDelegate *pcModule);
     bool unregisterModule(ModuleDelegate *pcModule);
 
+    bool subscribe(ModuleDelegate *pcModule, int nTopic);
+    bool unsubscribe(ModuleDelegate *pcModule, int nTopic);
+
+    /// topic id of an event name, the same name always gets the same id
+    static int internTopic(const QString& strEvtName);
+
+    /// events posted and handler calls made, deliveries / posts is the average fan out
+    quint64 getPostCount() const { return m_nPosts.load(); }
+    quint64 getDeliveryCount() const { return m_nDeliveries.load(); }
+    /// events copied because a subscriber lives in another thread, 0 when all are in the posting thread
+    quint64 getCloneCount() const { return m_nClones.load(); }
+
+    /// posts an event that is already shared, it is never copied
+    void post(const QSharedPointer<const Event>& pcEvt) const;
+
 public slots:
     void post(const Event &rcEvt) const;
 
-signals:
-    void eventTriggered( QSharedPointer<Event> pcEvt ) const;
+private:
+    QVector<QPointer<ModuleDelegate>> xSubscribersOf(int nTopic) const;
+    void xQueue(ModuleDelegate *pcModule, const QSharedPointer<const Event>& pcEvt) const;
+
+    ADD_CLASS_FIELD_PRIVATE( CONCATE(QVector<QVector<QPointer<ModuleDelegate>>>), cSubscribers )  ///< indexed by topic id
+    ADD_CLASS_FIELD_PRIVATE( mutable QReadWriteLock, cSubscribersLock )
+    ADD_CLASS_FIELD_PRIVATE( mutable QAtomicInteger<quint64>, nPosts )
+    ADD_CLASS_FIELD_PRIVATE( mutable QAtomicInteger<quint64>, nDeliveries )
+    ADD_CLASS_FIELD_PRIVATE( mutable QAtomicInteger<quint64>, nClones )
 
     SINGLETON_PATTERN_DECLARE(EventBus)
 };
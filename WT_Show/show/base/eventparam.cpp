@@ -1,31 +1,122 @@
 #include "eventparam.h"
 #include <QDebug>
+#include <QHash>
+#include <QReadWriteLock>
+#include <QAtomicInteger>
+
+static QAtomicInteger<quint64> s_nHeapSpills(0);
 
 EventParam::EventParam()
 {
 }
 
-bool EventParam::hasParameter(QString strParam) const
+EventParam::EventParam(const EventParam& rcOther) :
+    m_cParameters(rcOther.m_cParameters)
 {
-    return m_cParameters.contains(strParam);
+    if( m_cParameters.size() > InlineParameterCount )
+        xCountSpill();
 }
 
-QVariant EventParam::getParameter(const QString& strParam ) const
+EventParam& EventParam::operator=(const EventParam& rcOther)
+{
+    m_cParameters = rcOther.m_cParameters;
+    if( m_cParameters.size() > InlineParameterCount )
+        xCountSpill();
+    return *this;
+}
+
+int EventParam::internKey(const QString& strParam)
 {
-    QVariant rvValue;
-    if( m_cParameters.contains(strParam) )
+    static QHash<QString, int> s_cKeys;
+    static QReadWriteLock s_cKeysLock;
+
     {
-        rvValue = m_cParameters[strParam];
+        QReadLocker cReadLocker(&s_cKeysLock);
+        QHash<QString, int>::const_iterator i = s_cKeys.constFind(strParam);
+        if( i != s_cKeys.constEnd() )
+            return i.value();
     }
-    else
+
+    QWriteLocker cWriteLocker(&s_cKeysLock);
+    QHash<QString, int>::iterator i = s_cKeys.find(strParam);
+    if( i == s_cKeys.end() )
+        i = s_cKeys.insert(strParam, s_cKeys.size());
+    return i.value();
+}
+
+bool EventParam::hasParameter(QString strParam) const
+{
+    return hasParameter(internKey(strParam));
+}
+
+QVariant EventParam::getParameter(const QString& strParam ) const
+{
+    const Entry* pcEntry = xFind(internKey(strParam));
+    if( pcEntry == nullptr )
     {
         qWarning() << QString("Parameter %1 NOT found.").arg(strParam);
+        return QVariant();
     }
-    return rvValue;
+    return pcEntry->vValue;
 }
 
 bool EventParam::setParameter(const QString& strParam, const QVariant& rvValue)
 {
-    m_cParameters[strParam] = rvValue;
+    return setParameter(internKey(strParam), rvValue);
+}
+
+bool EventParam::hasParameter(int nKey) const
+{
+    return xFind(nKey) != nullptr;
+}
+
+QVariant EventParam::getParameter(int nKey) const
+{
+    const Entry* pcEntry = xFind(nKey);
+    if( pcEntry == nullptr )
+    {
+        qWarning() << QString("Parameter key %1 NOT found.").arg(nKey);
+        return QVariant();
+    }
+    return pcEntry->vValue;
+}
+
+bool EventParam::setParameter(int nKey, const QVariant& rvValue)
+{
+    Entry* pcEntry = const_cast<Entry*>(xFind(nKey));
+    if( pcEntry != nullptr )
+    {
+        pcEntry->vValue = rvValue;
+        return true;
+    }
+
+    if( m_cParameters.size() == InlineParameterCount )
+        xCountSpill();
+
+    Entry cEntry;
+    cEntry.nKey = nKey;
+    cEntry.vValue = rvValue;
+    m_cParameters.append(cEntry);
     return true;
 }
+
+quint64 EventParam::getHeapSpillCount()
+{
+    return s_nHeapSpills.load();
+}
+
+const EventParam::Entry* EventParam::xFind(int nKey) const
+{
+    /// a handful of entries, a linear scan beats any lookup structure
+    for( int i = 0; i < m_cParameters.size(); i++ )
+    {
+        if( m_cParameters[i].nKey == nKey )
+            return &m_cParameters[i];
+    }
+    return nullptr;
+}
+
+void EventParam::xCountSpill()
+{
+    s_nHeapSpills.fetchAndAddRelaxed(1);
+}
@@ -2,20 +2,52 @@
 #define EVENTPARAM_H
 
 #include <QString>
-#include <QMap>
 #include <QVariant>
+#include <QVarLengthArray>
 #include "def.h"
 
+ /**********************************************************************************************************************
+ @brief: The EventParam class
+ *  Parameters of an event. Names are interned to integer keys, and up to InlineParameterCount parameters are
+ *  stored inside the object, so building and copying the usual small parameter lists allocates nothing
+ *  besides what the QVariant values themselves share.
+ ***********************************************************************************************************************/
 class EventParam
 {
 public:
+    enum { InlineParameterCount = 6 };
+
     EventParam();
+    EventParam(const EventParam& rcOther);
+    EventParam& operator=(const EventParam& rcOther);
+
+    /// key of a parameter name, the same name always gets the same key
+    static int internKey(const QString& strParam);
 
     bool hasParameter(QString strParam) const;
     QVariant getParameter(const QString& strParam ) const;
     bool setParameter(const QString& strParam, const QVariant& rvValue);
 
-    ADD_CLASS_FIELD_PRIVATE( CONCATE(QMap<QString,QVariant>), cParameters)
+    bool hasParameter(int nKey) const;
+    QVariant getParameter(int nKey) const;
+    bool setParameter(int nKey, const QVariant& rvValue);
+
+    int size() const { return m_cParameters.size(); }
+
+    /// parameter lists that outgrew the inline storage and went to the heap, process wide
+    static quint64 getHeapSpillCount();
+
+private:
+    struct Entry
+    {
+        int nKey;
+        QVariant vValue;
+    };
+
+    const Entry* xFind(int nKey) const;
+    static void xCountSpill();
+
+    ADD_CLASS_FIELD_PRIVATE( CONCATE(QVarLengthArray<Entry, InlineParameterCount>), cParameters)
 };
 
 #endif // EVENTPARAM_H
@@ -2,119 +2,99 @@
 #include "abstractcommand.h"
 
 #include <QSharedPointer>
+#include <QMutexLocker>
+#include <QThread>
 #include <QDebug>
 #include <iostream>
 #include "updateuievt.h"
 
 SINGLETON_PATTERN_IMPLIMENT(FrontController)
 
-FrontController::FrontController() : m_cmdExeMutex(QMutex::Recursive)
+FrontController::FrontController()
 {
-    m_nMaxEvtInQue = 1000;
     subscribeToEvtByName(_EXE_COMMAND_REQUEST_EVENT, MAKE_CALLBACK(FrontController::fire));
-    this->start();
 }
 
-bool FrontController::fire( Event& evt )
+bool FrontController::fire( const Event& evt )
 {
-    CmdEvt& rcCmdRequestEvt = dynamic_cast<CmdEvt&>(evt);
+    const CmdEvt& rcCmdRequestEvt = dynamic_cast<const CmdEvt&>(evt);
     QString strCommandName = rcCmdRequestEvt.getCommandName();
-    QHash<QString, QMetaObject*>::iterator i = m_commandTable.find(strCommandName);
+    QHash<QString, CommandClassInfo>::const_iterator i = m_commandTable.constFind(strCommandName);
 
     //command not found
-    if( i == m_commandTable.end() )
+    if( i == m_commandTable.constEnd() )
     {
         qWarning() << QString("No matched command name found. %1").arg(strCommandName);
         return true;
     }
 
-    //create command
-    const QMetaObject* pMetaObj = i.value();
-    QObject* pObj = pMetaObj->newInstance();
-
-    //if fail to create command class
-    if(pObj == nullptr)
-    {
-        qCritical() << QString("Unable to create command class '%1'! Please ensure the constructor have Q_INVOKABLE macro.")
-                    .arg(pMetaObj->className());
-        return true;
-    }
-
-    QSharedPointer<AbstractCommand> pCmd(static_cast<AbstractCommand *>(pObj));
+    /// thread and resource were resolved at registration, nothing is created here
+    const CommandClassInfo& rcInfo = i.value();
 
     /// execute it in worker thread or main(GUI) thread
-    if(pCmd->getInWorkerThread() == false)
+    if(rcInfo.m_bInWorkerThread == false)
     {
-        onCommandRequestArrive(rcCmdRequestEvt);
+        m_cExecutor.runHere(rcInfo.m_strResource, rcInfo.m_strClassName, [&]()
+        {
+            onCommandRequestArrive(rcCmdRequestEvt);
+        });
     }
     else
     {
-        /// pending for worker thread execution
-        m_evtQueMutex.lock();
-        if( m_pWorkerThreadEvtQue.size() >= m_nMaxEvtInQue )
+        /// pending for worker thread execution, the posted event does not outlive this call
+        QSharedPointer<const CmdEvt> pcEvtCopy(static_cast<CmdEvt*>(rcCmdRequestEvt.clone()));
+        m_cExecutor.submit(rcInfo.m_strResource, rcInfo.m_strClassName, [this, pcEvtCopy]()
         {
-            qWarning() << "Too Many Events Pending...Waiting...";
-            m_evtQueNotFull.wait(&m_evtQueMutex);
-            qWarning() << "Event Queue Not Full...Moving on...";
-        }
-        m_pWorkerThreadEvtQue.push_back(evt.clone());
-        m_evtQueMutex.unlock();
-        m_evtQueNotEmpty.wakeAll();
+            onCommandRequestArrive(*pcEvtCopy);
+        });
     }
 
     return true;
 }
 
-void FrontController::onCommandRequestArrive( CmdEvt& evt )
+void FrontController::onCommandRequestArrive( const CmdEvt& evt )
 {
-    QMutexLocker cCmdExeMutexLocker(&m_cmdExeMutex);
     UpdateUIEvt refreshUIEvt;
-    CommandParameter& request = evt.getParameters();
+    /// commands may write to their input, they get their own copy of the posted, immutable parameters
+    CommandParameter request = evt.getParameters();
     CommandParameter& respond = refreshUIEvt.getParameters();
 
     // find command by name
     QString strCommandName = evt.getCommandName();
-    respond.setParameter("command_name", strCommandName);
-    QHash<QString, QMetaObject*>::iterator iter = m_commandTable.find(strCommandName);
-    if( iter != m_commandTable.end() )
-    {
-        //command name matched
-        //create  command
-        const QMetaObject* pMetaObj = iter.value();
-        QObject* pObj = pMetaObj->newInstance();
-        //if fail to create command class
-        if(pObj == nullptr)
-        {
-            qCritical() << QString("Unable to create command class '%1'! Please ensure the constructor have Q_INVOKABLE macro.")
-                        .arg(pMetaObj->className());
-            return;
-        }
-        QSharedPointer<AbstractCommand> pCmd(static_cast<AbstractCommand *>(pObj));
-        //execute command
-        if( pCmd->execute(request, respond) == false )
-        {
-            qDebug() << QString("%1 Execution Failed!").arg(pMetaObj->className());
-        }
-        else
-        {
-            refreshUIEvt.dispatch();
-            qDebug() << QString("%1 Execution Success!").arg(pMetaObj->className());
-        }
+    refreshUIEvt.setCommandName(strCommandName);
+    QHash<QString, CommandClassInfo>::const_iterator iter = m_commandTable.constFind(strCommandName);
+    if( iter == m_commandTable.constEnd() )
+    {
+        qWarning() << QString("No matched command name found. %1").arg(strCommandName);
         return;
+    }
 
+    /// a copy, it keeps the pool alive even if the table is cleared meanwhile
+    const CommandClassInfo cInfo = iter.value();
+    AbstractCommand* pcCmd = xAcquireCommand(cInfo);
+    //if fail to create command class
+    if(pcCmd == nullptr)
+    {
+        qCritical() << QString("Unable to create command class '%1'!").arg(cInfo.m_strClassName);
+        return;
     }
-    qWarning() << QString("No matched command name found. %1").arg(strCommandName);
-    return;
-}
 
-bool FrontController::registerCommand(const QString& cCommandName, const QMetaObject * pMetaObject)
-{
-    if(m_commandTable.contains(cCommandName))
+    //execute command
+    bool bSuccess = pcCmd->execute(request, respond);
+    xReleaseCommand(cInfo, pcCmd);
+    if( bSuccess == false )
     {
-        qCritical() << QString("%1 Register Fail! Duplicated command name!").arg(cCommandName);
-        return false;
+        qDebug() << QString("%1 Execution Failed!").arg(cInfo.m_strClassName);
     }
+    else
+    {
+        refreshUIEvt.dispatch();
+        qDebug() << QString("%1 Execution Success!").arg(cInfo.m_strClassName);
+    }
+}
 
+bool FrontController::registerCommand(const QString& cCommandName, const QMetaObject * pMetaObject)
+{
     QString strAbsCmdClassName = AbstractCommand::staticMetaObject.className();
     if( pMetaObject->className() == strAbsCmdClassName )
     {
@@ -124,37 +104,97 @@ bool FrontController::registerCommand(const QString& cCommandName, const QMetaOb
         return false;
     }
 
-    QMetaObject* p = const_cast<QMetaObject*>(pMetaObject);
-    m_commandTable.insert(cCommandName, p);
-    qDebug() << QString("%1 Register Success!").arg(pMetaObject->className());
-    return true;
+    return xRegisterCommand(cCommandName, pMetaObject->className(), [pMetaObject]() -> AbstractCommand*
+    {
+        return static_cast<AbstractCommand*>(pMetaObject->newInstance());
+    });
 }
 
-void FrontController::unregisterAllCommand()
+bool FrontController::xRegisterCommand(const QString& strCommandName, const QString& strClassName, const CommandFactory& pfCreate)
 {
-    m_commandTable.clear();
+    if(m_commandTable.contains(strCommandName))
+    {
+        qCritical() << QString("%1 Register Fail! Duplicated command name!").arg(strCommandName);
+        return false;
+    }
+
+    /// one probe instance tells thread affinity and resource for every later request
+    AbstractCommand* pcProbe = pfCreate();
+    if(pcProbe == nullptr)
+    {
+        qCritical() << QString("Unable to create command class '%1'! Please ensure the constructor have Q_INVOKABLE macro.")
+                    .arg(strClassName);
+        return false;
+    }
+    m_nInstanceCount.fetchAndAddRelaxed(1);
+
+    CommandClassInfo cInfo;
+    cInfo.m_strClassName = strClassName;
+    cInfo.m_pfCreate = pfCreate;
+    cInfo.m_bInWorkerThread = pcProbe->getInWorkerThread();
+    cInfo.m_strResource = pcProbe->getResource();
+    if( pcProbe->getReusable() )
+    {
+        /// the probe becomes the first pooled instance
+        pcProbe->moveToThread(nullptr);
+        cInfo.m_pcPool.reset(new CommandPool);
+        cInfo.m_pcPool->m_cIdle.append(pcProbe);
+    }
+    else
+    {
+        delete pcProbe;
+    }
+
+    m_commandTable.insert(strCommandName, cInfo);
+    qDebug() << QString("%1 Register Success!").arg(strClassName);
+    return true;
 }
 
-void FrontController::run()
+AbstractCommand* FrontController::xAcquireCommand(const CommandClassInfo& rcInfo)
 {
-    forever
+    if( rcInfo.m_pcPool )
     {
-        /// get one event from the waiting queue
-        m_evtQueMutex.lock();
-        if( m_pWorkerThreadEvtQue.empty() )
+        AbstractCommand* pcIdle = nullptr;
         {
-            m_evtQueNotEmpty.wait(&m_evtQueMutex);
+            QMutexLocker cLocker(&rcInfo.m_pcPool->m_cMutex);
+            if( !rcInfo.m_pcPool->m_cIdle.isEmpty() )
+                pcIdle = rcInfo.m_pcPool->m_cIdle.takeLast();
         }
-        Event* pcEvt = m_pWorkerThreadEvtQue.front();
-        m_pWorkerThreadEvtQue.pop_front();
-        m_evtQueMutex.unlock();
-        m_evtQueNotFull.wakeAll();
-
-        /// execute command
-        CmdEvt& rcCmdRequestEvt = dynamic_cast<CmdEvt&>(*pcEvt);
-        onCommandRequestArrive(rcCmdRequestEvt);
-        delete pcEvt;
+        if( pcIdle )
+        {
+            /// idle instances belong to no thread, so the executing thread may pull it in
+            pcIdle->moveToThread(QThread::currentThread());
+            return pcIdle;
+        }
+    }
+
+    AbstractCommand* pcCmd = rcInfo.m_pfCreate();
+    if( pcCmd )
+    {
+        m_nInstanceCount.fetchAndAddRelaxed(1);
+    }
+    return pcCmd;
+}
+
+void FrontController::xReleaseCommand(const CommandClassInfo& rcInfo, AbstractCommand* pcCmd)
+{
+    if( rcInfo.m_pcPool )
+    {
+        /// only the owning thread can let go of it, the next request may run on any pool thread
+        pcCmd->moveToThread(nullptr);
+        QMutexLocker cLocker(&rcInfo.m_pcPool->m_cMutex);
+        rcInfo.m_pcPool->m_cIdle.append(pcCmd);
+        return;
     }
+    delete pcCmd;
 }
 
+void FrontController::unregisterAllCommand()
+{
+    m_commandTable.clear();
+}
 
+QHash<QString, CommandStatistics> FrontController::getCommandStatistics() const
+{
+    return m_cExecutor.getStatistics();
+}
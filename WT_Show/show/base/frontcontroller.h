@@ -3,21 +3,54 @@
 
 #include <QMetaObject>
 #include <QHash>
-#include <QThread>
 #include <QMutex>
-#include <QMutexLocker>
-#include <QWaitCondition>
+#include <QList>
+#include <QSharedPointer>
+#include <QAtomicInteger>
+#include <functional>
+#include <type_traits>
 
 #include "def.h"
 #include "module.h"
 #include "cmdevt.h"
+#include "commandexecutor.h"
+#include "abstractcommand.h"
+
+typedef std::function<AbstractCommand* ()> CommandFactory;
+
+ /**********************************************************************************************************************
+ @brief: Idle instances of one reusable command class, see AbstractCommand::getReusable
+ *  Idle instances have no thread affinity. The thread that runs one moves it to itself first and lets go of it after
+ *  execute(), so a command's thread() is always the thread executing it, main or pool.
+ ***********************************************************************************************************************/
+struct CommandPool
+{
+    ~CommandPool() { qDeleteAll(m_cIdle); }
+
+    QMutex m_cMutex;
+    QList<AbstractCommand*> m_cIdle;
+};
+
+ /**********************************************************************************************************************
+ @brief: What the front controller knows about one registered command class.
+ *  Resolved once by registerCommand, dispatching an event does not create the command to ask for it.
+ ***********************************************************************************************************************/
+struct CommandClassInfo
+{
+    QString m_strClassName;
+    CommandFactory m_pfCreate;
+    bool m_bInWorkerThread;
+    QString m_strResource;
+    QSharedPointer<CommandPool> m_pcPool;       ///< null unless the command is reusable
+};
 
  /**********************************************************************************************************************
  @brief: The FrontController class
  *  Front controller pattern. It accepts all command requests and invoke corresponding commands
  *  (according to the <command name>-<command class> table)
+ *  Worker thread commands run on a thread pool, serialized per resource, see AbstractCommand::getResource.
  ***********************************************************************************************************************/
-class FrontController : public Module, public QThread
+class FrontController : public Module
 {
 public:
     virtual ~FrontController() {}
@@ -26,34 +59,52 @@ public:
     @brief: Filter out the command request from other request, and then it calls
     *  onCommandRequestArrive function
     ***********************************************************************************************************************/
-    virtual bool fire(Event& evt);
+    virtual bool fire(const Event& evt);
 
     /**********************************************************************************************************************
     @brief: onCommandRequestArrive One command request is captured by front controller.
     *  By default, it find out the corresponding command and execute this command immediately.
     *  You can override this function to to something else.
     ***********************************************************************************************************************/
-    virtual void onCommandRequestArrive(CmdEvt& evt);
+    virtual void onCommandRequestArrive(const CmdEvt& evt);
 
+    /**********************************************************************************************************************
+    @brief: Register a command class by its meta object, every request creates it with QMetaObject::newInstance.
+    *  The constructor must be Q_INVOKABLE.
+    ***********************************************************************************************************************/
     bool registerCommand(const QString& strCommandName, const QMetaObject* pMetaObject);
+
+    /**********************************************************************************************************************
+    @brief: Register a command class by type, every request creates it with a plain new, no reflection.
+    ***********************************************************************************************************************/
+    template <class T>
+    bool registerCommand(const QString& strCommandName)
+    {
+        static_assert(std::is_base_of<AbstractCommand, T>::value, "commands must derive from AbstractCommand");
+        return xRegisterCommand(strCommandName, T::staticMetaObject.className(), []() -> AbstractCommand* { return new T(); });
+    }
+
     void unregisterAllCommand();
 
-    virtual void run();
+    /// command objects created so far, registration probes included. Reusable commands keep it low.
+    quint64 getCommandInstanceCount() const { return m_nInstanceCount.load(); }
+
+    /// queue depth, wait and execution time per command class
+    QHash<QString, CommandStatistics> getCommandStatistics() const;
 
 protected:
     explicit FrontController();
 
+    bool xRegisterCommand(const QString& strCommandName, const QString& strClassName, const CommandFactory& pfCreate);
+    AbstractCommand* xAcquireCommand(const CommandClassInfo& rcInfo);
+    void xReleaseCommand(const CommandClassInfo& rcInfo, AbstractCommand* pcCmd);
+
 protected:
     /// <command string>-<command class> table
-    ADD_CLASS_FIELD( CONCATE(QHash<QString,QMetaObject*>), commandTable, getCommandTable, setCommandTable)
-    ADD_CLASS_FIELD(int, nMaxEvtInQue, setMaxEvtInQue, getMaxEvtInQue)
-
-    ADD_CLASS_FIELD_PRIVATE(QList<Event*>, pMainThreadEvtQue)
-    ADD_CLASS_FIELD_PRIVATE(QList<Event*>, pWorkerThreadEvtQue)
-    ADD_CLASS_FIELD_PRIVATE(QMutex, evtQueMutex)
-    ADD_CLASS_FIELD_PRIVATE(QWaitCondition, evtQueNotEmpty)
-    ADD_CLASS_FIELD_PRIVATE(QWaitCondition, evtQueNotFull)
-    ADD_CLASS_FIELD_PRIVATE(QMutex, cmdExeMutex)   ///< ensure one command execution at one time
+    ADD_CLASS_FIELD( CONCATE(QHash<QString,CommandClassInfo>), commandTable, getCommandTable, setCommandTable)
+    ADD_CLASS_FIELD_NOSETTER(CommandExecutor, cExecutor, getExecutor)    ///< pending limit: getExecutor().setMaxPending()
+
+    QAtomicInteger<quint64> m_nInstanceCount;
 
     SINGLETON_PATTERN_DECLARE(FrontController)
 };
@@ -18,31 +18,52 @@ ModuleDelegate::ModuleDelegate(Module* pDelegator, EventBus* pEventBus)
     m_strModuleName = "undefined_module_name";
 }
 
+ModuleDelegate::~ModuleDelegate()
+{
+    detach();
+}
+
 void ModuleDelegate::subscribeToEvtByName(const QString& strEvtName, CallBack pfListener )
 {
-    m_cListeningEvts.insert(strEvtName, pfListener);
+    int nTopic = EventBus::internTopic(strEvtName);
+    m_cListeningEvts.insert(nTopic, pfListener);
+    if(m_pEvtBus != nullptr)
+        m_pEvtBus->subscribe(this, nTopic);
     return;
 }
 
 void ModuleDelegate::unsubscribeToEvtByName( const QString& strEvtName )
 {
-    m_cListeningEvts.remove(strEvtName);
+    int nTopic = EventBus::internTopic(strEvtName);
+    m_cListeningEvts.remove(nTopic);
+    if(m_pEvtBus != nullptr)
+        m_pEvtBus->unsubscribe(this, nTopic);
 }
 
-bool ModuleDelegate::fire( QSharedPointer<Event> pcEvt )
+bool ModuleDelegate::fire( const Event& rcEvt )
 {
-    QMap<QString, std::function<bool (Event&)>>::iterator p =
-            m_cListeningEvts.find(pcEvt->getEvtName());
+    QHash<int, CallBack>::iterator p =
+            m_cListeningEvts.find(rcEvt.getTopic());
 
     if( p != m_cListeningEvts.end() )
-        (p.value())(*pcEvt.data());
+        (p.value())(rcEvt);
 
     return true;
 }
 
+bool ModuleDelegate::fire( QSharedPointer<const Event> pcEvt )
+{
+    return fire(*pcEvt);
+}
+
 bool ModuleDelegate::xIsListenToEvt( const QString& strEvtName )
 {
-    return m_cListeningEvts.contains(strEvtName);
+    return m_cListeningEvts.contains(EventBus::internTopic(strEvtName));
+}
+
+QList<int> ModuleDelegate::getTopics() const
+{
+    return m_cListeningEvts.keys();
 }
 
 void ModuleDelegate::dispatchEvt( const Event& rcEvt ) const
@@ -2,7 +2,8 @@
 #define MODULEDELEGATE_H
 
 #include <QObject>
-#include <QMap>
+#include <QHash>
+#include <QList>
 #include <QMutex>
 #include <QMutexLocker>
 #include <QSharedPointer>
@@ -13,7 +14,7 @@
 class Module;
 class EventBus;
 
-typedef std::function<bool (Event&)> CallBack;
+typedef std::function<bool (const Event&)> CallBack;
 
 class ModuleDelegate : public QObject
 {
@@ -23,6 +24,8 @@ private:
     explicit ModuleDelegate(Module* pDelegator, EventBus* pEventBus = nullptr);
 
 public:
+    virtual ~ModuleDelegate();
+
     void subscribeToEvtByName( const QString& strEvtName, CallBack pfListener );
     void unsubscribeToEvtByName( const QString& strEvtName );
 
@@ -31,15 +34,21 @@ public:
     void detach();
     void attach(EventBus *pcEventBus);
 
+    /// topic ids of the events this module listens to
+    QList<int> getTopics() const;
+
+    /// calls the listener of the event's topic, in the calling thread
+    bool fire( const Event& rcEvt );
+
 public slots:
-    bool fire( QSharedPointer<Event> pcEvt );
+    bool fire( QSharedPointer<const Event> pcEvt );
 
 protected:
     bool xIsListenToEvt(const QString& strEvtName);
 
     ADD_CLASS_FIELD( QString, strModuleName, getModuleName, setModuleName )
     ADD_CLASS_FIELD_NOSETTER(EventBus*, pEvtBus, getEvtBus)
-    ADD_CLASS_FIELD_PRIVATE( CONCATE(QMap<QString, CallBack>), cListeningEvts )    
+    ADD_CLASS_FIELD_PRIVATE( CONCATE(QHash<int, CallBack>), cListeningEvts )    ///< topic id - listener
     ADD_CLASS_FIELD_PRIVATE(Module*, pDelegator)
 };
 
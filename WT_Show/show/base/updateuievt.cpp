@@ -1,16 +1,18 @@
 #include "updateuievt.h"
 
+static const int s_nCommandNameKey = EventParam::internKey(QStringLiteral("command_name"));
+
 UpdateUIEvt::UpdateUIEvt() : Event(_UPDATE_UI_REQUEST_EVENT)
 {
 }
 
-QString UpdateUIEvt::getCommandName()
+QString UpdateUIEvt::getCommandName() const
 {
-    return getParameter("command_name").toString();
+    return getParameters().getParameter(s_nCommandNameKey).toString();
 }
 
 void UpdateUIEvt::setCommandName(const QString& strCommandName)
 {
-    setParameter("command_name", strCommandName);
+    getParameters().setParameter(s_nCommandNameKey, strCommandName);
 }
 
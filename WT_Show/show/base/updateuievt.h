@@ -11,7 +11,7 @@ class UpdateUIEvt : public Event
 public:
     UpdateUIEvt();
 
-    QString getCommandName();
+    QString getCommandName() const;
     void setCommandName(const QString& strCommandName);
 };
 
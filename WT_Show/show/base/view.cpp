@@ -6,9 +6,9 @@ View::View(EventBus *pEventBus) : Module(pEventBus)
     subscribeToEvtByName( _UPDATE_UI_REQUEST_EVENT, MAKE_CALLBACK(View::fire) );
 }
 
-bool View::fire(Event& evt)
+bool View::fire(const Event& evt)
 {
-    UpdateUIEvt& rcUpdateUIEvt = static_cast<UpdateUIEvt&>(evt);
+    const UpdateUIEvt& rcUpdateUIEvt = static_cast<const UpdateUIEvt&>(evt);
 
     QMap<ParamNameList,UIUpdateCallback>::iterator iter= m_pCallbacks.begin();
     /// check every callback functions
@@ -8,7 +8,7 @@
 #include "module.h"
 #include "updateuievt.h"
 
-typedef std::function<void (UpdateUIEvt&)> UIUpdateCallback;
+typedef std::function<void (const UpdateUIEvt&)> UIUpdateCallback;
 
 class ParamNameList: public QStringList
 {
@@ -50,7 +50,7 @@ public:
     View(EventBus* pEventBus = nullptr);
     virtual ~View() {}
 
-    bool fire(Event& evt);
+    bool fire(const Event& evt);
 
     bool listenToParams(const QString& params, const UIUpdateCallback& callback);
     bool listenToParams(const QStringList& params, const UIUpdateCallback& callback);
@@ -0,0 +1,27 @@
+# Micro-benchmarks of the GitlMVC base library, build base/base.pro first.
+#   BenchMVC eventbus [--delegates 1,10,100,1000] [--iterations N]
+#   BenchMVC frontcontroller [--iterations N]
+
+QT += core
+QT += widgets
+
+TARGET = BenchMVC
+CONFIG   += console
+CONFIG   += c++11
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+INCLUDEPATH  += ../base
+
+SOURCES += \
+    main.cpp
+
+LIBS += -L$${OUT_PWD}/..
+
+CONFIG(debug, debug|release){
+    LIBS += -lGitlMVCd
+}
+CONFIG(release, debug|release){
+    LIBS += -lGitlMVC
+}
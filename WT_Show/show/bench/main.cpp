@@ -0,0 +1,371 @@
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QSemaphore>
+#include <QStringList>
+#include <QThread>
+
+#include <algorithm>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "abstractcommand.h"
+#include "cmdevt.h"
+#include "event.h"
+#include "eventbus.h"
+#include "frontcontroller.h"
+#include "module.h"
+
+using namespace std;
+
+ /**********************************************************************************************************************
+ @brief: Commands that do nothing, one class per dispatch path of FrontController
+ ***********************************************************************************************************************/
+class BenchCommand : public AbstractCommand
+{
+    Q_OBJECT
+public:
+    Q_INVOKABLE explicit BenchCommand(QObject *parent = 0) : AbstractCommand(parent) {}
+
+    bool execute(CommandParameter &rcInputArg, CommandParameter &rcOutputArg) override
+    {
+        Q_UNUSED(rcInputArg)
+        Q_UNUSED(rcOutputArg)
+        return true;
+    }
+};
+
+class ReusableBenchCommand : public BenchCommand
+{
+    Q_OBJECT
+public:
+    Q_INVOKABLE explicit ReusableBenchCommand(QObject *parent = 0) : BenchCommand(parent) { setReusable(true); }
+};
+
+class WorkerBenchCommand : public BenchCommand
+{
+    Q_OBJECT
+public:
+    Q_INVOKABLE explicit WorkerBenchCommand(QObject *parent = 0) : BenchCommand(parent) { setInWorkerThread(true); }
+};
+
+class ReusableWorkerBenchCommand : public BenchCommand
+{
+    Q_OBJECT
+public:
+    Q_INVOKABLE explicit ReusableWorkerBenchCommand(QObject *parent = 0) : BenchCommand(parent)
+    {
+        setInWorkerThread(true);
+        setReusable(true);
+    }
+};
+
+namespace
+{
+
+ /**********************************************************************************************************************
+ @brief: Command line of BenchMVC, see bench.pro
+ ***********************************************************************************************************************/
+struct BenchOptions
+{
+    QString strMode;
+    QList<int> cDelegateCounts;
+    int nIterations;
+};
+
+/// one clock for every thread, handlers stamp it when they run
+QElapsedTimer g_cClock;
+
+ /**********************************************************************************************************************
+ @brief: A module with a single handler, subscribed on creation
+ ***********************************************************************************************************************/
+class BenchModule : public Module
+{
+public:
+    BenchModule(EventBus* pcEventBus, const QString& strEvtName, const std::function<void ()>& pfOnEvt)
+        : Module(pcEventBus)
+    {
+        subscribeToEvtByName(strEvtName, [pfOnEvt](const Event&) { pfOnEvt(); return true; });
+    }
+};
+
+ /**********************************************************************************************************************
+ @brief: Owns a module living in its own thread, events reach it through the thread's event loop
+ ***********************************************************************************************************************/
+class BenchThread : public QThread
+{
+public:
+    BenchThread(EventBus* pcEventBus, const QString& strEvtName, const std::function<void ()>& pfOnEvt)
+        : m_pcEventBus(pcEventBus), m_strEvtName(strEvtName), m_pfOnEvt(pfOnEvt)
+    {
+        start();
+        m_cReady.acquire();
+    }
+
+    ~BenchThread()
+    {
+        quit();
+        wait();
+    }
+
+protected:
+    void run() override
+    {
+        BenchModule cModule(m_pcEventBus, m_strEvtName, m_pfOnEvt);
+        m_cReady.release();
+        exec();
+    }
+
+private:
+    EventBus* m_pcEventBus;
+    QString m_strEvtName;
+    std::function<void ()> m_pfOnEvt;
+    QSemaphore m_cReady;
+};
+
+qint64 percentile(vector<qint64> cValues, double dP)
+{
+    if( cValues.empty() )
+        return 0;
+    sort(cValues.begin(), cValues.end());
+    return cValues[min(cValues.size() - 1, (size_t)(dP * (cValues.size() - 1) + 0.5))];
+}
+
+void printLatency(const string& strCase, const vector<qint64>& cNsecs)
+{
+    cout << "  " << left << setw(34) << strCase << right
+         << " p50 " << setw(8) << percentile(cNsecs, 0.50)
+         << " p99 " << setw(8) << percentile(cNsecs, 0.99)
+         << " max " << setw(8) << percentile(cNsecs, 1.00) << " ns" << endl;
+}
+
+/// post() to the handler, timed per post. The first posts warm up caches and allocations.
+vector<qint64> timePosts(EventBus* pcEventBus, const Event& rcEvt, int nIterations,
+                         const qint64& rnHandledNs, const std::function<void ()>& pfWait)
+{
+    vector<qint64> cNsecs;
+    for( int i = -100; i < nIterations; i++ )
+    {
+        qint64 nPostedNs = g_cClock.nsecsElapsed();
+        pcEventBus->post(rcEvt);
+        if( pfWait )
+            pfWait();
+        if( i >= 0 )
+            cNsecs.push_back(rnHandledNs - nPostedNs);
+    }
+    return cNsecs;
+}
+
+ /**********************************************************************************************************************
+ @brief: N delegates on one bus, post() to the handler:
+ *  - targeted: each delegate has its own topic, one of them is posted
+ *  - fan out: all of them listen to the posted topic, timed to the last handler
+ *  - queued: one more delegate in another thread, timed until its event loop ran the handler
+ ***********************************************************************************************************************/
+void runEventBus(const BenchOptions& rcOptions)
+{
+    cout << "EventBus::post to handler, " << rcOptions.nIterations << " posts per case" << endl;
+
+    foreach(int nDelegates, rcOptions.cDelegateCounts)
+    {
+        cout << endl << nDelegates << " delegate(s):" << endl;
+
+        qint64 nHandledNs = 0;
+        std::function<void ()> pfStamp = [&nHandledNs]() { nHandledNs = g_cClock.nsecsElapsed(); };
+
+        {
+            unique_ptr<EventBus> pcEventBus(EventBus::create());
+            vector<unique_ptr<BenchModule>> cModules;
+            for( int i = 0; i < nDelegates; i++ )
+                cModules.emplace_back(new BenchModule(pcEventBus.get(), QString("bench.targeted.%1").arg(i), pfStamp));
+
+            Event cEvt("bench.targeted.0");
+            printLatency("targeted, 1 subscriber", timePosts(pcEventBus.get(), cEvt, rcOptions.nIterations, nHandledNs, nullptr));
+        }
+
+        {
+            unique_ptr<EventBus> pcEventBus(EventBus::create());
+            vector<unique_ptr<BenchModule>> cModules;
+            for( int i = 0; i < nDelegates; i++ )
+                cModules.emplace_back(new BenchModule(pcEventBus.get(), "bench.fanout", pfStamp));
+
+            Event cEvt("bench.fanout");
+            vector<qint64> cNsecs = timePosts(pcEventBus.get(), cEvt, rcOptions.nIterations, nHandledNs, nullptr);
+            printLatency(QString("fan out, %1 subscribers").arg(nDelegates).toStdString(), cNsecs);
+            vector<qint64> cPerDelivery;
+            for( qint64 nNsecs : cNsecs )
+                cPerDelivery.push_back(nNsecs / nDelegates);
+            printLatency("fan out, per delivery", cPerDelivery);
+        }
+
+        {
+            unique_ptr<EventBus> pcEventBus(EventBus::create());
+            vector<unique_ptr<BenchModule>> cModules;
+            for( int i = 0; i < nDelegates; i++ )
+                cModules.emplace_back(new BenchModule(pcEventBus.get(), QString("bench.targeted.%1").arg(i), pfStamp));
+
+            QSemaphore cHandled;
+            BenchThread cThread(pcEventBus.get(), "bench.queued", [&pfStamp, &cHandled]()
+            {
+                pfStamp();
+                cHandled.release();
+            });
+
+            Event cEvt("bench.queued");
+            printLatency("queued to another thread", timePosts(pcEventBus.get(), cEvt, rcOptions.nIterations, nHandledNs,
+                                                               [&cHandled]() { cHandled.acquire(); }));
+        }
+    }
+}
+
+/// mean and percentiles of one callable, timed per call after a warm up
+void timeCalls(const string& strCase, int nIterations, const std::function<void ()>& pfCall)
+{
+    for( int i = 0; i < 100; i++ )
+        pfCall();
+
+    vector<qint64> cNsecs;
+    for( int i = 0; i < nIterations; i++ )
+    {
+        qint64 nStartNs = g_cClock.nsecsElapsed();
+        pfCall();
+        cNsecs.push_back(g_cClock.nsecsElapsed() - nStartNs);
+    }
+    printLatency(strCase, cNsecs);
+}
+
+/// worker commands are asynchronous, a batch is timed until the pool ran all of it
+void timeBatch(const string& strCase, int nIterations, FrontController* pcController, const Event& rcEvt)
+{
+    for( int i = 0; i < 100; i++ )
+        pcController->fire(rcEvt);
+    pcController->getExecutor().waitForDone();
+
+    qint64 nStartNs = g_cClock.nsecsElapsed();
+    for( int i = 0; i < nIterations; i++ )
+        pcController->fire(rcEvt);
+    pcController->getExecutor().waitForDone();
+    qint64 nNsecs = g_cClock.nsecsElapsed() - nStartNs;
+
+    cout << "  " << left << setw(34) << strCase << right
+         << " avg " << setw(8) << nNsecs / nIterations << " ns per command" << endl;
+}
+
+ /**********************************************************************************************************************
+ @brief: FrontController::fire for each way a command can be registered, before and after metadata was resolved at
+ *  registration. "before" repeats what every request used to do: create the command through QMetaObject to ask for
+ *  its thread, delete it, then create it again to execute it.
+ ***********************************************************************************************************************/
+void runFrontController(const BenchOptions& rcOptions)
+{
+    /// every command logs its success, that would be all we measure
+    qInstallMessageHandler([](QtMsgType eType, const QMessageLogContext&, const QString& strMsg)
+    {
+        if( eType != QtDebugMsg )
+            cerr << strMsg.toStdString() << endl;
+    });
+
+    FrontController* pcController = FrontController::getInstance();
+    pcController->registerCommand("bench.meta", &BenchCommand::staticMetaObject);
+    pcController->registerCommand<BenchCommand>("bench.typed");
+    pcController->registerCommand<ReusableBenchCommand>("bench.reusable");
+    pcController->registerCommand("bench.worker.meta", &WorkerBenchCommand::staticMetaObject);
+    pcController->registerCommand<WorkerBenchCommand>("bench.worker.typed");
+    pcController->registerCommand<ReusableWorkerBenchCommand>("bench.worker.reusable");
+
+    cout << "FrontController::fire, " << rcOptions.nIterations << " requests per case" << endl;
+    cout << endl << "main thread commands:" << endl;
+
+    const QMetaObject* pcMetaObject = &BenchCommand::staticMetaObject;
+    CmdEvt cMetaEvt("bench.meta");
+    timeCalls("before: 2x newInstance", rcOptions.nIterations, [&]()
+    {
+        AbstractCommand* pcProbe = static_cast<AbstractCommand*>(pcMetaObject->newInstance());
+        bool bInWorkerThread = pcProbe->getInWorkerThread();
+        delete pcProbe;
+        if( !bInWorkerThread )
+            pcController->onCommandRequestArrive(cMetaEvt);
+    });
+    timeCalls("after: newInstance", rcOptions.nIterations, [&]() { pcController->fire(cMetaEvt); });
+
+    CmdEvt cTypedEvt("bench.typed");
+    timeCalls("after: registered by type", rcOptions.nIterations, [&]() { pcController->fire(cTypedEvt); });
+
+    CmdEvt cReusableEvt("bench.reusable");
+    timeCalls("after: reusable", rcOptions.nIterations, [&]() { pcController->fire(cReusableEvt); });
+
+    cout << endl << "worker thread commands:" << endl;
+    timeBatch("after: newInstance", rcOptions.nIterations, pcController, CmdEvt("bench.worker.meta"));
+    timeBatch("after: registered by type", rcOptions.nIterations, pcController, CmdEvt("bench.worker.typed"));
+    timeBatch("after: reusable", rcOptions.nIterations, pcController, CmdEvt("bench.worker.reusable"));
+
+    cout << endl << pcController->getCommandInstanceCount() << " command objects created" << endl;
+}
+
+bool parseOptions(const QStringList& cArguments, BenchOptions& rcOptions)
+{
+    rcOptions.nIterations = 10000;
+    for( int i = 1; i < cArguments.size(); i++ )
+    {
+        const QString& strArg = cArguments[i];
+        QString strValue = i + 1 < cArguments.size() ? cArguments[i + 1] : QString();
+        if( strArg == "--iterations" && !strValue.isEmpty() )
+        {
+            rcOptions.nIterations = qMax(1, strValue.toInt());
+            i++;
+        }
+        else if( strArg == "--delegates" && !strValue.isEmpty() )
+        {
+            foreach(const QString& strCount, strValue.split(',', QString::SkipEmptyParts))
+                rcOptions.cDelegateCounts.append(qMax(1, strCount.toInt()));
+            i++;
+        }
+        else if( rcOptions.strMode.isEmpty() && !strArg.startsWith("--") )
+        {
+            rcOptions.strMode = strArg;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    if( rcOptions.cDelegateCounts.isEmpty() )
+        rcOptions.cDelegateCounts << 1 << 10 << 100 << 1000;
+    return !rcOptions.strMode.isEmpty();
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    g_cClock.start();
+
+    BenchOptions cOptions;
+    if( !parseOptions(a.arguments(), cOptions) )
+    {
+        cout << "usage: BenchMVC eventbus [--delegates 1,10,100,1000] [--iterations N]" << endl
+             << "       BenchMVC frontcontroller [--iterations N]" << endl;
+        return 1;
+    }
+
+    if( cOptions.strMode == "eventbus" )
+    {
+        runEventBus(cOptions);
+        return 0;
+    }
+    if( cOptions.strMode == "frontcontroller" )
+    {
+        runFrontController(cOptions);
+        return 0;
+    }
+
+    cout << "Unknown benchmark '" << cOptions.strMode.toStdString() << "'" << endl;
+    return 1;
+}
+
+#include "main.moc"
@@ -0,0 +1,236 @@
+#include "async_log_handler.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QDebug>
+
+#include <atomic>
+#include <memory>
+
+#include <settings.h>
+
+// Same as hp::fortis::Logger, Windows paths are wide
+#ifndef SPDLOG_WCHAR_FILENAMES
+#define SPDLOG_WCHAR_FILENAMES
+#endif
+#include <spdlog/spdlog.h>
+
+namespace capture {
+namespace common {
+
+namespace {
+
+// Log site, pointers to the string literals of the message context
+struct Site {
+    const char *file;
+    const char *category;
+    int line;
+
+    bool operator==(const Site &other) const {
+        return file == other.file && category == other.category && line == other.line;
+    }
+};
+
+uint qHash(const Site &site, uint seed = 0) {
+    return ::qHash(quintptr(site.file), seed) ^ ::qHash(quintptr(site.category), seed) ^ ::qHash(site.line, seed);
+}
+
+struct RateWindow {
+    qint64 second;
+    int count;
+    int suppressed;
+};
+
+// Only through std::atomic_load / atomic_store, messageHandler may run on any thread while uninstall() runs
+std::shared_ptr<spdlog::logger> logger;
+QtMessageHandler previousHandler = nullptr;
+bool usePreviousHandler = false;
+int minimumLevel = 0;
+int rateLimitPerSecond = 50;
+
+QMutex rateWindowsMutex;
+QHash<Site, RateWindow> rateWindows;
+QElapsedTimer clock;
+
+std::atomic<quint64> messages(0);
+std::atomic<quint64> suppressed(0);
+std::atomic<quint64> totalCallerNs(0);
+std::atomic<quint64> maxCallerNs(0);
+
+// Qt levels are 0, 4, 1, 2, 3 for debug, info, warning, critical, fatal, see hp::fortis::Logger
+int severity(QtMsgType type) {
+    return (type * 2) % 7;
+}
+
+int severity(const QString &name) {
+    static const QHash<QString, QtMsgType> names {
+        { "debug", QtDebugMsg }, { "info", QtInfoMsg }, { "warning", QtWarningMsg },
+        { "critical", QtCriticalMsg }, { "fatal", QtFatalMsg }
+    };
+
+    return severity(names.value(name.toLower(), QtCriticalMsg));
+}
+
+spdlog::level::level_enum spdlogLevel(QtMsgType type) {
+    switch (type) {
+    case QtDebugMsg: return spdlog::level::debug;
+    case QtInfoMsg: return spdlog::level::info;
+    case QtWarningMsg: return spdlog::level::warn;
+    case QtCriticalMsg: return spdlog::level::err;
+    case QtFatalMsg: return spdlog::level::critical;
+    }
+
+    return spdlog::level::info;
+}
+
+const char* fileName(const char *path) {
+    if (!path) {
+        return "";
+    }
+
+    const char *name = path;
+    for (const char *c = path; *c; c++) {
+        if (*c == '/' || *c == '\\') {
+            name = c + 1;
+        }
+    }
+
+    return name;
+}
+
+// Returns how many earlier messages of the site were suppressed and are to be reported now, or -1 to drop this one
+int admit(const QMessageLogContext &context) {
+    Site site { context.file, context.file ? nullptr : context.category, context.line };
+    qint64 second = clock.elapsed() / 1000;
+
+    QMutexLocker locker(&rateWindowsMutex);
+    RateWindow &window = rateWindows[site];
+
+    if (window.second != second) {
+        int report = window.suppressed;
+        window = RateWindow { second, 1, 0 };
+        return report;
+    }
+
+    if (window.count < rateLimitPerSecond) {
+        window.count++;
+        return 0;
+    }
+
+    window.suppressed++;
+    return -1;
+}
+
+void updateMax(std::atomic<quint64> &max, quint64 value) {
+    quint64 current = max.load();
+    while (value > current && !max.compare_exchange_weak(current, value)) { }
+}
+
+} // namespace
+
+void AsyncLogHandler::install(const QString &pkgName, const QString &filename) {
+    hp::fortis::Settings settings(pkgName, "log");
+
+#ifdef QT_DEBUG
+    usePreviousHandler = settings.value("keep_previous_handler", true).toBool();
+#else
+    // The previous handler writes synchronously, keep it off the render threads unless asked for
+    usePreviousHandler = settings.value("keep_previous_handler", false).toBool();
+#endif
+    minimumLevel = severity(settings.value("verbosity", "debug").toString());
+    rateLimitPerSecond = settings.value("rate_limit_per_second", 50).toInt();
+
+    int maxLogFiles = settings.value("number_of_files", 5).toInt();
+    int maxLogSize = settings.value("max_log_size", 10000000).toInt();
+    // The queue size must be a power of two
+    size_t queueSize = 2;
+    while (queueSize < size_t(settings.value("queue_size", 8192).toInt())) {
+        queueSize *= 2;
+    }
+    QString pattern = settings.value("async_pattern", "[%Y-%m-%d %H:%M:%S.%e] [%l] [tid:%t] %v").toString();
+
+    QDir logPath = QDir(settings.defaultPath());
+    logPath.mkpath(".");
+#if defined(_WIN32) && defined(SPDLOG_WCHAR_FILENAMES)
+    spdlog::filename_t baseFilename = logPath.absoluteFilePath(filename).toStdWString();
+#else
+    spdlog::filename_t baseFilename = logPath.absoluteFilePath(filename).toStdString();
+#endif
+    auto sink = std::make_shared<spdlog::sinks::rotating_file_sink_mt>(baseFilename, SPDLOG_FILENAME_T("log"),
+                                                                       maxLogSize, maxLogFiles);
+
+    auto asyncLogger = std::make_shared<spdlog::async_logger>(filename.toStdString(), sink, queueSize,
+                                                              spdlog::async_overflow_policy::discard_log_msg,
+                                                              nullptr, std::chrono::milliseconds(1000));
+    // Formatted by the worker thread
+    asyncLogger->set_pattern(pattern.toStdString());
+    asyncLogger->set_level(spdlog::level::trace);
+    std::atomic_store(&logger, std::shared_ptr<spdlog::logger>(asyncLogger));
+
+    clock.start();
+    previousHandler = qInstallMessageHandler(AsyncLogHandler::messageHandler);
+}
+
+void AsyncLogHandler::uninstall() {
+    if (!std::atomic_load(&logger)) {
+        return;
+    }
+
+    auto stats = statistics();
+    qInfo() << "Log handler:" << stats.messages << "messages," << stats.suppressed << "suppressed, caller avg"
+            << (stats.messages ? stats.totalCallerNs / stats.messages : 0) << "ns max" << stats.maxCallerNs << "ns";
+
+    qInstallMessageHandler(previousHandler);
+    // A handler that is still running keeps its own reference, the last one to let go destroys the logger
+    auto lastLogger = std::atomic_exchange(&logger, std::shared_ptr<spdlog::logger>());
+    lastLogger->flush();
+}
+
+AsyncLogHandler::Statistics AsyncLogHandler::statistics() {
+    return Statistics { messages.load(), suppressed.load(), totalCallerNs.load(), maxCallerNs.load() };
+}
+
+void AsyncLogHandler::messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg) {
+    QElapsedTimer timer;
+    timer.start();
+
+    auto currentLogger = std::atomic_load(&logger);
+
+    if (currentLogger && severity(type) >= minimumLevel) {
+        int report = type == QtFatalMsg ? 0 : admit(context);
+
+        if (report < 0) {
+            suppressed++;
+        } else {
+            // Only the message is built here, time, level and thread are formatted by the worker
+            QByteArray text = QByteArray("(") + fileName(context.file) + ':' + QByteArray::number(context.line) + ") "
+                              + msg.toUtf8();
+
+            if (report > 0) {
+                text += " [" + QByteArray::number(report) + " earlier messages from here suppressed]";
+            }
+
+            currentLogger->log(spdlogLevel(type), std::string(text.constData(), text.size()));
+
+            if (type == QtFatalMsg) {
+                currentLogger->flush();
+            }
+        }
+    }
+
+    quint64 elapsed = timer.nsecsElapsed();
+    messages++;
+    totalCallerNs += elapsed;
+    updateMax(maxCallerNs, elapsed);
+
+    // Called after uninstall() took the logger, the previous handler is all there is
+    if (usePreviousHandler || type == QtFatalMsg || !currentLogger) {
+        previousHandler(type, context, msg);
+    }
+}
+
+} // namespace common
+} // namespace capture
@@ -0,0 +1,51 @@
+#pragma once
+#ifndef ASYNC_LOG_HANDLER_H
+#define ASYNC_LOG_HANDLER_H
+
+#include <QString>
+#include <QtGlobal>
+
+namespace capture {
+namespace common {
+
+/*!
+ * \brief The AsyncLogHandler class is the Qt message handler of the application, it replaces hp::fortis::Logger.
+ * \details The calling thread only checks the rate limit and queues the raw message, spdlog formats and writes it
+ * \details on its own worker thread. Render and capture threads never wait for the disk. When the queue is full the
+ * \details message is dropped rather than blocking.
+ * \details Every call site (file:line, or the category when it has no file) may log rate_limit_per_second messages
+ * \details per second. The rest is dropped and counted, the count is appended to the next message from that site.
+ * \details Settings group "log" is the one hp::fortis::Logger uses, plus queue_size and rate_limit_per_second.
+ */
+class AsyncLogHandler
+{
+public:
+    struct Statistics {
+        quint64 messages;       // handled by the handler
+        quint64 suppressed;     // dropped by the rate limit
+        quint64 totalCallerNs;  // time spent on the calling threads
+        quint64 maxCallerNs;
+    };
+
+    /*!
+     * \brief Install the handler, throws spdlog::spdlog_ex when the log file can not be opened.
+     * \param pkgName The name of the package, decides where the log is stored.
+     * \param filename The name of the log file, without extension.
+     */
+    static void install(const QString &pkgName, const QString &filename);
+
+    /*!
+     * \brief Writes the queued messages, restores the previous handler and reports the statistics.
+     */
+    static void uninstall();
+
+    static Statistics statistics();
+
+private:
+    static void messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg);
+};
+
+} // namespace common
+} // namespace capture
+
+#endif // ASYNC_LOG_HANDLER_H
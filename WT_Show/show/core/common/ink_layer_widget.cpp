@@ -143,11 +143,14 @@ void InkLayerWidget::connectCurrentStroke(QSharedPointer<InkStroke> stroke)
 void InkLayerWidget::onStrokeAdded(QSharedPointer<InkStroke> addedStroke, QSharedPointer<InkStroke> currentStroke)
 {
     connectCurrentStroke(currentStroke);
+    m_frameCounting->frameArrived();
     update();
 }
 
 void InkLayerWidget::onUpdate()
 {
+    // New ink to show, the frame counter measures how long it waits for the paint
+    m_frameCounting->frameArrived();
     this->update();
 }
 
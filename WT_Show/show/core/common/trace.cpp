@@ -0,0 +1,215 @@
+#include "trace.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+#include <QDebug>
+
+#include <chrono>
+#include <memory>
+
+#include <global_utilities.h>
+
+namespace capture {
+namespace common {
+
+std::atomic<bool> Trace::s_enabled(false);
+
+namespace {
+
+const int RingCapacity = 16384;  // spans per thread, power of two
+
+struct TraceEvent {
+    const char *name;
+    qint64 timestampNs;
+    char phase;  // 'B' or 'E'
+};
+
+// Events are written by the owning thread only and read by chromeJson(); the rest changes under buffersMutex
+struct ThreadBuffer {
+    quint64 threadId;
+    QString threadName;
+    std::atomic<quint64> head;
+    quint64 start;  // first event of the owning thread, the ones before belong to a thread that exited
+    TraceEvent events[RingCapacity];
+};
+
+QMutex buffersMutex;
+// Every buffer created so far. A buffer outlives its thread so the spans can still be exported, until the next new
+// thread takes it over from idleBuffers: a thread pool that keeps replacing its threads does not keep allocating.
+QVector<std::shared_ptr<ThreadBuffer>> buffers;
+QVector<ThreadBuffer*> idleBuffers;
+
+// Hands the thread's buffer back when the thread exits
+struct BufferHolder {
+    ThreadBuffer *buffer = nullptr;
+
+    ~BufferHolder() {
+        if (buffer) {
+            QMutexLocker locker(&buffersMutex);
+            idleBuffers.append(buffer);
+        }
+    }
+};
+
+qint64 nowNs() {
+    static const auto origin = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+}
+
+ThreadBuffer* currentBuffer() {
+    thread_local BufferHolder holder;
+
+    if (!holder.buffer) {
+        QMutexLocker locker(&buffersMutex);
+
+        if (idleBuffers.isEmpty()) {
+            auto created = std::make_shared<ThreadBuffer>();
+            created->head = 0;
+            buffers.append(created);
+            holder.buffer = created.get();
+        } else {
+            holder.buffer = idleBuffers.takeLast();
+        }
+
+        // The head keeps counting, so a reader can still tell which slots were overwritten
+        holder.buffer->threadId = quint64(quintptr(QThread::currentThreadId()));
+        holder.buffer->threadName = QThread::currentThread()->objectName();
+        holder.buffer->start = holder.buffer->head.load(std::memory_order_relaxed);
+    }
+
+    return holder.buffer;
+}
+
+void record(const char *name, char phase) {
+    ThreadBuffer *buffer = currentBuffer();
+    quint64 head = buffer->head.load(std::memory_order_relaxed);
+
+    TraceEvent &event = buffer->events[head & (RingCapacity - 1)];
+    event.name = name;
+    event.timestampNs = nowNs();
+    event.phase = phase;
+
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+QByteArray jsonString(const QString &text) {
+    QByteArray escaped = text.toUtf8();
+    escaped.replace('\\', "\\\\").replace('"', "\\\"");
+    return '"' + escaped + '"';
+}
+
+} // namespace
+
+void Trace::setEnabled(bool enabled) {
+    if (s_enabled.exchange(enabled) != enabled) {
+        qInfo() << "Tracing" << (enabled ? "enabled" : "disabled");
+    }
+}
+
+void Trace::initialize() {
+    auto store = SettingsStore::instance();
+    auto follow = [store] {
+        setEnabled(store->snapshot()->value("measured_blocks_enabled", false).toBool());
+    };
+
+    follow();
+    QObject::connect(store, &SettingsStore::changed, store, [follow](const QString &group) {
+        if (group.isEmpty()) {
+            follow();
+        }
+    });
+}
+
+void Trace::begin(const char *name) {
+    record(name, 'B');
+}
+
+void Trace::end(const char *name) {
+    record(name, 'E');
+}
+
+bool Trace::hasSpans() {
+    QMutexLocker locker(&buffersMutex);
+
+    for (const auto &buffer : buffers) {
+        if (buffer->head.load(std::memory_order_acquire) > buffer->start) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+QByteArray Trace::chromeJson() {
+    // Held throughout so no buffer changes hands while it is read. Recording spans does not take it, only the first
+    // span of a new thread and the exit of a thread wait for the export.
+    QMutexLocker locker(&buffersMutex);
+
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+    QByteArray json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+
+    auto append = [&json, &first](const QByteArray &event) {
+        json += first ? "\n" : ",\n";
+        json += event;
+        first = false;
+    };
+
+    for (const auto &buffer : buffers) {
+        const QByteArray tid = QByteArray::number(buffer->threadId);
+        QString threadName = buffer->threadName.isEmpty() ? QString("thread %1").arg(buffer->threadId) : buffer->threadName;
+
+        append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid + ",\"tid\":" + tid +
+               ",\"args\":{\"name\":" + jsonString(threadName) + "}}");
+
+        quint64 head = buffer->head.load(std::memory_order_acquire);
+        quint64 tail = qMax(buffer->start, head > quint64(RingCapacity) ? head - RingCapacity : 0);
+
+        QVector<TraceEvent> events;
+        events.reserve(int(head - tail));
+        for (quint64 i = tail; i < head; i++) {
+            events.append(buffer->events[i & (RingCapacity - 1)]);
+        }
+
+        // The thread kept writing while we copied, drop what it overwrote. It may also be halfway through writing
+        // event headAfter, whose slot is the one of event headAfter - RingCapacity.
+        quint64 headAfter = buffer->head.load(std::memory_order_acquire);
+        qint64 overwritten = qint64(headAfter) + 1 - RingCapacity - qint64(tail);
+        events.remove(0, int(qBound(qint64(0), overwritten, qint64(events.count()))));
+
+        // An end whose begin was overwritten can not be shown, skip the leading ones
+        int depth = 0;
+        for (const auto &event : events) {
+            if (event.phase == 'E' && depth == 0) {
+                continue;
+            }
+            depth += event.phase == 'B' ? 1 : -1;
+
+            append("{\"name\":" + jsonString(QString::fromLatin1(event.name)) + ",\"ph\":\"" + event.phase +
+                   "\",\"ts\":" + QByteArray::number(double(event.timestampNs) / 1000.0, 'f', 3) +
+                   ",\"pid\":" + pid + ",\"tid\":" + tid + "}");
+        }
+    }
+
+    json += "\n]}\n";
+    return json;
+}
+
+bool Trace::exportChromeJson(const QString &fileName) {
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Cannot write trace to" << fileName << file.errorString();
+        return false;
+    }
+
+    file.write(chromeJson());
+    qInfo() << "Trace written to" << fileName;
+    return true;
+}
+
+} // namespace common
+} // namespace capture
@@ -0,0 +1,85 @@
+#pragma once
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QByteArray>
+#include <QString>
+
+#include <atomic>
+
+namespace capture {
+namespace common {
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+/*!
+ * \brief Records the enclosing scope as a span. name must be a string literal, e.g. TRACE_SPAN(__FUNCTION__).
+ */
+#define TRACE_SPAN(name) capture::common::TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(name); Q_UNUSED(TRACE_CONCAT(traceSpan, __LINE__));
+
+/*!
+ * \brief The Trace class records begin/end spans of the worker threads (capture, compositor, export, segmentation)
+ * \brief so their nesting and overlap can be looked at in chrome://tracing or https://ui.perfetto.dev.
+ * \details Every thread writes into its own ring buffer without locking; the oldest spans are overwritten when it is
+ * \details full. While tracing is off a span costs one relaxed atomic load.
+ * \details The buffer of a thread that exited is kept for export until a new thread reuses it.
+ * \details The "measured_blocks_enabled" setting switches it on and off, also while the application runs.
+ */
+class Trace
+{
+public:
+    static inline bool enabled() { return s_enabled.load(std::memory_order_relaxed); }
+    static void setEnabled(bool enabled);
+
+    /*!
+     * \brief Follows the measured_blocks_enabled setting from now on.
+     */
+    static void initialize();
+
+    static void begin(const char *name);
+    static void end(const char *name);
+
+    /*!
+     * \brief Whether any thread recorded a span that can still be exported, tracing may be off by now.
+     */
+    static bool hasSpans();
+
+    /*!
+     * \brief The recorded spans of all threads in the Chrome trace event JSON format.
+     */
+    static QByteArray chromeJson();
+    static bool exportChromeJson(const QString &fileName);
+
+private:
+    static std::atomic<bool> s_enabled;
+};
+
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char *name) noexcept : m_name(nullptr) {
+        if (Trace::enabled()) {
+            m_name = name;
+            Trace::begin(name);
+        }
+    }
+
+    // Ends a span that was started, even if tracing was switched off meanwhile
+    ~TraceSpan() noexcept {
+        if (m_name) {
+            Trace::end(m_name);
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char *m_name;
+};
+
+} // namespace common
+} // namespace capture
+
+#endif // TRACE_H
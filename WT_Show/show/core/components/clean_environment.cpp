@@ -4,26 +4,20 @@
 #include <QStandardPaths>
 #include <QDir>
 
+#include "event/event_dispatcher.h"
+
 namespace capture {
 namespace components {
 
 CleanEnvironment::CleanEnvironment(QObject *parent)
     : QObject(parent) {
-    QCoreApplication::instance()->installEventFilter(this);
+    event::EventDispatcher::instance()->subscribe(this, &CleanEnvironment::onClean);
 }
 
-bool CleanEnvironment::eventFilter(QObject *obj, QEvent *event)
+void CleanEnvironment::onClean(event::CleanEvent *event)
 {
-    bool processed = false;
-
-    if (event->type() == event::CleanEvent::type()) {
-        if (auto cleanEvent = static_cast<event::CleanEvent*>(event)) {
-            deleteDMPFiles();
-            processed = true;
-        }
-    }
-
-    return processed ? processed : QObject::eventFilter(obj, event);
+    Q_UNUSED(event)
+    deleteDMPFiles();
 }
 
 void CleanEnvironment::deleteDMPFiles() {
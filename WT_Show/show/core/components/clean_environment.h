@@ -14,9 +14,8 @@ class CleanEnvironment : public QObject
 public:
     explicit CleanEnvironment(QObject *parent = 0);
 
-    virtual bool eventFilter(QObject *obj, QEvent *event);
-
 private:
+    void onClean(event::CleanEvent *event);
     void deleteDMPFiles();
 };
 
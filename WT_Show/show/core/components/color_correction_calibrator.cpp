@@ -4,6 +4,7 @@
 
 #include "common/measured_block.h"
 #include "event/start_color_calibration_event.h"
+#include "event/event_dispatcher.h"
 
 namespace capture {
 namespace components {
@@ -16,20 +17,12 @@ ColorCorrectionCalibrator::ColorCorrectionCalibrator(QSharedPointer<model::Appli
     , m_model(model)
     , m_compositor(compositor) {
     setAutoDelete(false);
-    QCoreApplication::instance()->installEventFilter(this);
+    event::EventDispatcher::instance()->subscribe(this, &ColorCorrectionCalibrator::onStartColorCalibration);
 }
 
-bool ColorCorrectionCalibrator::eventFilter(QObject *obj, QEvent *event) {
-    bool processed = false;
-
-    if (event->type() == event::StartColorCalibrationEvent::type()) {
-        if (auto startColorCalibrationEvent = static_cast<event::StartColorCalibrationEvent*>(event)) {
-            m_threadPool->start(this);
-            processed = true;
-        }
-    }
-
-    return processed ? processed : QObject::eventFilter(obj, event);
+void ColorCorrectionCalibrator::onStartColorCalibration(event::StartColorCalibrationEvent *event) {
+    Q_UNUSED(event)
+    m_threadPool->start(this);
 }
 
 void ColorCorrectionCalibrator::run() {
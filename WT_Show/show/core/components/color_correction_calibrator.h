@@ -11,6 +11,7 @@
 
 #include "components/live_video_stream_compositor.h"
 #include "model/application_state_model.h"
+#include "event/start_color_calibration_event.h"
 
 namespace capture {
 namespace components {
@@ -22,10 +23,8 @@ public:
     explicit ColorCorrectionCalibrator(QSharedPointer<model::ApplicationStateModel> model, QSharedPointer<components::LiveVideoStreamCompositor> compositor, QObject *parent = 0);
     virtual void run() override;
 
-protected:
-    virtual bool eventFilter(QObject *obj, QEvent *event);
-
 private:
+    void onStartColorCalibration(event::StartColorCalibrationEvent *event);
 
     QMutex m_mutex;
     QScopedPointer<QThreadPool> m_threadPool;
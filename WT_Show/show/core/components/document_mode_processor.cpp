@@ -14,6 +14,7 @@
 #include <global_utilities.h>
 
 #include "event/segment_object_event.h"
+#include "event/event_dispatcher.h"
 #include "common/measured_block.h"
 
 namespace capture {
@@ -29,26 +30,17 @@ DocumentModeProcessor::DocumentModeProcessor(QObject *parent)
     : QObject(parent)
     , m_threadPool(new QThreadPool) {
     setAutoDelete(false);
-    QCoreApplication::instance()->installEventFilter(this);
+    event::EventDispatcher::instance()->subscribe(this, &DocumentModeProcessor::onSegmentObject);
     m_threadPool->start(this);
 }
 
-bool DocumentModeProcessor::eventFilter(QObject *obj, QEvent *event) {
-    bool processed = false;
-
-    if (event->type() == event::SegmentObjectEvent::type()) {
-        if (auto segmentObjectEvent = static_cast<event::SegmentObjectEvent*>(event)) {
-            {
-                QMutexLocker locker(&m_mutex);
-                m_segmentationQueue.enqueue(segmentObjectEvent->model());
-            }
-
-            tryProcessNextModel();
-            processed = true;
-        }
+void DocumentModeProcessor::onSegmentObject(event::SegmentObjectEvent *event) {
+    {
+        QMutexLocker locker(&m_mutex);
+        m_segmentationQueue.enqueue(event->model());
     }
 
-    return processed ? processed : QObject::eventFilter(obj, event);
+    tryProcessNextModel();
 }
 
 void DocumentModeProcessor::tryProcessNextModel() {
@@ -71,7 +63,7 @@ void DocumentModeProcessor::run() {
     }
 
     if (model && model->segmentationState() == CaptureItemMetadata::SegmentationState::NotStarted) {
-        auto settings = GlobalUtilities::applicationSettings("segmentation");
+        auto settings = GlobalUtilities::settingsSnapshot("segmentation");
 
         // Delay start of the segmentation to get better user experience from switching to post capture
         QThread::msleep(settings->value("start_delay_ms", 150).toInt());
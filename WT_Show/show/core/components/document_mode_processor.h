@@ -12,6 +12,7 @@
 #include <QThreadPool>
 
 #include "model/camera_item_metadata.h"
+#include "event/segment_object_event.h"
 
 namespace capture {
 namespace components {
@@ -31,10 +32,8 @@ public:
     explicit DocumentModeProcessor(QObject *parent = 0);
     virtual void run() override;
 
-protected:
-    virtual bool eventFilter(QObject *obj, QEvent *event);
-
 private:
+    void onSegmentObject(event::SegmentObjectEvent *event);
     void tryProcessNextModel();
     QQueue<QSharedPointer<model::CameraItemMetadata>> m_segmentationQueue;
     QMutex m_mutex;
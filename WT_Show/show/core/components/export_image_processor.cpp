@@ -15,6 +15,7 @@
 #include <global_utilities.h>
 
 #include "event/export_project_items_event.h"
+#include "event/event_dispatcher.h"
 
 namespace capture {
 namespace components {
@@ -39,28 +40,16 @@ ExportImageProcessor::ExportImageProcessor(QSharedPointer<model::ProjectsExportM
     : QObject(parent), m_threadPool(new QThreadPool), m_model(model), m_offscreenRenderer(new common::OffScreenRenderer(true)) {
   setAutoDelete(false);
   connect(m_offscreenRenderer.data(), &common::OffScreenRenderer::imageReady, this, &ExportImageProcessor::onImageReady);
-  QCoreApplication::instance()->installEventFilter(this);
+  event::EventDispatcher::instance()->subscribe(this, &ExportImageProcessor::onExportProjectItems);
 }
 
-bool ExportImageProcessor::eventFilter(QObject *obj, QEvent *event) {
-  bool processed = false;
-
-  if (event->type() == event::ExportProjectItemsEvent::type()) {
-    auto exportImageEvent = static_cast<event::ExportProjectItemsEvent *>(event);
-
-    if (exportImageEvent != nullptr) {
-      {
-        QMutexLocker locker(&m_mutex);
-        m_exportImageQueue.enqueue({exportImageEvent->format(), exportImageEvent->location(),
-                                    exportImageEvent->items(), exportImageEvent->single()});
-      }
-
-      tryProcessNextModel();
-      processed = true;
-    }
+void ExportImageProcessor::onExportProjectItems(event::ExportProjectItemsEvent *event) {
+  {
+    QMutexLocker locker(&m_mutex);
+    m_exportImageQueue.enqueue({event->format(), event->location(), event->items(), event->single()});
   }
 
-  return processed ? processed : QObject::eventFilter(obj, event);
+  tryProcessNextModel();
 }
 
 void ExportImageProcessor::tryProcessNextModel() {
@@ -195,7 +184,7 @@ void ExportImageProcessor::exportImages(ExportModel model) {
       pathName = handleConflictName(pathName);
     }
 
-    auto settings = GlobalUtilities::applicationSettings("image_export");
+    auto settings = GlobalUtilities::settingsSnapshot("image_export");
     auto quality = -1;
 
     switch(model.format) {
@@ -240,7 +229,7 @@ void ExportImageProcessor::performOpticCharacterRecognitionAndExportPDF(ExportMo
         m_ocr.reset(new ocr::Ocr);
     }
 
-    auto settings = GlobalUtilities::applicationSettings("ocr");
+    auto settings = GlobalUtilities::settingsSnapshot("ocr");
 
     const static QStringList defaultRecognizedLanguages { "en-us", "zh-cn", "zh-tw" };
     const auto recognizedLanguages = settings->value("recognized_languages", defaultRecognizedLanguages).toStringList();
@@ -260,7 +249,7 @@ void ExportImageProcessor::performOpticCharacterRecognitionAndExportPDF(ExportMo
 void ExportImageProcessor::exportPDF(ExportModel model) {
   qDebug() << this << "Exporting to PDF";
 
-  auto settings = GlobalUtilities::applicationSettings("pdf_export");
+  auto settings = GlobalUtilities::settingsSnapshot("pdf_export");
 
   auto pdfLayoutLandscape = settings->value("layout_landscape", true).toBool();
   auto pdfDpi = settings->value("dpi", 600).toInt();
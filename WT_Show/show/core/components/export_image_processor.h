@@ -19,6 +19,7 @@
 #include "common/offscreen_renderer.h"
 #include "model/export_image_model.h"
 #include "model/projects_export_model.h"
+#include "event/export_project_items_event.h"
 
 namespace capture {
 namespace components {
@@ -46,10 +47,8 @@ class ExportImageProcessor : public QObject, public QRunnable {
   void clipboardUrlsReady(QList<QUrl> urls);
   void exportFailed(const QString& reason);
 
- protected:
-  virtual bool eventFilter(QObject *obj, QEvent *event);
-
  private:
+  void onExportProjectItems(event::ExportProjectItemsEvent *event);
   void tryProcessNextModel();
 
   struct ExportModel;
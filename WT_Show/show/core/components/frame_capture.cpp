@@ -14,6 +14,7 @@
 #include "event/segment_object_event.h"
 #include "event/capture_frame_event.h"
 #include "event/prepare_frame_capture_event.h"
+#include "event/event_dispatcher.h"
 #include "common/utilities.h"
 #include "common/final_act.h"
 #include "common/measured_block.h"
@@ -59,7 +60,8 @@ FrameCapture::FrameCapture(QSharedPointer<components::LiveVideoStreamCompositor>
         updateDepthStreams();
     }
 
-    QCoreApplication::instance()->installEventFilter(this);
+    event::EventDispatcher::instance()->subscribe(this, &FrameCapture::onCaptureFrame);
+    event::EventDispatcher::instance()->subscribe(this, &FrameCapture::onPrepareFrameCapture);
 
     m_depthCameraThread->start();
 }
@@ -132,45 +134,33 @@ void FrameCapture::onMatModeStateChanged(model::ApplicationStateModel::MatModeSt
     }
 }
 
-bool FrameCapture::eventFilter(QObject *obj, QEvent *event) {
-    bool processed = false;
-
-    if (event->type() == event::CaptureFrameEvent::type()) {
-        if (auto captureFrameEvent = static_cast<event::CaptureFrameEvent*>(event)) {
-            QMutexLocker locker(&m_mutex);
-            m_captureQueue.enqueue(CaptureData {
-                                       false,
-                                       captureFrameEvent->captureWithFlash(),
-                                       captureFrameEvent->captureNextFrame(),
-                                       captureFrameEvent->videoSources(),
-                                       captureFrameEvent->viewport(),
-                                       captureFrameEvent->inkData(),
-                                       captureFrameEvent->colorCorrectionMode()
-                                   });
-
-            m_threadPool->start(this);
-            processed = true;
-        }
-    }
-
-    if (event->type() == event::PrepareFrameCaptureEvent::type()) {
-        if (auto prepareFrameCaptureEvent = static_cast<event::PrepareFrameCaptureEvent*>(event)) {
-            QMutexLocker locker(&m_mutex);
-            m_captureQueue.enqueue(CaptureData {
-                                       true,
-                                       prepareFrameCaptureEvent->captureWithFlash(),
-                                       false,
-                                       prepareFrameCaptureEvent->videoSources(),
-                                       QRectF(),
-                                       QSharedPointer<InkData>()
-                                   });
-
-            m_threadPool->start(this);
-            processed = true;
-        }
-    }
+void FrameCapture::onCaptureFrame(event::CaptureFrameEvent *event) {
+    QMutexLocker locker(&m_mutex);
+    m_captureQueue.enqueue(CaptureData {
+                               false,
+                               event->captureWithFlash(),
+                               event->captureNextFrame(),
+                               event->videoSources(),
+                               event->viewport(),
+                               event->inkData(),
+                               event->colorCorrectionMode()
+                           });
+
+    m_threadPool->start(this);
+}
 
-    return processed ? processed : QObject::eventFilter(obj, event);
+void FrameCapture::onPrepareFrameCapture(event::PrepareFrameCaptureEvent *event) {
+    QMutexLocker locker(&m_mutex);
+    m_captureQueue.enqueue(CaptureData {
+                               true,
+                               event->captureWithFlash(),
+                               false,
+                               event->videoSources(),
+                               QRectF(),
+                               QSharedPointer<InkData>()
+                           });
+
+    m_threadPool->start(this);
 }
 
 void FrameCapture::run() {
@@ -224,7 +214,7 @@ void FrameCapture::prepareCapture(bool captureWithFlash, QVector<common::VideoSo
     }
 
     if (supportsOrbbecCapture(videoSources)) {
-        auto orbbecMeasuredBlock = common::measure_block(__FUNCTION__ "::orbbec"); Q_UNUSED(orbbecMeasuredBlock);
+        TRACE_SPAN(__FUNCTION__ "::orbbec")
 
         updateDepthStreams();
 
@@ -288,7 +278,7 @@ void FrameCapture::performCapture(bool captureWithFlash, bool captureNextFrame,
             QVector<sensordata::SensorData> hiresRgbSensorData;
             hiresRgbSensorData << captureResult.sensorData.first();
 
-            if (GlobalUtilities::applicationSettings("capture")->value("perform_image_enhancement", false).toBool()) {
+            if (GlobalUtilities::settingsSnapshot("capture")->value("perform_image_enhancement", false).toBool()) {
                 auto image = m_imageEnhancement->convertCapture(hiresRgbSensorData);
                 stageProject->items().first()->setImage(image);
                 // Force thumbnail update
@@ -17,6 +17,8 @@
 #include "components/live_video_stream_compositor.h"
 #include "model/application_state_model.h"
 #include "components/video_source_input.h"
+#include "event/capture_frame_event.h"
+#include "event/prepare_frame_capture_event.h"
 
 namespace capture {
 namespace components {
@@ -48,10 +50,6 @@ public:
 signals:
     void captureFailed();
 
-protected:
-
-    virtual bool eventFilter(QObject *obj, QEvent *event);
-
 private slots:
 
     void onMatModeStateChanged(capture::model::ApplicationStateModel::MatModeState matModeState);
@@ -62,6 +60,9 @@ private:
     struct CaptureData;
     struct CaptureResult;
 
+    void onCaptureFrame(event::CaptureFrameEvent *event);
+    void onPrepareFrameCapture(event::PrepareFrameCaptureEvent *event);
+
     QVector<sensordata::SensorData> captureCameraData(QVector<common::VideoSourceInfo> videoSources, bool captureWithFlash);
     QVector<sensordata::SensorData> captureOrbbecData();
     QImage captureLiveFrame(bool captureNextFrame, const QRectF &viewport);
@@ -288,7 +288,7 @@ void LiveVideoStreamCompositor::requestCapture(const QSize& size, const QRectF&
         for(auto type : m_model->selectedVideoStreamSources()) {
             int skipFrameCount = 1;
             if (type == common::VideoSourceInfo::DownwardFacingCamera()) {
-                skipFrameCount = GlobalUtilities::applicationSettings("capture")->value("downward_facing_camera_skip_frame_count", 3).toInt();
+                skipFrameCount = GlobalUtilities::settingsSnapshot("capture")->value("downward_facing_camera_skip_frame_count", 3).toInt();
             }
 
             captureItem.sourceSkipFrameCount.insert(m_model->videoStreamSource(type)->pipelineName(), skipFrameCount);
@@ -351,7 +351,7 @@ void LiveVideoStreamCompositor::blitFramebuffer(QOpenGLFramebufferObject *target
     }
 
     if (capturedFrameBuffer) {
-        auto settings = GlobalUtilities::applicationSettings("composited_video");
+        auto settings = GlobalUtilities::settingsSnapshot("composited_video");
         const auto image = capturedFrameBuffer->toImage();
         const auto storagePath = settings->value("captured_images_folder", QString()).toString();
 
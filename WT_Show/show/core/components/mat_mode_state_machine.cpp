@@ -7,6 +7,7 @@
 #include <QtConcurrentRun>
 
 #include "common/utilities.h"
+#include "event/event_dispatcher.h"
 
 namespace capture {
 namespace components {
@@ -15,7 +16,7 @@ MatModeStateMachine::MatModeStateMachine(QObject *parent)
     : QObject(parent),
       m_worker(new MatModeStateMachineWorker),
       m_workerThread(new QThread) {
-  QCoreApplication::instance()->installEventFilter(this);
+  event::EventDispatcher::instance()->subscribe(this, &MatModeStateMachine::onChangeMatMode);
   m_worker->moveToThread(m_workerThread.data());
 
   connect(this, &MatModeStateMachine::transitionRequested, m_worker.data(),
@@ -64,19 +65,10 @@ MatModeStateMachine::~MatModeStateMachine() {
   abort();  
 }
 
-bool MatModeStateMachine::eventFilter(QObject *obj, QEvent *event) {
-  bool processed = false;
-
-  if (event->type() == event::ChangeMatModeEvent::type()) {
-    auto changeMatModeEvent = static_cast<event::ChangeMatModeEvent *>(event);
-
-    if (changeMatModeEvent != nullptr && changeMatModeEvent->mode() != event::ChangeMatModeEvent::None) {
-      emit transitionRequested(changeMatModeEvent->mode());
-      processed = true;
-    }
+void MatModeStateMachine::onChangeMatMode(event::ChangeMatModeEvent *event) {
+  if (event->mode() != event::ChangeMatModeEvent::None) {
+    emit transitionRequested(event->mode());
   }
-
-  return processed ? processed : QObject::eventFilter(obj, event);
 }
 
 void MatModeStateMachine::onVideoStreamStateChanged() {
@@ -50,7 +50,7 @@ class MatModeStateMachine : public QObject {
   void abort();
 
  protected:
-  virtual bool eventFilter(QObject *obj, QEvent *event);
+  void onChangeMatMode(event::ChangeMatModeEvent *event);
   bool checkForRunningCamera();
 
   QMutex m_mutex;
@@ -17,6 +17,7 @@
 #include "event/export_projects_event.h"
 #include "event/launch_worktool_event.h"
 #include "event/change_mat_mode_event.h"
+#include "event/event_dispatcher.h"
 #include "common/utilities.h"
 #include "model/camera_item_metadata.h"
 #include "common/measured_block.h"
@@ -103,26 +104,16 @@ StageProjectExporter::StageProjectExporter(QSharedPointer<model::ProjectsExportM
     , m_threadPool(new QThreadPool)
     , m_model(model) {
     setAutoDelete(false);
-    QCoreApplication::instance()->installEventFilter(this);
+    event::EventDispatcher::instance()->subscribe(this, &StageProjectExporter::onExportProjects);
 }
 
-bool StageProjectExporter::eventFilter(QObject *obj, QEvent *event) {
-    bool processed = false;
-
-    if (event->type() == event::ExportProjectsEvent::type()) {
-        if (auto exportEvent = static_cast<event::ExportProjectsEvent*>(event))
-        {
-            {
-                QMutexLocker locker(&m_mutex);
-                m_exportQueue.enqueue(exportEvent->projects());
-            }
-
-            tryExportNextProject();
-            processed = true;
-        }
+void StageProjectExporter::onExportProjects(event::ExportProjectsEvent *event) {
+    {
+        QMutexLocker locker(&m_mutex);
+        m_exportQueue.enqueue(event->projects());
     }
 
-    return processed ? processed : QObject::eventFilter(obj, event);
+    tryExportNextProject();
 }
 
 void StageProjectExporter::tryExportNextProject() {
@@ -297,8 +288,8 @@ void StageProjectExporter::zipImageFile(QuaZip &zipFile, const QString & fileNam
     QImageWriter writer(&imageBuffer, imageFormat().toLocal8Bit());
 
     // Lossless compression
-    writer.setQuality(GlobalUtilities::applicationSettings("stage_export")->value("quality", 100).toInt());
-    writer.setCompression(GlobalUtilities::applicationSettings("stage_export")->value("compression", 100).toInt());
+    writer.setQuality(GlobalUtilities::settingsSnapshot("stage_export")->value("quality", 100).toInt());
+    writer.setCompression(GlobalUtilities::settingsSnapshot("stage_export")->value("compression", 100).toInt());
 
     // QuaZip doesn't support seek operation so we need to write to intermediate buffer first
     if (!writer.write(image.convertToFormat(QImage::Format_ARGB32))) {
@@ -311,7 +302,7 @@ void StageProjectExporter::zipImageFile(QuaZip &zipFile, const QString & fileNam
         throw std::exception("Failed to seek to start of the stream");
     }
 
-    auto zipCompression = GlobalUtilities::applicationSettings("stage_export")->value("zip_compression", 0).toInt();
+    auto zipCompression = GlobalUtilities::settingsSnapshot("stage_export")->value("zip_compression", 0).toInt();
     auto fullFileName = QString("%1.%2").arg(fileName).arg(imageFormat());
 
     if (!file.open(QIODevice::WriteOnly, fullFileName, NULL, 0, Z_DEFLATED, zipCompression)) {
@@ -367,7 +358,7 @@ void StageProjectExporter::zipSensorDataFiles(QuaZip &zipFile, FlatExportList &f
 
 QString StageProjectExporter::imageFormat()
 {
-    return GlobalUtilities::applicationSettings("stage_export")->value("image_format", "bmp").toString();
+    return GlobalUtilities::settingsSnapshot("stage_export")->value("image_format", "bmp").toString();
 }
 
 void StageProjectExporter::writeStageItem(QXmlStreamWriter &xmlWriter, FlatExportList &flatItemList, QSharedPointer<StageItem> stageItem)
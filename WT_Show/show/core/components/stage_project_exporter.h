@@ -14,6 +14,7 @@
 #include <stage_project.h>
 
 #include "model/projects_export_model.h"
+#include "event/export_projects_event.h"
 
 namespace capture {
 namespace components {
@@ -32,10 +33,8 @@ public:
 signals:
     void exportFailed(const QString& msg);
 
-protected:
-    virtual bool eventFilter(QObject *obj, QEvent *event);
-
 private:
+    void onExportProjects(event::ExportProjectsEvent *event);
 
     struct StageItemExportData;
     typedef QList<StageItemExportData> FlatExportList;
@@ -8,6 +8,7 @@
 #include "event/change_application_state_event.h"
 #include "event/start_video_streaming_event.h"
 #include "event/change_mat_mode_event.h"
+#include "event/event_dispatcher.h"
 
 #ifdef Q_OS_WIN
 
@@ -74,7 +75,7 @@ SystemEventMonitor::SystemEventMonitor(QSharedPointer<model::ApplicationStateMod
   connect(app, &QApplication::applicationStateChanged, this,
           &SystemEventMonitor::onApplicationStateChanged);
 
-  QCoreApplication::instance()->installEventFilter(this);
+  event::EventDispatcher::instance()->subscribe(this, &SystemEventMonitor::onChangeApplicationState);
 
   m_currentUserName = activeUserName();
 
@@ -127,27 +128,15 @@ void SystemEventMonitor::onDisplayOn() {
   }
 }
 
-bool SystemEventMonitor::eventFilter(QObject *obj, QEvent *event) {
-  bool processed = false;
+void SystemEventMonitor::onChangeApplicationState(event::ChangeApplicationStateEvent *event) {
+  // In Presentation mode application should not be suspended
+  m_model->setMonitorWindowMinimized(event->suspended());
 
-  if (event->type() == event::ChangeApplicationStateEvent::type()) {
-    auto changeApplicationStateEvent = static_cast<event::ChangeApplicationStateEvent *>(event);
-
-    // In Presentation mode application should not be suspended
-    if (changeApplicationStateEvent != nullptr) {
-      m_model->setMonitorWindowMinimized(changeApplicationStateEvent->suspended());
-
-      if (changeApplicationStateEvent->suspended()) {
-        suspend(true);
-      } else {
-        resume(false);
-      }
-
-      processed = true;
-    }
+  if (event->suspended()) {
+    suspend(true);
+  } else {
+    resume(false);
   }
-
-  return processed ? processed : QObject::eventFilter(obj, event);
 }
 
 void SystemEventMonitor::onSystemSuspend() { suspend(false); }
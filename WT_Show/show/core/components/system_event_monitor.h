@@ -11,6 +11,7 @@
 #include <user_event_handler.h>
 
 #include "model/application_state_model.h"
+#include "event/change_application_state_event.h"
 
 namespace capture {
 namespace components {
@@ -44,7 +45,7 @@ protected:
 
     void suspend(bool isApplicationSuspend);
     void resume(bool changeMatModeToPreSuspendMode);
-    virtual bool eventFilter(QObject *obj, QEvent *event);
+    void onChangeApplicationState(event::ChangeApplicationStateEvent *event);
 
     QSharedPointer<model::ApplicationStateModel> m_model;
     QScopedPointer<proapi::hal::System> m_sohalSystem;
@@ -11,6 +11,7 @@
 #include "common/utilities.h"
 #include "event/start_video_streaming_event.h"
 #include "event/stop_video_streaming_event.h"
+#include "event/event_dispatcher.h"
 
 namespace capture {
 namespace components {
@@ -28,7 +29,8 @@ VideoSourceInput::VideoSourceInput(QSharedPointer<components::LiveVideoStreamCom
     connect(m_compositor.data(), &LiveVideoStreamCompositor::streamFrozen, this, &VideoSourceInput::onStreamFrozen);
     connect(m_compositor.data(), &LiveVideoStreamCompositor::updated, this, &VideoSourceInput::onCompositorUpdated);
 
-    QCoreApplication::instance()->installEventFilter(this);
+    event::EventDispatcher::instance()->subscribe(this, &VideoSourceInput::onStartVideoStreaming);
+    event::EventDispatcher::instance()->subscribe(this, &VideoSourceInput::onStopVideoStreaming);
 }
 
 VideoSourceInput::~VideoSourceInput() {
@@ -88,23 +90,13 @@ void VideoSourceInput::onCompositorUpdated() {
     m_model->liveCapture()->setVideoStreamState(model::LiveCaptureModel::VideoStreamState::Running);
 }
 
-bool VideoSourceInput::eventFilter(QObject *obj, QEvent *event) {
-    bool processed = false;
-
-    if (event->type() == event::StartVideoStreamingEvent::type()) {
-        if (auto startVideoStreamingEvent = static_cast<event::StartVideoStreamingEvent*>(event)) {
-            start(startVideoStreamingEvent->videoSources());
-            processed = true;
-        }
-    }
-    else if (event->type() == event::StopVideoStreamingEvent::type()) {
-        if (auto stopVideoStreamingEvent = static_cast<event::StopVideoStreamingEvent*>(event)) {
-            stop();
-            processed = true;
-        }
-    }
+void VideoSourceInput::onStartVideoStreaming(event::StartVideoStreamingEvent *event) {
+    start(event->videoSources());
+}
 
-    return processed ? processed : QObject::eventFilter(obj, event);
+void VideoSourceInput::onStopVideoStreaming(event::StopVideoStreamingEvent *event) {
+    Q_UNUSED(event)
+    stop();
 }
 
 void VideoSourceInput::start(QVector<common::VideoSourceInfo> videoSources)
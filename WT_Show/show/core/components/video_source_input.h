@@ -13,6 +13,8 @@
 
 #include "model/application_state_model.h"
 #include "live_video_stream_compositor.h"
+#include "event/start_video_streaming_event.h"
+#include "event/stop_video_streaming_event.h"
 
 namespace capture {
 namespace components {
@@ -31,14 +33,12 @@ public:
 
     QSharedPointer<model::VideoStreamSourceModel> cameraModel() const;
 
-protected:
-
-    virtual bool eventFilter(QObject *obj, QEvent *event);
-
 signals:
     void isEnabledChanged(bool isEnabled);
 
 private:
+    void onStartVideoStreaming(event::StartVideoStreamingEvent *event);
+    void onStopVideoStreaming(event::StopVideoStreamingEvent *event);
     void start(QVector<common::VideoSourceInfo> videoSources);
     void stop();
 
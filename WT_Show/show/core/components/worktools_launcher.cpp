@@ -6,6 +6,7 @@
 
 #include "common/utilities.h"
 #include "styled_message_box.h"
+#include "event/event_dispatcher.h"
 
 #ifdef Q_OS_WIN
 
@@ -22,22 +23,12 @@ namespace components {
 WorktoolsLauncher::WorktoolsLauncher(QObject *parent)
     : QObject(parent)
 {
-    QCoreApplication::instance()->installEventFilter(this);
+    event::EventDispatcher::instance()->subscribe(this, &WorktoolsLauncher::onLaunchWorktool);
 }
 
-bool WorktoolsLauncher::eventFilter(QObject *obj, QEvent *event)
+void WorktoolsLauncher::onLaunchWorktool(event::LaunchWorktoolEvent *event)
 {
-    bool processed = false;
-
-    if (event->type() == event::LaunchWorktoolEvent::type()) {
-        if (auto launchWorktoolEvent = static_cast<event::LaunchWorktoolEvent*>(event)) {
-            launchWorktool(launchWorktoolEvent->worktool(), launchWorktoolEvent->parameters());
-
-            processed = true;
-        }
-    }
-
-    return processed ? processed : QObject::eventFilter(obj, event);
+    launchWorktool(event->worktool(), event->parameters());
 }
 
 bool WorktoolsLauncher::launchWorktool(event::LaunchWorktoolEvent::Worktool worktool, QStringList parameters)
@@ -14,9 +14,8 @@ class WorktoolsLauncher : public QObject
 public:
     explicit WorktoolsLauncher(QObject *parent = 0);
 
-    virtual bool eventFilter(QObject *obj, QEvent *event);
-
 private:
+    void onLaunchWorktool(event::LaunchWorktoolEvent *event);
 
     bool launchWorktool(event::LaunchWorktoolEvent::Worktool worktool, QStringList parameters);
 };
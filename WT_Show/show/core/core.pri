@@ -4,6 +4,9 @@ include($$PWD/../../shared/shared.pri)
 QT       += core widgets gui multimedia multimediawidgets concurrent svg printsupport
 CONFIG   += c++11 force_debug_info
 
+# file and line in release builds too, the log handler rate limits per call site
+DEFINES  += QT_MESSAGELOGCONTEXT
+
 win32:LIBS += -lUser32 -lShell32 -lWtsapi32 -lwevtapi
 
 RC_ICONS += $$PWD/Resources/production/show.ico
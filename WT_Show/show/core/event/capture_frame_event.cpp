@@ -1,6 +1,6 @@
 #include "capture_frame_event.h"
 
-#include <QCoreApplication>
+#include "event_dispatcher.h"
 
 namespace capture {
 namespace event {
@@ -29,7 +29,7 @@ void CaptureFrameEvent::dispatch() {
              << "captureWithFlash" << m_captureNextFrame
              << "colorCorrectionMode" << m_colorCorrectionMode
              << "videoSources" << m_videoSources;
-    QCoreApplication::postEvent(QCoreApplication::instance(), this);
+    EventDispatcher::post(this);
 }
 
 } // namespace event
@@ -1,6 +1,6 @@
 #include "change_application_state_event.h"
 
-#include <QCoreApplication>
+#include "event_dispatcher.h"
 
 namespace capture {
 namespace event {
@@ -16,7 +16,7 @@ QEvent::Type ChangeApplicationStateEvent::type() {
 }
 
 void ChangeApplicationStateEvent::dispatch() {
-    QCoreApplication::postEvent(QCoreApplication::instance(), this);
+    EventDispatcher::post(this);
 }
 
 } // namespace event
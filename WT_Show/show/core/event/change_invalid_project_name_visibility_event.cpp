@@ -1,6 +1,6 @@
 #include "change_invalid_project_name_visibility_event.h"
 
-#include <QCoreApplication>
+#include "event_dispatcher.h"
 
 namespace capture {
 namespace event {
@@ -17,7 +17,7 @@ QEvent::Type ChangeInvalidProjectNameVisibilityEvent::type() {
 }
 
 void ChangeInvalidProjectNameVisibilityEvent::dispatch() {
-    QCoreApplication::postEvent(QCoreApplication::instance(), this);
+    EventDispatcher::post(this);
 }
 
 } // namespace event
@@ -1,6 +1,6 @@
 #include "change_mat_mode_event.h"
 
-#include <QCoreApplication>
+#include "event_dispatcher.h"
 
 namespace capture {
 namespace event {
@@ -23,7 +23,7 @@ QEvent::Type ChangeMatModeEvent::type() {
 
 void ChangeMatModeEvent::dispatch() {
     qDebug() << "Dispatching event" << typeid(*this).name() << "mode" << m_mode;
-    QCoreApplication::postEvent(QCoreApplication::instance(), this);
+    EventDispatcher::post(this);
 }
 
 } // namespace event
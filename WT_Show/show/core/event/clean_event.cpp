@@ -1,6 +1,6 @@
 #include "clean_event.h"
 
-#include <QCoreApplication>
+#include "event_dispatcher.h"
 
 namespace capture {
 namespace event {
@@ -18,7 +18,7 @@ QEvent::Type CleanEvent::type()
 
 void CleanEvent::dispatch()
 {
-    QCoreApplication::postEvent(QCoreApplication::instance(), this);
+    EventDispatcher::post(this);
 }
 
 } // namespace event
@@ -0,0 +1,110 @@
+#include "event_dispatcher.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QDebug>
+
+namespace capture {
+namespace event {
+
+EventDispatcher::EventDispatcher(QObject *parent)
+    : QObject(parent)
+    , m_statistics{0, 0, 0, 0, 0}
+{ }
+
+EventDispatcher::~EventDispatcher() {
+    if (m_statistics.events > 0) {
+        qDebug() << this << "Delivered" << m_statistics.events << "events to" << m_statistics.handlers << "handlers,"
+                 << m_statistics.unhandledEvents << "unhandled, dispatch avg"
+                 << m_statistics.totalDispatchNs / qint64(m_statistics.events) << "ns max" << m_statistics.maxDispatchNs << "ns";
+    }
+}
+
+EventDispatcher* EventDispatcher::instance() {
+    // Owned by the application, it lives in the main thread whichever thread asks first
+    static EventDispatcher *dispatcher = [] {
+        auto app = QCoreApplication::instance();
+        auto result = new EventDispatcher(nullptr);
+        result->moveToThread(app->thread());
+        result->setParent(app);
+        return result;
+    }();
+
+    return dispatcher;
+}
+
+void EventDispatcher::post(QEvent *event) {
+    QCoreApplication::postEvent(instance(), event);
+}
+
+void EventDispatcher::subscribe(QEvent::Type type, QObject *receiver, Handler handler) {
+    {
+        QMutexLocker locker(&m_mutex);
+        m_subscriptions[type].append(Subscription { receiver, handler });
+        m_statistics.handlers++;
+    }
+
+    connect(receiver, &QObject::destroyed, this, [this](QObject *object) { unsubscribe(object); }, Qt::DirectConnection);
+}
+
+void EventDispatcher::unsubscribe(QObject *receiver) {
+    QMutexLocker locker(&m_mutex);
+
+    for (auto it = m_subscriptions.begin(); it != m_subscriptions.end(); ++it) {
+        auto &subscriptions = it.value();
+
+        for (int i = subscriptions.count() - 1; i >= 0; i--) {
+            // A destroyed receiver already reads as null
+            if (subscriptions[i].receiver == receiver || subscriptions[i].receiver.isNull()) {
+                subscriptions.remove(i);
+                m_statistics.handlers--;
+            }
+        }
+    }
+}
+
+EventDispatcher::Statistics EventDispatcher::statistics() const {
+    QMutexLocker locker(&m_mutex);
+    return m_statistics;
+}
+
+bool EventDispatcher::event(QEvent *event) {
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<Subscription> subscriptions;
+    bool subscribed = false;
+
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_subscriptions.constFind(event->type());
+        subscribed = it != m_subscriptions.constEnd() && !it.value().isEmpty();
+
+        if (subscribed) {
+            // Copied, handlers may subscribe or get destroyed while running
+            subscriptions = it.value();
+        }
+
+        qint64 elapsed = timer.nsecsElapsed();
+        m_statistics.events++;
+        m_statistics.unhandledEvents += subscribed ? 0 : 1;
+        m_statistics.totalDispatchNs += elapsed;
+        m_statistics.maxDispatchNs = qMax(m_statistics.maxDispatchNs, elapsed);
+    }
+
+    if (!subscribed) {
+        return QObject::event(event);
+    }
+
+    for (const auto &subscription : subscriptions) {
+        if (!subscription.receiver.isNull()) {
+            subscription.handler(event);
+        }
+    }
+
+    return true;
+}
+
+} // namespace event
+} // namespace capture
@@ -0,0 +1,79 @@
+#pragma once
+#ifndef EVENT_DISPATCHER_H
+#define EVENT_DISPATCHER_H
+
+#include <QObject>
+#include <QEvent>
+#include <QHash>
+#include <QMutex>
+#include <QPointer>
+#include <QVector>
+
+#include <functional>
+
+namespace capture {
+namespace event {
+
+/*!
+ * \brief The EventDispatcher class delivers the application events (CaptureFrameEvent, ExportProjectItemsEvent, ...) to the components
+ * \brief that subscribed to their type.
+ * \details Events are posted to the dispatcher instead of the application object, so components no longer need an application wide
+ * \details event filter and ordinary Qt events (paint, mouse, timers) never reach them. Handlers run in the main thread.
+ */
+class EventDispatcher : public QObject
+{
+    Q_OBJECT
+public:
+    typedef std::function<void(QEvent*)> Handler;
+
+    struct Statistics {
+        int handlers;               // subscribed handlers
+        quint64 events;             // delivered events
+        quint64 unhandledEvents;    // events nobody subscribed to
+        qint64 totalDispatchNs;     // time spent finding handlers, handler bodies excluded
+        qint64 maxDispatchNs;
+    };
+
+    static EventDispatcher* instance();
+
+    /*!
+     * \brief Queues the event for delivery in the main thread and takes its ownership, like QCoreApplication::postEvent.
+     */
+    static void post(QEvent *event);
+
+    /*!
+     * \brief Calls receiver->method(event) for every posted event of type EventT, until the receiver is destroyed.
+     */
+    template <class EventT, class Receiver>
+    void subscribe(Receiver *receiver, void (Receiver::*method)(EventT*)) {
+        subscribe(EventT::type(), receiver, [receiver, method](QEvent *event) {
+            (receiver->*method)(static_cast<EventT*>(event));
+        });
+    }
+
+    void subscribe(QEvent::Type type, QObject *receiver, Handler handler);
+    void unsubscribe(QObject *receiver);
+
+    Statistics statistics() const;
+
+protected:
+    virtual bool event(QEvent *event) override;
+
+private:
+    explicit EventDispatcher(QObject *parent);
+    virtual ~EventDispatcher();
+
+    struct Subscription {
+        QPointer<QObject> receiver;
+        Handler handler;
+    };
+
+    mutable QMutex m_mutex;
+    QHash<int, QVector<Subscription>> m_subscriptions;
+    Statistics m_statistics;
+};
+
+} // namespace event
+} // namespace capture
+
+#endif // EVENT_DISPATCHER_H
@@ -1,6 +1,6 @@
 #include "export_project_items_event.h"
 
-#include <QCoreApplication>
+#include "event_dispatcher.h"
 
 namespace capture {
 namespace event {
@@ -28,7 +28,7 @@ QEvent::Type ExportProjectItemsEvent::type() {
 }
 
 void ExportProjectItemsEvent::dispatch() {
-    QCoreApplication::postEvent(QCoreApplication::instance(), this);
+    EventDispatcher::post(this);
 }
 
 } // namespace event
@@ -1,6 +1,6 @@
 #include "export_projects_event.h"
 
-#include <QCoreApplication>
+#include "event_dispatcher.h"
 
 namespace capture {
 namespace event {
@@ -16,7 +16,7 @@ QEvent::Type ExportProjectsEvent::type() {
 }
 
 void ExportProjectsEvent::dispatch() {
-    QCoreApplication::postEvent(QCoreApplication::instance(), this);
+    EventDispatcher::post(this);
 }
 
 } // namespace event
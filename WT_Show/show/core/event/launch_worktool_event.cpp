@@ -1,6 +1,6 @@
 #include "launch_worktool_event.h"
 
-#include <QCoreApplication>
+#include "event_dispatcher.h"
 
 namespace capture {
 namespace event {
@@ -25,7 +25,7 @@ QEvent::Type LaunchWorktoolEvent::type() {
 }
 
 void LaunchWorktoolEvent::dispatch() {
-    QCoreApplication::postEvent(QCoreApplication::instance(), this);
+    EventDispatcher::post(this);
 }
 
 } // namespace event
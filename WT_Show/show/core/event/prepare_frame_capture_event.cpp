@@ -1,6 +1,6 @@
 #include "prepare_frame_capture_event.h"
 
-#include <QCoreApplication>
+#include "event_dispatcher.h"
 
 namespace capture {
 namespace event {
@@ -21,7 +21,7 @@ void PrepareFrameCaptureEvent::dispatch() {
              << "captureWithFlash" << m_captureWithFlash
              << "videoSources" << m_videoSources;
 
-    QCoreApplication::postEvent(QCoreApplication::instance(), this);
+    EventDispatcher::post(this);
 }
 
 } // namespace event
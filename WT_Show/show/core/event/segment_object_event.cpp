@@ -1,6 +1,6 @@
 #include "segment_object_event.h"
 
-#include <QCoreApplication>
+#include "event_dispatcher.h"
 
 namespace capture {
 namespace event {
@@ -16,7 +16,7 @@ QEvent::Type SegmentObjectEvent::type() {
 }
 
 void SegmentObjectEvent::dispatch() {
-    QCoreApplication::postEvent(QCoreApplication::instance(), this);
+    EventDispatcher::post(this);
 }
 
 } // namespace event
@@ -1,6 +1,6 @@
 #include "start_color_calibration_event.h"
 
-#include <QCoreApplication>
+#include "event_dispatcher.h"
 
 namespace capture {
 namespace event {
@@ -16,7 +16,7 @@ QEvent::Type StartColorCalibrationEvent::type() {
 
 void StartColorCalibrationEvent::dispatch() {
     qDebug() << "Dispatching event" << typeid(*this).name();
-    QCoreApplication::postEvent(QCoreApplication::instance(), this);
+    EventDispatcher::post(this);
 }
 
 } // namespace event
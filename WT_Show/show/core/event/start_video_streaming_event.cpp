@@ -1,6 +1,6 @@
 #include "start_video_streaming_event.h"
 
-#include <QCoreApplication>
+#include "event_dispatcher.h"
 
 namespace capture {
 namespace event {
@@ -17,7 +17,7 @@ QEvent::Type StartVideoStreamingEvent::type() {
 
 void StartVideoStreamingEvent::dispatch() {
     qDebug() << "Dispatching event" << typeid(*this).name() << ":" << m_videoSources;
-    QCoreApplication::postEvent(QCoreApplication::instance(), this);
+    EventDispatcher::post(this);
 }
 
 } // namespace event
@@ -1,6 +1,6 @@
 #include "stop_video_streaming_event.h"
 
-#include <QCoreApplication>
+#include "event_dispatcher.h"
 
 namespace capture {
 namespace event {
@@ -18,7 +18,7 @@ QEvent::Type StopVideoStreamingEvent::type()
 void StopVideoStreamingEvent::dispatch()
 {
     qDebug() << "Dispatching event" << typeid(*this).name();
-    QCoreApplication::postEvent(QCoreApplication::instance(), this);
+    EventDispatcher::post(this);
 }
 
 } // namespace event
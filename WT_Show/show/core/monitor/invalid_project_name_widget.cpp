@@ -4,6 +4,7 @@
 #include <global_utilities.h>
 
 #include "event/change_invalid_project_name_visibility_event.h"
+#include "event/event_dispatcher.h"
 #include "common/utilities.h"
 
 namespace capture {
@@ -16,7 +17,7 @@ InvalidProjectNameWidget::InvalidProjectNameWidget(QWidget *parent)
     ui->setupUi(this);
     setAutoFillBackground(true);
 
-    QCoreApplication::instance()->installEventFilter(this);
+    event::EventDispatcher::instance()->subscribe(this, &InvalidProjectNameWidget::onChangeVisibility);
 
     auto settings = GlobalUtilities::applicationSettings("invalid_project_name_notification");
 
@@ -50,33 +51,21 @@ void InvalidProjectNameWidget::setText(QString text)
     ui->messageLabel->setText(text);
 }
 
-bool InvalidProjectNameWidget::eventFilter(QObject *obj, QEvent *event)
+void InvalidProjectNameWidget::onChangeVisibility(event::ChangeInvalidProjectNameVisibilityEvent *event)
 {
-    bool accepted = false;
+    if (event->visible()) {
+        show();
+        raise();
 
-    if (event->type() == event::ChangeInvalidProjectNameVisibilityEvent::type()) {
-        auto showInvalidProjectNameEvent = static_cast<event::ChangeInvalidProjectNameVisibilityEvent*>(event);
+        qDebug() << this << "Showing at" << event->globalPosition();
 
-        if (showInvalidProjectNameEvent != nullptr) {
-            if (showInvalidProjectNameEvent->visible()) {
-                show();
-                raise();
+        move(this->x(), parentWidget()->mapFromGlobal(event->globalPosition()).y() - 15);
 
-                qDebug() << this << "Showing at" << showInvalidProjectNameEvent->globalPosition();
-
-                move(this->x(), parentWidget()->mapFromGlobal(showInvalidProjectNameEvent->globalPosition()).y() - 15);
-
-                m_fadeOutAnimation->stop();
-                m_fadeOutAnimation->start();
-            } else {
-                setVisible(false);
-            }
-
-            accepted = true;
-        }
+        m_fadeOutAnimation->stop();
+        m_fadeOutAnimation->start();
+    } else {
+        setVisible(false);
     }
-
-    return accepted ? accepted : QWidget::eventFilter(obj, event) ;
 }
 
 void InvalidProjectNameWidget::paintEvent(QPaintEvent* event) {
@@ -6,6 +6,8 @@
 #include <QGraphicsOpacityEffect>
 #include <QPropertyAnimation>
 
+#include "event/change_invalid_project_name_visibility_event.h"
+
 namespace Ui {
 class InvalidProjectNameWidget;
 }
@@ -25,8 +27,6 @@ public:
     QString text() const;
 
 protected:
-
-    virtual bool eventFilter(QObject *obj, QEvent *event) Q_DECL_OVERRIDE;
     virtual void paintEvent(QPaintEvent* event) override;
 
 public slots:
@@ -34,6 +34,8 @@ public slots:
     void setText(QString text);
 
 private:
+    void onChangeVisibility(event::ChangeInvalidProjectNameVisibilityEvent *event);
+
     Ui::InvalidProjectNameWidget *ui;
 
     QGraphicsOpacityEffect m_opacityEffect;
@@ -4,6 +4,7 @@
 #include <QMessageBox>
 #include <QTranslator>
 #include <QScopedPointer>
+#include <QDir>
 
 #ifdef Q_OS_WIN
 #include <crash_handler.h>
@@ -23,6 +24,8 @@
 #include "components/live_video_stream_compositor.h"
 #include "components/color_correction_calibrator.h"
 #include "common/utilities.h"
+#include "common/async_log_handler.h"
+#include "common/trace.h"
 #include "monitor/monitor_window.h"
 #include "mat/mat_window.h"
 #include "presentation/presentation_mode_window.h"
@@ -78,13 +81,15 @@ int CaptureWorktool::exec(int argc, char **argv) {
 
         try
         {
-            hp::fortis::Logger::install("HP/WorkTools/Capture/log", "Capture");
+            common::AsyncLogHandler::install("HP/WorkTools/Capture/log", "Capture");
         }
         catch (const spdlog::spdlog_ex& ex)
         {
             qWarning() << "Cannot install custom logging handler, reason" << ex.what();
         }
 
+        common::Trace::initialize();
+
         qInfo() << this << "Checking for single instance server name" << singleInstanceId;
 
         auto singleInstance = QSharedPointer<SingleInstance>::create(singleInstanceId);
@@ -207,9 +212,17 @@ int CaptureWorktool::exec(int argc, char **argv) {
             });
 
             exitCode = a.exec();
+
+            // Tracing may have been switched off before exit, what was recorded is still worth keeping
+            if (common::Trace::hasSpans()) {
+                auto defaultTraceFile = QDir::temp().absoluteFilePath("capture_trace.json");
+                common::Trace::exportChromeJson(GlobalUtilities::settingsSnapshot()->value("trace_file", defaultTraceFile).toString());
+            }
         }
     }
 
+    common::AsyncLogHandler::uninstall();
+
     return exitCode;
 }
 
@@ -35,11 +35,17 @@ void ofApp::setup(){
 //--------------------------------------------------------------
 void ofApp::exit(){
     ofRemoveListener(vidRecorder.outputFileCompleteEvent, this, &ofApp::recordingComplete);
-    vidRecorder.close();
+    closeHandle = vidRecorder.close();
+    if(closeHandle) {
+        // the app is going away, this is the one place it is fine to block.
+        closeHandle->waitForCompletion();
+    }
 }
 
 //--------------------------------------------------------------
 void ofApp::update(){
+    benchmark.update();
+    vidRecorder.update();
     vidGrabber.update();
     if(vidGrabber.isFrameNew() && bRecording){
         bool success = vidRecorder.addFrame(vidGrabber.getPixels());
@@ -66,12 +72,20 @@ void ofApp::draw(){
     stringstream ss;
     ss << "video queue size: " << vidRecorder.getVideoQueueSize() << endl
     << "audio queue size: " << vidRecorder.getAudioQueueSize() << endl
+    << "dropped / duplicated: " << vidRecorder.getNumVideoFramesDropped() << " / " << vidRecorder.getNumVideoFramesDuplicated() << endl
     << "FPS: " << ofGetFrameRate() << endl
     << (bRecording?"pause":"start") << " recording: r" << endl
-    << (bRecording?"close current video file: c":"") << endl;
+    << (bRecording?"close current video file: c":"") << endl
+    << "720p30 capacity benchmark: b" << endl;
+    if(benchmark.isRunning() || benchmark.isFinished()) {
+        ss << benchmark.getReport() << endl;
+    }
+    if(closeHandle && !closeHandle->isComplete()) {
+        ss << "finalizing: " << (int)(closeHandle->getProgress() * 100) << "%" << endl;
+    }
 
     ofSetColor(0,0,0,100);
-    ofDrawRectangle(0, 0, 260, 75);
+    ofDrawRectangle(0, 0, 420, 130);
     ofSetColor(255, 255, 255);
     ofDrawBitmapString(ss.str(),15,15);
 
@@ -90,6 +104,7 @@ void ofApp::audioIn(float *input, int bufferSize, int nChannels){
 //--------------------------------------------------------------
 void ofApp::recordingComplete(ofxVideoRecorderOutputFileCompleteEventArgs& args){
     cout << "The recoded video file is now complete." << endl;
+    vidRecorder.saveStatsCsv(args.fileName + ".stats.csv");
 }
 
 //--------------------------------------------------------------
@@ -117,9 +132,12 @@ void ofApp::keyReleased(int key){
             vidRecorder.setPaused(false);
         }
     }
+    if(key=='b' && !benchmark.isRunning()){
+        benchmark.setup(1280, 720, 30);
+    }
     if(key=='c'){
         bRecording = false;
-        vidRecorder.close();
+        closeHandle = vidRecorder.close();
     }
 }
 
@@ -2,6 +2,7 @@
 
 #include "ofMain.h"
 #include "ofxVideoRecorder.h"
+#include "ofxVideoRecorderManager.h"
 
 class ofApp : public ofBaseApp{
 
@@ -24,6 +25,8 @@ public:
 
     ofVideoGrabber      vidGrabber;
     ofxVideoRecorder    vidRecorder;
+    ofxVideoRecorderCloseHandlePtr closeHandle;
+    ofxVideoRecorderCapacityBenchmark benchmark;
     ofSoundStream       soundStream;
     bool bRecording;
     int sampleRate;
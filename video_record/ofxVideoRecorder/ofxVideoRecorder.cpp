@@ -9,6 +9,12 @@
 #include "ofxVideoRecorder.h"
 #include <unistd.h>
 #include <fcntl.h>
+#include <signal.h>
+#include <fstream>
+#ifdef TARGET_OSX
+#include <libproc.h>
+#include <mach/mach_time.h>
+#endif
 
 //--------------------------------------------------------------
 //--------------------------------------------------------------
@@ -28,17 +34,128 @@ int setNonBlocking(int fd){
 #endif
 }
 
+//--------------------------------------------------------------
+// Minimal Matroska framing for the timestamped video pipe. Every element
+// uses an 8 byte size field, the segment is open ended and each frame goes
+// into its own cluster so the absolute timestamp never overflows the 16 bit
+// block offset.
+//--------------------------------------------------------------
+static void mkvId(string & out, unsigned int id){
+    // element ids carry their own length marker, write them without leading zero bytes
+    int bytes = id > 0xffffff ? 4 : id > 0xffff ? 3 : id > 0xff ? 2 : 1;
+    for(int shift = (bytes - 1) * 8; shift >= 0; shift -= 8){
+        out += (char)((id >> shift) & 0xff);
+    }
+}
+
+static void mkvSize(string & out, unsigned long long size){
+    out += (char)0x01;
+    for(int shift = 48; shift >= 0; shift -= 8){
+        out += (char)((size >> shift) & 0xff);
+    }
+}
+
+static void mkvBinary(string & out, unsigned int id, const string & data){
+    mkvId(out, id);
+    mkvSize(out, data.size());
+    out += data;
+}
+
+static void mkvUInt(string & out, unsigned int id, unsigned long long value){
+    string data;
+    for(int shift = 56; shift >= 0; shift -= 8){
+        data += (char)((value >> shift) & 0xff);
+    }
+    mkvBinary(out, id, data);
+}
+
+//--------------------------------------------------------------
+// fourcc ffmpeg uses to pick the raw pixel format of a V_UNCOMPRESSED track
+static string rawPixelFormatTag(const string & pixelFormat){
+    if(pixelFormat == "rgb24") return string("RGB\x18", 4);
+    if(pixelFormat == "bgr24") return string("BGR\x18", 4);
+    if(pixelFormat == "rgba") return "RGBA";
+    if(pixelFormat == "bgra") return "BGRA";
+    if(pixelFormat == "gray") return "Y800";
+    return "";
+}
+
+//--------------------------------------------------------------
+string mkvStreamHeader(int w, int h, const string & fourcc){
+    string ebml;
+    mkvUInt(ebml, 0x4286, 1);           // EBMLVersion
+    mkvUInt(ebml, 0x42F7, 1);           // EBMLReadVersion
+    mkvUInt(ebml, 0x42F2, 4);           // EBMLMaxIDLength
+    mkvUInt(ebml, 0x42F3, 8);           // EBMLMaxSizeLength
+    mkvBinary(ebml, 0x4282, "matroska");// DocType
+    mkvUInt(ebml, 0x4287, 4);           // DocTypeVersion
+    mkvUInt(ebml, 0x4285, 2);           // DocTypeReadVersion
+
+    string info;
+    mkvUInt(info, 0x2AD7B1, 1000000);   // TimecodeScale, timestamps are in ms
+    mkvBinary(info, 0x4D80, "ofxVideoRecorder");
+    mkvBinary(info, 0x5741, "ofxVideoRecorder");
+
+    string video;
+    mkvUInt(video, 0xB0, w);            // PixelWidth
+    mkvUInt(video, 0xBA, h);            // PixelHeight
+    mkvBinary(video, 0x2EB524, fourcc); // ColourSpace, tells ffmpeg the raw pixel format
+
+    string track;
+    mkvUInt(track, 0xD7, 1);            // TrackNumber
+    mkvUInt(track, 0x73C5, 1);          // TrackUID
+    mkvUInt(track, 0x83, 1);            // TrackType video
+    mkvUInt(track, 0x9C, 0);            // FlagLacing
+    mkvBinary(track, 0x86, "V_UNCOMPRESSED");
+    mkvBinary(track, 0xE0, video);
+
+    string tracks;
+    mkvBinary(tracks, 0xAE, track);
+
+    string header;
+    mkvBinary(header, 0x1A45DFA3, ebml);
+    mkvId(header, 0x18538067);          // Segment of unknown size
+    header += string("\x01\xff\xff\xff\xff\xff\xff\xff", 8);
+    mkvBinary(header, 0x1549A966, info);
+    mkvBinary(header, 0x1654AE6B, tracks);
+    return header;
+}
+
+//--------------------------------------------------------------
+string mkvBlockHeader(unsigned long long timestamp, int frameSize){
+    string timecode;
+    mkvUInt(timecode, 0xE7, timestamp); // Cluster Timecode
+
+    string block;
+    mkvId(block, 0xA3);                 // SimpleBlock
+    mkvSize(block, 4 + frameSize);
+    block += (char)0x81;                // track 1
+    block += (char)0x00;                // timestamp relative to the cluster
+    block += (char)0x00;
+    block += (char)0x80;                // keyframe
+
+    string header;
+    mkvId(header, 0x1F43B675);          // Cluster
+    mkvSize(header, timecode.size() + block.size() + frameSize);
+    header += timecode;
+    header += block;
+    return header;
+}
+
 //--------------------------------------------------------------
 //--------------------------------------------------------------
 execThread::execThread(){
     execCommand = "";
     initialized = false;
+    pid = -1;
 }
 
 //--------------------------------------------------------------
-void execThread::setup(string command){
+void execThread::setup(string command, string pidPath){
     execCommand = command;
+    this->pidPath = pidPath;
     initialized = false;
+    pid = -1;
     startThread(true);
 }
 
@@ -49,6 +166,10 @@ void execThread::threadedFunction(){
         int result = system(execCommand.c_str());
         if (result == 0) {
             ofLogVerbose("execThread") << "command completed successfully.";
+            if(!pidPath.empty()){
+                ifstream pidFile(pidPath.c_str());
+                pidFile >> pid;
+            }
             initialized = true;
         } else {
             ofLogError("execThread") << "command failed with result: " << result;
@@ -58,164 +179,269 @@ void execThread::threadedFunction(){
 
 //--------------------------------------------------------------
 //--------------------------------------------------------------
-ofxVideoDataWriterThread::ofxVideoDataWriterThread(){
+ofxVideoRecorderWriterPool::ofxVideoRecorderWriterPool(){
+    nextWriter = 0;
 }
 
 //--------------------------------------------------------------
-void ofxVideoDataWriterThread::setup(string filePath, lockFreeQueue<ofPixels *> * q){
-    this->filePath = filePath;
-    fd = -1;
-    queue = q;
-    bIsWriting = false;
-    bClose = false;
-    bNotifyError = false;
-    startThread(true);
+ofxVideoRecorderWriterPool::~ofxVideoRecorderWriterPool(){
+    stop();
 }
 
 //--------------------------------------------------------------
-void ofxVideoDataWriterThread::threadedFunction(){
-    if(fd == -1){
-        ofLogVerbose("ofxVideoDataWriterThread") << "opening pipe: " <<  filePath;
-        fd = ::open(filePath.c_str(), O_WRONLY);
-        ofLogWarning("ofxVideoDataWriterThread") << "got file descriptor " << fd;
+void ofxVideoRecorderWriterPool::setup(int numThreads){
+    stop();
+    for(int i = 0; i < numThreads; i++){
+        Worker * worker = new Worker();
+        worker->pool = this;
+        workers.push_back(worker);
+        worker->startThread(true);
     }
+}
 
-    while(isThreadRunning())
+//--------------------------------------------------------------
+void ofxVideoRecorderWriterPool::stop(){
+    for(size_t i = 0; i < workers.size(); i++){
+        workers[i]->stopThread();
+    }
     {
-        ofPixels * frame = NULL;
-        if(queue->Consume(frame) && frame){
-            bIsWriting = true;
-            int b_offset = 0;
-            int b_remaining = frame->getWidth()*frame->getHeight()*frame->getBytesPerPixel();
-
-            while(b_remaining > 0 && isThreadRunning())
-            {
-                errno = 0;
-
-                int b_written = ::write(fd, ((char *)frame->getData())+b_offset, b_remaining);
-
-                if(b_written > 0){
-                    b_remaining -= b_written;
-                    b_offset += b_written;
-                    if (b_remaining != 0) {
-                        ofLogWarning("ofxVideoDataWriterThread") << ofGetTimestampString("%H:%M:%S:%i") << " - b_remaining is not 0 -> " << b_written << " - " << b_remaining << " - " << b_offset << ".";
-                        // break;
-                    }
-                }
-                else if (b_written < 0) {
-                    ofLogError("ofxVideoDataWriterThread") << ofGetTimestampString("%H:%M:%S:%i") << " - write to PIPE failed with error -> " << errno << " - " << strerror(errno) << ".";
-                    bNotifyError = true;
-                    break;
-                }
-                else {
-                    if(bClose){
-                        ofLogVerbose("ofxVideoDataWriterThread") << ofGetTimestampString("%H:%M:%S:%i") << " - Nothing was written and bClose is TRUE.";
-                        break; // quit writing so we can close the file
-                    }
-                    ofLogWarning("ofxVideoDataWriterThread") << ofGetTimestampString("%H:%M:%S:%i") << " - Nothing was written. Is this normal?";
-                }
+        ofScopedLock lock(poolMutex);
+        condition.broadcast();
+    }
+    for(size_t i = 0; i < workers.size(); i++){
+        workers[i]->waitForThread(false);
+        delete workers[i];
+    }
+    workers.clear();
+}
 
-                if (!isThreadRunning()) {
-                    ofLogWarning("ofxVideoDataWriterThread") << ofGetTimestampString("%H:%M:%S:%i") << " - The thread is not running anymore let's get out of here!";
-                }
+//--------------------------------------------------------------
+void ofxVideoRecorderWriterPool::add(ofxPipeWriter * writer){
+    ofScopedLock lock(poolMutex);
+    writers.push_back(writer);
+    condition.broadcast();
+}
+
+//--------------------------------------------------------------
+void ofxVideoRecorderWriterPool::signal(ofxPipeWriter * writer){
+    ofScopedLock lock(poolMutex);
+    idle.erase(writer);
+    condition.signal();
+}
+
+//--------------------------------------------------------------
+int ofxVideoRecorderWriterPool::getNumWriters(){
+    ofScopedLock lock(poolMutex);
+    return writers.size();
+}
+
+//--------------------------------------------------------------
+void ofxVideoRecorderWriterPool::work(Worker & worker){
+    while(worker.isThreadRunning()){
+        ofxPipeWriter * writer = acquire(worker);
+        if(writer){
+            release(writer, writer->service());
+        }
+    }
+}
+
+//--------------------------------------------------------------
+ofxPipeWriter * ofxVideoRecorderWriterPool::acquire(Worker & worker){
+    ofScopedLock lock(poolMutex);
+    unsigned long long now = ofGetElapsedTimeMillis();
+    unsigned long long nextRetry = now + idleRetryMs;
+    for(size_t i = 0; i < writers.size(); i++){
+        size_t n = (nextWriter + i) % writers.size();
+        ofxPipeWriter * writer = writers[n];
+        if(busy.count(writer)){
+            continue;
+        }
+        map<ofxPipeWriter *, unsigned long long>::iterator it = idle.find(writer);
+        if(it != idle.end()){
+            if(it->second > now){
+                nextRetry = std::min(nextRetry, it->second);
+                continue;
             }
-            bIsWriting = false;
-            frame->clear();
-            delete frame;
+            idle.erase(it);
+        }
+        busy.insert(writer);
+        nextWriter = n + 1;
+        return writer;
+    }
+    // nothing to write. Wake up on the next signal, or when the first idle
+    // writer is due again: a full pipe may have drained, or the reader of a
+    // pipe that was not open yet shown up.
+    if(worker.isThreadRunning()){
+        condition.tryWait(poolMutex, std::max(1LL, (long long)(nextRetry - now)));
+    }
+    return NULL;
+}
+
+//--------------------------------------------------------------
+void ofxVideoRecorderWriterPool::release(ofxPipeWriter * writer, ofxPipeWriter::Result result){
+    {
+        ofScopedLock lock(poolMutex);
+        busy.erase(writer);
+        if(result == ofxPipeWriter::FINISHED){
+            idle.erase(writer);
+            writers.erase(std::remove(writers.begin(), writers.end(), writer), writers.end());
         }
-        else{
-            condition.wait(conditionMutex);
+        else if(result != ofxPipeWriter::WROTE){
+            idle[writer] = ofGetElapsedTimeMillis() + (result == ofxPipeWriter::PIPE_FULL ? pipeFullRetryMs : idleRetryMs);
         }
     }
+    // only once it is out of the pool may the writer report that it is done.
+    // Its owner can then delete it, or add it again for the next recording.
+    if(result == ofxPipeWriter::FINISHED){
+        writer->finished();
+    }
+}
 
-    ofLogVerbose("ofxVideoDataWriterThread") << "closing pipe: " <<  filePath;
-    ::close(fd);
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+ofxVideoDataWriterThread::ofxVideoDataWriterThread()
+: ofxPipeWriterThread<videoFrame *>("ofxVideoDataWriterThread"){
+    bTimestamped = false;
 }
 
 //--------------------------------------------------------------
-void ofxVideoDataWriterThread::signal(){
-    condition.signal();
+void ofxVideoDataWriterThread::setup(string filePath, lockFreeQueue<videoFrame *> * q, string streamHeader, ofxVideoRecorderWriterPool * pool){
+    bTimestamped = !streamHeader.empty();
+    start(filePath, q, streamHeader, pool);
+}
+
+//--------------------------------------------------------------
+void ofxVideoDataWriterThread::addBuffers(videoFrame * frame, vector<struct iovec> & buffers){
+    size_t size = frame->pixels.getWidth()*frame->pixels.getHeight()*frame->pixels.getBytesPerPixel();
+    struct iovec buffer;
+    if(bTimestamped){
+        frame->blockHeader = mkvBlockHeader(frame->timestamp, size);
+        buffer.iov_base = (void *)frame->blockHeader.data();
+        buffer.iov_len = frame->blockHeader.size();
+        buffers.push_back(buffer);
+    }
+    buffer.iov_base = frame->pixels.getData();
+    buffer.iov_len = size;
+    buffers.push_back(buffer);
 }
 
 //--------------------------------------------------------------
-void ofxVideoDataWriterThread::setPipeNonBlocking(){
-    setNonBlocking(fd);
+void ofxVideoDataWriterThread::freeItem(videoFrame * frame){
+    delete frame;
 }
 
 //--------------------------------------------------------------
 //--------------------------------------------------------------
-ofxAudioDataWriterThread::ofxAudioDataWriterThread(){
+ofxAudioDataWriterThread::ofxAudioDataWriterThread()
+: ofxPipeWriterThread<audioFrameShort *>("ofxAudioDataWriterThread"){
 }
 
 //--------------------------------------------------------------
-void ofxAudioDataWriterThread::setup(string filePath, lockFreeQueue<audioFrameShort *> *q){
-    this->filePath = filePath;
-    fd = -1;
-    queue = q;
-    bIsWriting = false;
-    bNotifyError = false;
-    startThread(true);
+void ofxAudioDataWriterThread::setup(string filePath, lockFreeQueue<audioFrameShort *> *q, ofxVideoRecorderWriterPool * pool){
+    start(filePath, q, "", pool);
 }
 
 //--------------------------------------------------------------
-void ofxAudioDataWriterThread::threadedFunction(){
-    if(fd == -1){
-        ofLogVerbose("ofxAudioDataWriterThread") << "opening pipe: " <<  filePath;
-        fd = ::open(filePath.c_str(), O_WRONLY);
-        ofLogWarning("ofxAudioDataWriterThread") << "got file descriptor " << fd;
-    }
+void ofxAudioDataWriterThread::addBuffers(audioFrameShort * frame, vector<struct iovec> & buffers){
+    struct iovec buffer;
+    buffer.iov_base = frame->data;
+    buffer.iov_len = frame->size*sizeof(short);
+    buffers.push_back(buffer);
+}
 
-    while(isThreadRunning())
-    {
-        audioFrameShort * frame = NULL;
-        if(queue->Consume(frame) && frame){
-            bIsWriting = true;
-            int b_offset = 0;
-            int b_remaining = frame->size*sizeof(short);
-            while(b_remaining > 0 && isThreadRunning()){
-                int b_written = ::write(fd, ((char *)frame->data)+b_offset, b_remaining);
-
-                if(b_written > 0){
-                    b_remaining -= b_written;
-                    b_offset += b_written;
-                }
-                else if (b_written < 0) {
-                    ofLogError("ofxAudioDataWriterThread") << ofGetTimestampString("%H:%M:%S:%i") << " - write to PIPE failed with error -> " << errno << " - " << strerror(errno) << ".";
-                    bNotifyError = true;
-                    break;
-                }
-                else {
-                    if(bClose){
-                        // quit writing so we can close the file
-                        break;
-                    }
-                }
+//--------------------------------------------------------------
+void ofxAudioDataWriterThread::freeItem(audioFrameShort * frame){
+    delete [] frame->data;
+    delete frame;
+}
 
-                if (!isThreadRunning()) {
-                    ofLogWarning("ofxAudioDataWriterThread") << ofGetTimestampString("%H:%M:%S:%i") << " - The thread is not running anymore let's get out of here!";
-                }
-            }
-            bIsWriting = false;
-            delete [] frame->data;
-            delete frame;
-        }
-        else{
-            condition.wait(conditionMutex);
-        }
-    }
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+ofxVideoRecorderPipeStats::ofxVideoRecorderPipeStats(){
+    queueSize = 0;
+    queueHighWater = 0;
+    itemsWritten = 0;
+    itemsDropped = 0;
+    bytesWritten = 0;
+    bytesPerSecond = 0;
+    writeBlockedMicros = 0;
+    writeCalls = 0;
+    pollCalls = 0;
+    writeLatencyP50 = 0;
+    writeLatencyP99 = 0;
+    writeLatencyMax = 0;
+}
 
-    ofLogVerbose("ofxAudioDataWriterThread") << "closing pipe: " <<  filePath;
-    ::close(fd);
+//--------------------------------------------------------------
+ofxVideoRecorderStats::ofxVideoRecorderStats(){
+    time = 0;
+    videoFramesRecorded = 0;
+    videoFramesDropped = 0;
+    videoFramesDuplicated = 0;
+    encoderCpuPercent = -1;
 }
 
 //--------------------------------------------------------------
-void ofxAudioDataWriterThread::signal(){
-    condition.signal();
+//--------------------------------------------------------------
+ofxVideoRecorderCloseHandle::ofxVideoRecorderCloseHandle(){
+    videoThread = NULL;
+    audioThread = NULL;
+    writtenAtClose = 0;
+    pending = 0;
+    bComplete = false;
+    bTimedOut = false;
 }
 
 //--------------------------------------------------------------
-void ofxAudioDataWriterThread::setPipeNonBlocking(){
-    setNonBlocking(fd);
+void ofxVideoRecorderCloseHandle::begin(ofxVideoDataWriterThread * video, ofxAudioDataWriterThread * audio, unsigned long long pending){
+    videoThread = video;
+    audioThread = audio;
+    this->pending = pending;
+    writtenAtClose = 0;
+    if(videoThread) writtenAtClose += videoThread->getNumWritten();
+    if(audioThread) writtenAtClose += audioThread->getNumWritten();
+}
+
+//--------------------------------------------------------------
+void ofxVideoRecorderCloseHandle::finish(bool timedOut){
+    ofScopedLock lock(mutex);
+    bTimedOut = timedOut;
+    bComplete = true;
+    condition.broadcast();
+}
+
+//--------------------------------------------------------------
+bool ofxVideoRecorderCloseHandle::isComplete(){
+    ofScopedLock lock(mutex);
+    return bComplete;
+}
+
+//--------------------------------------------------------------
+bool ofxVideoRecorderCloseHandle::hasTimedOut(){
+    ofScopedLock lock(mutex);
+    return bTimedOut;
+}
+
+//--------------------------------------------------------------
+float ofxVideoRecorderCloseHandle::getProgress(){
+    if(isComplete() || pending == 0) return isComplete() ? 1.f : 0.f;
+    unsigned long long written = 0;
+    if(videoThread) written += videoThread->getNumWritten();
+    if(audioThread) written += audioThread->getNumWritten();
+    return ofClamp((written - writtenAtClose) / (float)pending, 0.f, 1.f);
+}
+
+//--------------------------------------------------------------
+bool ofxVideoRecorderCloseHandle::waitForCompletion(long milliseconds){
+    ofScopedLock lock(mutex);
+    if(milliseconds < 0){
+        while(!bComplete) condition.wait(mutex);
+        return true;
+    }
+    if(!bComplete){
+        condition.tryWait(mutex, milliseconds);
+    }
+    return bComplete;
 }
 
 //--------------------------------------------------------------
@@ -229,6 +455,24 @@ ofxVideoRecorder::ofxVideoRecorder(){
     audioBitrate = "128k";
     pixelFormat = "rgb24";
     outputPixelFormat = "";
+    bUseTimestamps = true;
+    bTimestamped = false;
+    writerPool = NULL;
+    closeTimeoutMs = 0;
+    setupTime = 0;
+    lastCpuSeconds = 0;
+    lastCpuTime = 0;
+    lastEncoderCpu = -1;
+}
+
+//--------------------------------------------------------------
+ofxVideoRecorder::~ofxVideoRecorder(){
+    // a pending close still references the writer threads, and a writer pool
+    // must not keep serving writers that are about to go away.
+    if(bIsInitialized){
+        close();
+    }
+    waitForThread(false);
 }
 
 //--------------------------------------------------------------
@@ -265,6 +509,8 @@ bool ofxVideoRecorder::setupCustomOutput(int w, int h, float fps, int sampleRate
     {
         close();
     }
+    // the writer threads are reused, let a previous close finish with them first
+    waitForThread(false);
 
     bIsSilent = silent;
     bSysClockSync = sysClockSync;
@@ -274,6 +520,9 @@ bool ofxVideoRecorder::setupCustomOutput(int w, int h, float fps, int sampleRate
     bFinishing = false;
 
     videoFramesRecorded = 0;
+    videoFramesDropped = 0;
+    videoFramesDuplicated = 0;
+    lastVideoSlot = 0;
     audioSamplesRecorded = 0;
 
     if(!bRecordVideo && !bRecordAudio) {
@@ -322,7 +571,17 @@ bool ofxVideoRecorder::setupCustomOutput(int w, int h, float fps, int sampleRate
     else { // no audio stream
         cmd << " -an";
     }
-    if(bRecordVideo){ // video input options and file
+    string fourcc = rawPixelFormatTag(pixelFormat);
+    bTimestamped = bRecordVideo && bUseTimestamps && !fourcc.empty();
+    if(bRecordVideo && bUseTimestamps && !bTimestamped){
+        ofLogWarning("ofxVideoRecorder") << "no Matroska tag for pixel format " << pixelFormat << ", falling back to rawvideo.";
+    }
+    if(bTimestamped){ // timestamped video input, ffmpeg converts to a constant output rate
+        cmd << " -f matroska -i \"" << videoPipePath << "\" -vsync cfr -r " << fps;
+        if (outputPixelFormat.length() > 0)
+            cmd << " -pix_fmt " << outputPixelFormat;
+    }
+    else if(bRecordVideo){ // video input options and file
         cmd << " -r "<< fps << " -s " << w << "x" << h << " -f rawvideo -pix_fmt " << pixelFormat <<" -i \"" << videoPipePath << "\" -r " << fps;
         if (outputPixelFormat.length() > 0)
             cmd << " -pix_fmt " << outputPixelFormat;
@@ -330,10 +589,12 @@ bool ofxVideoRecorder::setupCustomOutput(int w, int h, float fps, int sampleRate
     else { // no video stream
         cmd << " -vn";
     }
-    cmd << " "+ outputString +"' &";
+    // ffmpeg runs in the background, keep its pid for the encoder statistics
+    pidPath = ofFilePath::getAbsolutePath("ofxvrpid" + ofToString(pipeNumber));
+    cmd << " "+ outputString +" & echo $! > \"" << pidPath << "\"'";
 
     // start ffmpeg thread. Ffmpeg will wait for input pipes to be opened.
-    ffmpegThread.setup(cmd.str());
+    ffmpegThread.setup(cmd.str(), pidPath);
 
     // wait until ffmpeg has started
     while (!ffmpegThread.isInitialized()) {
@@ -341,10 +602,10 @@ bool ofxVideoRecorder::setupCustomOutput(int w, int h, float fps, int sampleRate
     }
 
     if(bRecordAudio){
-        audioThread.setup(audioPipePath, &audioFrames);
+        audioThread.setup(audioPipePath, &audioFrames, writerPool);
     }
     if(bRecordVideo){
-        videoThread.setup(videoPipePath, &frames);
+        videoThread.setup(videoPipePath, &frames, bTimestamped ? mkvStreamHeader(w, h, fourcc) : "", writerPool);
     }
 
     bIsInitialized = true;
@@ -355,6 +616,18 @@ bool ofxVideoRecorder::setupCustomOutput(int w, int h, float fps, int sampleRate
     recordingDuration = 0;
     totalRecordingDuration = 0;
 
+    {
+        ofScopedLock lock(statsMutex);
+        setupTime = ofGetElapsedTimeMillis();
+        lastStats = ofxVideoRecorderStats();
+        statsHistory.clear();
+        lastCpuSeconds = 0;
+        lastCpuTime = 0;
+        lastEncoderCpu = -1;
+    }
+    frames.resetHighWaterMark();
+    audioFrames.resetHighWaterMark();
+
     return bIsInitialized;
 }
 
@@ -362,8 +635,14 @@ bool ofxVideoRecorder::setupCustomOutput(int w, int h, float fps, int sampleRate
 bool ofxVideoRecorder::addFrame(const ofPixels &pixels){
     if (!bIsRecording || bIsPaused) return false;
 
+    sampleStats();
+
     if(bIsInitialized && bRecordVideo && ffmpegThread.isInitialized())
     {
+        if(bTimestamped){
+            return addTimestampedFrame(pixels);
+        }
+
         int framesToAdd = 1; // default add one frame per request
 
         if((bRecordAudio || bSysClockSync) && !bFinishing){
@@ -389,18 +668,23 @@ bool ofxVideoRecorder::addFrame(const ofPixels &pixels){
                     framesToAdd++;
                     syncDelta -= 1.0/frameRate;
                 }
+                videoFramesDuplicated += framesToAdd - 1;
                 ofLogVerbose() << "ofxVideoRecorder: recDelta = " << syncDelta << ". Not enough video frames for desired frame rate, copied this frame " << framesToAdd << " times.\n";
             }
             else if(syncDelta < -1.0/frameRate){
                 // more than one video frame is waiting, skip this frame
                 framesToAdd = 0;
+                videoFramesDropped++;
                 ofLogVerbose() << "ofxVideoRecorder: recDelta = " << syncDelta << ". Too many video frames, skipping.\n";
             }
         }
 
         for(int i=0;i<framesToAdd;i++){
             // add desired number of frames
-            frames.Produce(new ofPixels(pixels));
+            videoFrame * frame = new videoFrame;
+            frame->pixels = pixels;
+            frame->timestamp = 0;
+            frames.Produce(frame);
             videoFramesRecorded++;
         }
 
@@ -412,6 +696,48 @@ bool ofxVideoRecorder::addFrame(const ofPixels &pixels){
     return false;
 }
 
+//--------------------------------------------------------------
+bool ofxVideoRecorder::addTimestampedFrame(const ofPixels &pixels){
+    double timestamp;
+    if (bRecordAudio) {
+        // align video against the audio that has been recorded so far
+        timestamp = (audioSamplesRecorded/audioChannels) / (double)sampleRate;
+    }
+    else if (bSysClockSync) {
+        timestamp = systemClock();
+    }
+    else {
+        timestamp = videoFramesRecorded / frameRate;
+    }
+
+    // snap to the output frame grid so ffmpeg's constant rate conversion maps
+    // every frame to exactly one slot.
+    long long slot = (long long)(timestamp * frameRate + 0.5);
+    if (videoFramesRecorded > 0) {
+        if (slot <= lastVideoSlot) {
+            // this output slot already has a frame, ffmpeg would drop this one anyway
+            videoFramesDropped++;
+            return true;
+        }
+        videoFramesDuplicated += slot - lastVideoSlot - 1;
+    }
+    else {
+        // the first frame starts the stream at 0, ffmpeg holds it until the next one
+        videoFramesDuplicated += slot;
+    }
+
+    videoFrame * frame = new videoFrame;
+    frame->pixels = pixels;
+    frame->timestamp = videoFramesRecorded > 0 ? (unsigned long long)(slot * 1000.0 / frameRate + 0.5) : 0;
+    frames.Produce(frame);
+    videoFramesRecorded++;
+    lastVideoSlot = slot;
+
+    videoThread.signal();
+
+    return true;
+}
+
 //--------------------------------------------------------------
 void ofxVideoRecorder::addAudioSamples(float *samples, int bufferSize, int numChannels){
     if (!bIsRecording || bIsPaused) return;
@@ -448,6 +774,20 @@ void ofxVideoRecorder::start(){
     ofLogVerbose() << "Recording." << endl;
 }
 
+//--------------------------------------------------------------
+void ofxVideoRecorder::update(){
+    vector<string> files;
+    {
+        ofScopedLock lock(completedFilesMutex);
+        files.swap(completedFiles);
+    }
+    for(size_t i = 0; i < files.size(); i++){
+        ofxVideoRecorderOutputFileCompleteEventArgs args;
+        args.fileName = files[i];
+        ofNotifyEvent(outputFileCompleteEvent, args);
+    }
+}
+
 //--------------------------------------------------------------
 void ofxVideoRecorder::setPaused(bool bPause){
     if(!bIsInitialized) return;
@@ -474,104 +814,307 @@ void ofxVideoRecorder::setPaused(bool bPause){
 }
 
 //--------------------------------------------------------------
-void ofxVideoRecorder::close(){
-    if(!bIsInitialized) return;
+ofxVideoRecorderCloseHandlePtr ofxVideoRecorder::close(unsigned long timeoutMs){
+    if(!bIsInitialized || isThreadRunning()) return closeHandle;
 
     bIsRecording = false;
+    bFinishing = true;
 
-    if(bRecordVideo && bRecordAudio) {
-        // set pipes to non_blocking so we dont get stuck at the final writes
-        // audioThread.setPipeNonBlocking();
-        // videoThread.setPipeNonBlocking();
+    unsigned long long pending = 0;
+    if(bRecordVideo) pending += frames.size();
+    if(bRecordAudio) pending += audioFrames.size();
 
-        if (frames.size() > 0 && audioFrames.size() > 0) {
-            // if there are frames in the queue start a thread to finalize the output file without blocking the app.
-            startThread();
-            return;
-        }
-    }
-    else if(bRecordVideo) {
-        // set pipes to non_blocking so we dont get stuck at the final writes
-        // videoThread.setPipeNonBlocking();
+    closeTimeoutMs = timeoutMs;
+    closeHandle = ofxVideoRecorderCloseHandlePtr(new ofxVideoRecorderCloseHandle());
+    closeHandle->begin(bRecordVideo ? &videoThread : NULL, bRecordAudio ? &audioThread : NULL, pending);
 
-        if (frames.size() > 0) {
-            // if there are frames in the queue start a thread to finalize the output file without blocking the app.
-            startThread();
-            return;
+    // the writer threads drain their queues and ffmpeg finalizes the file in the
+    // background, so closing never blocks the app.
+    startThread();
+    return closeHandle;
+}
+
+//--------------------------------------------------------------
+void ofxVideoRecorder::threadedFunction()
+{
+    // tell the writers to exit once their queues are empty, they close the
+    // pipes on the way out which lets ffmpeg finish the file.
+    if(bRecordVideo) videoThread.close();
+    if(bRecordAudio) audioThread.close();
+
+    bool bTimedOut = false;
+    unsigned long long deadline = ofGetElapsedTimeMillis() + closeTimeoutMs;
+    if(bRecordVideo) bTimedOut |= !videoThread.waitForFinish(closeTimeLeft(deadline));
+    if(bRecordAudio) bTimedOut |= !audioThread.waitForFinish(closeTimeLeft(deadline));
+
+    if(bTimedOut){
+        ofLogWarning("ofxVideoRecorder") << "close(): writers did not finish within " << closeTimeoutMs << "ms, dropping queued data.";
+        if(bRecordVideo) videoThread.abort();
+        if(bRecordAudio) audioThread.abort();
+        // the queues can only be emptied once their writer is gone
+        if(bRecordVideo && stopWriter(videoThread, videoPipePath)) {
+            videoFrame * frame = NULL;
+            while(frames.Consume(frame)) delete frame;
         }
-        else {
-            // cout << "ofxVideoRecorder :: we are good to go!" << endl;
+        if(bRecordAudio && stopWriter(audioThread, audioPipePath)) {
+            audioFrameShort * frame = NULL;
+            while(audioFrames.Consume(frame)) { delete [] frame->data; delete frame; }
         }
-
     }
-    else if(bRecordAudio) {
-        // set pipes to non_blocking so we dont get stuck at the final writes
-        // audioThread.setPipeNonBlocking();
 
-        if (audioFrames.size() > 0) {
-            // if there are frames in the queue start a thread to finalize the output file without blocking the app.
-            startThread();
-            return;
-        }
+    // with the pipes closed ffmpeg writes the trailer and exits. Once the
+    // deadline has passed it only gets a short grace period.
+    if(!waitForEncoder(bTimedOut ? abortGraceMs : closeTimeLeft(deadline))){
+        killEncoder();
+        bTimedOut = true;
     }
 
     outputFileComplete();
+    closeHandle->finish(bTimedOut);
 }
 
 //--------------------------------------------------------------
-void ofxVideoRecorder::threadedFunction()
+template <typename T>
+bool ofxVideoRecorder::stopWriter(ofxPipeWriterThread<T> & writer, const string & pipePath)
 {
-    if(bRecordVideo && bRecordAudio) {
-        while(frames.size() > 0 && audioFrames.size() > 0) {
-            // if there are frames in the queue or the thread is writing, signal them until the work is done.
-            videoThread.signal();
-            audioThread.signal();
-        }
+    if(writer.waitForFinish(abortGraceMs)){
+        return true;
     }
-    else if(bRecordVideo) {
-        while(frames.size() > 0) {
-            // if there are frames in the queue or the thread is writing, signal them until the work is done.
-            videoThread.signal();
-        }
+    // the only place an aborted writer can still hang is open(), waiting for
+    // an ffmpeg that never opened its input. Opening the read end lets it through.
+    int fd = ::open(pipePath.c_str(), O_RDONLY | O_NONBLOCK);
+    if(fd != -1){
+        ::close(fd);
     }
-    else if(bRecordAudio) {
-        while(audioFrames.size() > 0) {
-            // if there are frames in the queue or the thread is writing, signal them until the work is done.
-            audioThread.signal();
+    if(writer.waitForFinish(abortGraceMs)){
+        return true;
+    }
+    ofLogError("ofxVideoRecorder") << "close(): writer for " << pipePath << " did not stop, leaving its queue.";
+    return false;
+}
+
+//--------------------------------------------------------------
+bool ofxVideoRecorder::waitForEncoder(long milliseconds)
+{
+    int pid = ffmpegThread.getPid();
+    if(pid <= 0){
+        return true;
+    }
+    // ffmpeg runs in the background of the shell that started it, so it is
+    // not our child to wait on. Poll until the process is gone.
+    unsigned long long start = ofGetElapsedTimeMillis();
+    while(::kill(pid, 0) == 0){
+        if(milliseconds >= 0 && ofGetElapsedTimeMillis() - start >= (unsigned long long)milliseconds){
+            return false;
         }
+        ofSleepMillis(10);
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+void ofxVideoRecorder::killEncoder()
+{
+    int pid = ffmpegThread.getPid();
+    if(pid <= 0){
+        return;
     }
+    ofLogWarning("ofxVideoRecorder") << "close(): ffmpeg did not finish in time, stopping process " << pid << ".";
+    ::kill(pid, SIGTERM);
+    if(!waitForEncoder(abortGraceMs)){
+        ::kill(pid, SIGKILL);
+    }
+}
 
-    waitForThread();
+//--------------------------------------------------------------
+const long ofxVideoRecorder::abortGraceMs;
 
-    outputFileComplete();
+//--------------------------------------------------------------
+long ofxVideoRecorder::closeTimeLeft(unsigned long long deadline)
+{
+    if(closeTimeoutMs == 0){
+        return -1;
+    }
+    unsigned long long now = ofGetElapsedTimeMillis();
+    return now < deadline ? deadline - now : 1;
 }
 
 //--------------------------------------------------------------
 void ofxVideoRecorder::outputFileComplete()
 {
-    // at this point all data that ffmpeg wants should have been consumed
-    // one of the threads may still be trying to write a frame,
-    // but once close() gets called they will exit the non_blocking write loop
-    // and hopefully close successfully
+    // at this point the writer threads have exited and closed their pipes,
+    // ffmpeg sees EOF on its inputs and writes the trailer.
 
     bIsInitialized = false;
 
-    if (bRecordVideo) {
-        videoThread.close();
+    retirePipeNumber(pipeNumber);
+    ofFile::removeFile(pidPath, false);
+
+    // the thread only ran the shell that put ffmpeg in the background,
+    // ffmpeg itself was waited for (or killed) by threadedFunction().
+    ffmpegThread.waitForThread(false, abortGraceMs);
+
+    // this runs on the close thread, the listeners are notified by update()
+    ofScopedLock lock(completedFilesMutex);
+    completedFiles.push_back(fileName);
+}
+
+//--------------------------------------------------------------
+ofxVideoRecorderStats ofxVideoRecorder::getStats(){
+    sampleStats();
+
+    // counters are read live, rates and cpu come from the last sample
+    ofxVideoRecorderStats stats;
+    {
+        ofScopedLock lock(statsMutex);
+        stats = lastStats;
+        stats.time = (ofGetElapsedTimeMillis() - setupTime) / 1000.f;
     }
-    if (bRecordAudio) {
-        audioThread.close();
+    fillStats(stats);
+    return stats;
+}
+
+//--------------------------------------------------------------
+void ofxVideoRecorder::fillStats(ofxVideoRecorderStats & stats){
+    stats.video.queueSize = frames.size();
+    stats.video.queueHighWater = frames.getHighWaterMark();
+    stats.video.itemsWritten = videoThread.getNumWritten();
+    stats.video.itemsDropped = videoThread.getNumDropped();
+    stats.video.bytesWritten = videoThread.getBytesWritten();
+    stats.video.writeBlockedMicros = videoThread.getWriteBlockedMicros();
+    stats.video.writeCalls = videoThread.getNumWriteCalls();
+    stats.video.pollCalls = videoThread.getNumPollCalls();
+    stats.video.writeLatencyP50 = videoThread.getWriteLatencyPercentile(0.5f);
+    stats.video.writeLatencyP99 = videoThread.getWriteLatencyPercentile(0.99f);
+    stats.video.writeLatencyMax = videoThread.getWriteLatencyMax();
+
+    stats.audio.queueSize = audioFrames.size();
+    stats.audio.queueHighWater = audioFrames.getHighWaterMark();
+    stats.audio.itemsWritten = audioThread.getNumWritten();
+    stats.audio.itemsDropped = audioThread.getNumDropped();
+    stats.audio.bytesWritten = audioThread.getBytesWritten();
+    stats.audio.writeBlockedMicros = audioThread.getWriteBlockedMicros();
+    stats.audio.writeCalls = audioThread.getNumWriteCalls();
+    stats.audio.pollCalls = audioThread.getNumPollCalls();
+    stats.audio.writeLatencyP50 = audioThread.getWriteLatencyPercentile(0.5f);
+    stats.audio.writeLatencyP99 = audioThread.getWriteLatencyPercentile(0.99f);
+    stats.audio.writeLatencyMax = audioThread.getWriteLatencyMax();
+
+    stats.videoFramesRecorded = videoFramesRecorded;
+    stats.videoFramesDropped = videoFramesDropped;
+    stats.videoFramesDuplicated = videoFramesDuplicated;
+}
+
+//--------------------------------------------------------------
+void ofxVideoRecorder::sampleStats(){
+    if(!bIsInitialized) return;
+
+    ofScopedLock lock(statsMutex);
+    float time = (ofGetElapsedTimeMillis() - setupTime) / 1000.f;
+    float elapsed = time - lastStats.time;
+    if(elapsed < 1.f) return;
+
+    ofxVideoRecorderStats stats;
+    stats.time = time;
+    fillStats(stats);
+    stats.video.bytesPerSecond = (stats.video.bytesWritten - lastStats.video.bytesWritten) / elapsed;
+    stats.audio.bytesPerSecond = (stats.audio.bytesWritten - lastStats.audio.bytesWritten) / elapsed;
+    stats.encoderCpuPercent = getEncoderCpu();
+
+    statsHistory.push_back(stats);
+    lastStats = stats;
+}
+
+//--------------------------------------------------------------
+// user plus system cpu time a process has used so far. Only Linux and macOS:
+// elsewhere the pid from the shell is not one the system calls know.
+static bool processCpuSeconds(int pid, double & seconds){
+#if defined(TARGET_LINUX)
+    ifstream statFile(("/proc/" + ofToString(pid) + "/stat").c_str());
+    string line;
+    getline(statFile, line);
+    size_t commEnd = line.rfind(')');
+    if(commEnd == string::npos) return false;
+
+    // skip to utime and stime, fields 14 and 15. The command name in
+    // parentheses may contain spaces so count from after it (field 3).
+    istringstream fields(line.substr(commEnd + 2));
+    string field;
+    unsigned long long ticks = 0;
+    int i = 3;
+    for(; i <= 15 && fields >> field; i++){
+        if(i >= 14) ticks += strtoull(field.c_str(), NULL, 10);
+    }
+    if(i <= 15) return false;
+    seconds = ticks / (double)sysconf(_SC_CLK_TCK);
+    return true;
+#elif defined(TARGET_OSX)
+    struct proc_taskinfo info;
+    if(proc_pidinfo(pid, PROC_PIDTASKINFO, 0, &info, sizeof(info)) != (int)sizeof(info)) return false;
+    // mach time units, nanoseconds on intel but not on arm
+    static mach_timebase_info_data_t timebase;
+    if(timebase.denom == 0) mach_timebase_info(&timebase);
+    seconds = (info.pti_total_user + info.pti_total_system) * (double)timebase.numer / timebase.denom / 1e9;
+    return true;
+#else
+    return false;
+#endif
+}
+
+//--------------------------------------------------------------
+float ofxVideoRecorder::getEncoderCpu(){
+    int pid = ffmpegThread.getPid();
+    double cpuSeconds;
+    if(pid <= 0 || !processCpuSeconds(pid, cpuSeconds)) return -1;
+
+    float now = ofGetElapsedTimef();
+    if(lastCpuTime > 0 && now > lastCpuTime){
+        lastEncoderCpu = 100.f * (cpuSeconds - lastCpuSeconds) / (now - lastCpuTime);
     }
+    lastCpuSeconds = cpuSeconds;
+    lastCpuTime = now;
+    return lastEncoderCpu;
+}
 
-    retirePipeNumber(pipeNumber);
+//--------------------------------------------------------------
+bool ofxVideoRecorder::saveStatsCsv(string path){
+    vector<ofxVideoRecorderStats> history;
+    {
+        ofScopedLock lock(statsMutex);
+        history = statsHistory;
+    }
 
-    ffmpegThread.waitForThread();
-    // TODO: kill ffmpeg process if its taking too long to close for whatever reason.
+    ofFile file(path, ofFile::WriteOnly);
+    if(!file.is_open()){
+        ofLogError("ofxVideoRecorder") << "saveStatsCsv(): could not open " << path;
+        return false;
+    }
 
-    // Notify the listeners.
-    ofxVideoRecorderOutputFileCompleteEventArgs args;
-    args.fileName = fileName;
-    ofNotifyEvent(outputFileCompleteEvent, args);
+    file << "time,"
+    << "video_queue,video_queue_high_water,video_frames_written,video_frames_write_dropped,video_bytes_per_second,video_write_blocked_ms,"
+    << "video_write_calls,video_poll_calls,video_write_p50_us,video_write_p99_us,video_write_max_us,"
+    << "audio_queue,audio_queue_high_water,audio_buffers_written,audio_buffers_write_dropped,audio_bytes_per_second,audio_write_blocked_ms,"
+    << "audio_write_calls,audio_poll_calls,audio_write_p50_us,audio_write_p99_us,audio_write_max_us,"
+    << "frames_recorded,frames_dropped,frames_duplicated,encoder_cpu_percent" << endl;
+    for(size_t i = 0; i < history.size(); i++){
+        const ofxVideoRecorderStats & s = history[i];
+        file << s.time << ","
+        << s.video.queueSize << "," << s.video.queueHighWater << "," << s.video.itemsWritten << ","
+        << s.video.itemsDropped << ","
+        << s.video.bytesPerSecond << "," << s.video.writeBlockedMicros / 1000 << ","
+        << s.video.writeCalls << "," << s.video.pollCalls << "," << s.video.writeLatencyP50 << ","
+        << s.video.writeLatencyP99 << "," << s.video.writeLatencyMax << ","
+        << s.audio.queueSize << "," << s.audio.queueHighWater << "," << s.audio.itemsWritten << ","
+        << s.audio.itemsDropped << ","
+        << s.audio.bytesPerSecond << "," << s.audio.writeBlockedMicros / 1000 << ","
+        << s.audio.writeCalls << "," << s.audio.pollCalls << "," << s.audio.writeLatencyP50 << ","
+        << s.audio.writeLatencyP99 << "," << s.audio.writeLatencyMax << ","
+        << s.videoFramesRecorded << "," << s.videoFramesDropped << "," << s.videoFramesDuplicated << ",";
+        // left empty when the encoder's cpu time could not be read
+        if(s.encoderCpuPercent >= 0) file << s.encoderCpuPercent;
+        file << endl;
+    }
+    return true;
 }
 
 //--------------------------------------------------------------
@@ -592,9 +1135,12 @@ float ofxVideoRecorder::systemClock(){
 
 //--------------------------------------------------------------
 set<int> ofxVideoRecorder::openPipes;
+ofMutex ofxVideoRecorder::openPipesMutex;
 
 //--------------------------------------------------------------
 int ofxVideoRecorder::requestPipeNumber(){
+    // sessions are set up and finalized from different threads
+    ofScopedLock lock(openPipesMutex);
     int n = 0;
     while (openPipes.find(n) != openPipes.end()) {
         n++;
@@ -605,6 +1151,7 @@ int ofxVideoRecorder::requestPipeNumber(){
 
 //--------------------------------------------------------------
 void ofxVideoRecorder::retirePipeNumber(int num){
+    ofScopedLock lock(openPipesMutex);
     if(!openPipes.erase(num)){
         ofLogNotice() << "ofxVideoRecorder::retirePipeNumber(): trying to retire a pipe number that is not being tracked: " << num << endl;
     }
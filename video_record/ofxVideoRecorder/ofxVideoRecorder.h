@@ -3,17 +3,28 @@
 #include "ofMain.h"
 #include "Poco/Condition.h"
 #include <set>
+#include <map>
+#include <atomic>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/uio.h>
 
 //--------------------------------------------------------------
 //--------------------------------------------------------------
 template <typename T>
 struct lockFreeQueue {
-    lockFreeQueue(){
+    lockFreeQueue() : count(0), highWater(0){
         list.push_back(T());
         iHead = list.begin();
         iTail = list.end();
     }
     void Produce(const T& t){
+        // counted before the item becomes visible, so Consume() can never
+        // take the count below zero
+        int n = count.fetch_add(1) + 1;
+        int high = highWater.load();
+        while (n > high && !highWater.compare_exchange_weak(high, n)) {}
         list.push_back(t);
         iTail = list.end();
         list.erase(list.begin(), iHead);
@@ -25,11 +36,15 @@ struct lockFreeQueue {
         {
             iHead = iNext;
             t = *iHead;
+            count.fetch_sub(1);
             return true;
         }
         return false;
     }
-    int size() { return distance(iHead,iTail)-1; }
+    // both counters are safe to read from any thread
+    int size() { return count; }
+    int getHighWaterMark() { return highWater; }
+    void resetHighWaterMark() { highWater = (int)count; }
     typename std::list<T>::iterator getHead() { return iHead; }
     typename std::list<T>::iterator getTail() { return iTail; }
 
@@ -38,17 +53,23 @@ private:
     typedef std::list<T> TList;
     TList list;
     typename TList::iterator iHead, iTail;
+    std::atomic<int> count;
+    std::atomic<int> highWater;
 };
 
 class execThread : public ofThread{
 public:
     execThread();
-    void setup(string command);
+    // pidPath: file the command writes the process id of ffmpeg to
+    void setup(string command, string pidPath = "");
     void threadedFunction();
     bool isInitialized() { return initialized; }
+    int getPid() { return pid; }
 private:
     string execCommand;
+    string pidPath;
     bool initialized;
+    int pid;
 };
 
 struct audioFrameShort {
@@ -56,54 +77,609 @@ struct audioFrameShort {
     int size;
 };
 
+struct videoFrame {
+    ofPixels pixels;
+    unsigned long long timestamp; // ms, only sent with the timestamped transport
+    string blockHeader;           // filled in by the writer right before sending
+};
+
+string mkvStreamHeader(int w, int h, const string & fourcc);
+string mkvBlockHeader(unsigned long long timestamp, int frameSize);
+
+int setNonBlocking(int fd);
+
 //--------------------------------------------------------------
 //--------------------------------------------------------------
-class ofxVideoDataWriterThread : public ofThread {
+// What a shared writer pool needs from a pipe writer.
+class ofxPipeWriter {
 public:
-    ofxVideoDataWriterThread();
-//    void setup(ofFile *file, lockFreeQueue<ofPixels *> * q);
-    void setup(string filePath, lockFreeQueue<ofPixels *> * q);
-    void threadedFunction();
-    void signal();
-    void setPipeNonBlocking();
-    bool isWriting() { return bIsWriting; }
-    void close() { bClose = true; stopThread(); signal(); }
-    bool bNotifyError;
+    enum Result {
+        WROTE,          // some data went out
+        NOTHING_TO_DO,  // nothing queued, or no reader on the pipe yet
+        PIPE_FULL,      // the reader has not caught up yet
+        FINISHED        // the pipe has been closed, the pool drops the writer
+    };
+    virtual ~ofxPipeWriter(){}
+    // open the pipe if needed and hand it what it takes without blocking,
+    // at most one batch of queued items.
+    virtual Result service() = 0;
+    // called once the pool has dropped a FINISHED writer, the pool does not
+    // touch it afterwards so its owner may set it up again or delete it.
+    virtual void finished() = 0;
+};
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+// A fixed set of threads writing for any number of pipes. Writers that have
+// data are served round robin one non blocking write at a time, so neither a
+// busy recording nor a stalled ffmpeg can hold a thread. Writers without
+// work are retried after a while, or as soon as they signal.
+class ofxVideoRecorderWriterPool {
+public:
+    ofxVideoRecorderWriterPool();
+    ~ofxVideoRecorderWriterPool();
+
+    void setup(int numThreads);
+    void stop();
+
+    void add(ofxPipeWriter * writer);
+    void signal(ofxPipeWriter * writer);   // writer has new data or was closed
+
+    int getNumThreads() { return workers.size(); }
+    int getNumWriters();
+
 private:
-    ofMutex conditionMutex;
+    class Worker : public ofThread {
+    public:
+        ofxVideoRecorderWriterPool * pool;
+        void threadedFunction() { pool->work(*this); }
+    };
+
+    void work(Worker & worker);
+    ofxPipeWriter * acquire(Worker & worker);
+    void release(ofxPipeWriter * writer, ofxPipeWriter::Result result);
+
+    // ms until a writer is tried again without a signal
+    static const int idleRetryMs = 10;
+    static const int pipeFullRetryMs = 1;
+
+    vector<Worker *> workers;
+    vector<ofxPipeWriter *> writers;
+    set<ofxPipeWriter *> busy;
+    map<ofxPipeWriter *, unsigned long long> idle;  // writer, time to retry it
+    size_t nextWriter;
+    ofMutex poolMutex;
     Poco::Condition condition;
-//    ofFile * writer;
-    string filePath;
-    int fd;
-    lockFreeQueue<ofPixels *> * queue;
-    bool bIsWriting;
-    bool bClose;
 };
 
 //--------------------------------------------------------------
 //--------------------------------------------------------------
-class ofxAudioDataWriterThread : public ofThread {
+// Writes the items of a queue to a named pipe, either from its own thread or
+// from the threads of an ofxVideoRecorderWriterPool. What is queued goes out
+// in batches of up to maxBatchItems / maxBatchBytes with writev(), the pipe
+// is non blocking. The own thread waits on a full pipe with poll(), under a
+// pool the batch is kept where the pipe cut it short and continued on the
+// next service().
+template <typename T>
+class ofxPipeWriterThread : public ofThread, public ofxPipeWriter {
 public:
-    ofxAudioDataWriterThread();
-//    void setup(ofFile *file, lockFreeQueue<audioFrameShort *> * q);
-    void setup(string filePath, lockFreeQueue<audioFrameShort *> * q);
+    ofxPipeWriterThread(string logName);
     void threadedFunction();
+    Result service();
+    void finished();
     void signal();
     void setPipeNonBlocking();
     bool isWriting() { return bIsWriting; }
-    void close() { bClose = true; stopThread(); signal();  }
+    unsigned long long getNumWritten() { return numWritten; }
+    // items given up on after a failed write, or when aborted mid batch
+    unsigned long long getNumDropped() { return numDropped; }
+    unsigned long long getBytesWritten() { return bytesWritten; }
+    unsigned long long getWriteBlockedMicros() { return writeBlockedMicros; }
+    unsigned long long getNumWriteCalls() { return writeCalls; }
+    unsigned long long getNumPollCalls() { return pollCalls; }
+    // upper bound in microseconds of the given share (0..1) of writev() calls
+    unsigned long long getWriteLatencyPercentile(float percentile);
+    unsigned long long getWriteLatencyMax() { return writeLatencyMax; }
+    void close();   // write out what is queued, then close the pipe
+    void abort();   // stop writing immediately, dropping what is queued
+    bool waitForFinish(long milliseconds = -1);
     bool bNotifyError;
+
+    static const int maxBatchItems = 32;
+    static const size_t maxBatchBytes = 4 * 1024 * 1024;
+    static const int numLatencyBuckets = 24;   // powers of two from 1us to 8s
+protected:
+    void start(string filePath, lockFreeQueue<T> * q, string streamHeader, ofxVideoRecorderWriterPool * pool);
+    // queue the buffers of one item for the next writev(), they have to stay
+    // valid until freeItem() is called.
+    virtual void addBuffers(T item, vector<struct iovec> & buffers) = 0;
+    virtual void freeItem(T item) = 0;
+    bool writeBuffers(struct iovec * buffers, int count);
+    bool writeBuffer(const char * data, int size);
+    string logName;
+    bool bIsWriting;
+    std::atomic<unsigned long long> numWritten;
+    std::atomic<unsigned long long> numDropped;
 private:
+    bool openPipe(bool bNonBlocking);
+    void closePipe();
+    bool waitForItem(T & item);
+    void collectBatch(T first);
+    void finishBatch(bool bWritten);
+    void writeBatch(T first);
+    ssize_t writeOnce(struct iovec *& buffers, int & count);
+    bool waitWritable();
+    void addLatency(unsigned long long micros);
+    bool keepWriting() { return pool ? !bAbort : isThreadRunning(); }
     ofMutex conditionMutex;
     Poco::Condition condition;
 //    ofFile * writer;
     string filePath;
+    string streamHeader;
     int fd;
-    lockFreeQueue<audioFrameShort *> * queue;
-    bool bIsWriting;
+    lockFreeQueue<T> * queue;
+    ofxVideoRecorderWriterPool * pool;
+    vector<T> batch;
+    vector<struct iovec> buffers;
+    size_t nextBuffer;      // first of buffers not completely written
+    std::atomic<unsigned long long> bytesWritten;
+    std::atomic<unsigned long long> writeBlockedMicros;
+    std::atomic<unsigned long long> writeCalls;
+    std::atomic<unsigned long long> pollCalls;
+    std::atomic<unsigned long long> writeLatency[numLatencyBuckets];
+    std::atomic<unsigned long long> writeLatencyMax;
     bool bClose;
+    bool bAbort;
+    bool bDone;
+};
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+class ofxVideoDataWriterThread : public ofxPipeWriterThread<videoFrame *> {
+public:
+    ofxVideoDataWriterThread();
+//    void setup(ofFile *file, lockFreeQueue<ofPixels *> * q);
+    // with a streamHeader every frame is sent as a timestamped Matroska block,
+    // otherwise frames go out as plain rawvideo.
+    void setup(string filePath, lockFreeQueue<videoFrame *> * q, string streamHeader = "", ofxVideoRecorderWriterPool * pool = NULL);
+protected:
+    void addBuffers(videoFrame * frame, vector<struct iovec> & buffers);
+    void freeItem(videoFrame * frame);
+    bool bTimestamped;
+};
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+class ofxAudioDataWriterThread : public ofxPipeWriterThread<audioFrameShort *> {
+public:
+    ofxAudioDataWriterThread();
+//    void setup(ofFile *file, lockFreeQueue<audioFrameShort *> * q);
+    void setup(string filePath, lockFreeQueue<audioFrameShort *> * q, ofxVideoRecorderWriterPool * pool = NULL);
+protected:
+    void addBuffers(audioFrameShort * frame, vector<struct iovec> & buffers);
+    void freeItem(audioFrameShort * frame);
 };
 
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+template <typename T>
+ofxPipeWriterThread<T>::ofxPipeWriterThread(string logName)
+: logName(logName), fd(-1), queue(NULL), pool(NULL), nextBuffer(0){
+    bNotifyError = false;
+    bIsWriting = false;
+    numWritten = 0;
+    numDropped = 0;
+    bytesWritten = 0;
+    writeBlockedMicros = 0;
+    writeCalls = 0;
+    pollCalls = 0;
+    for(int i = 0; i < numLatencyBuckets; i++) writeLatency[i] = 0;
+    writeLatencyMax = 0;
+    bClose = false;
+    bAbort = false;
+    bDone = true;
+}
+
+//--------------------------------------------------------------
+template <typename T>
+void ofxPipeWriterThread<T>::start(string filePath, lockFreeQueue<T> * q, string streamHeader, ofxVideoRecorderWriterPool * pool){
+    this->filePath = filePath;
+    this->streamHeader = streamHeader;
+    this->pool = pool;
+    fd = -1;
+    queue = q;
+    numWritten = 0;
+    numDropped = 0;
+    bytesWritten = 0;
+    writeBlockedMicros = 0;
+    writeCalls = 0;
+    pollCalls = 0;
+    for(int i = 0; i < numLatencyBuckets; i++) writeLatency[i] = 0;
+    writeLatencyMax = 0;
+    bIsWriting = false;
+    bClose = false;
+    bAbort = false;
+    bDone = false;
+    bNotifyError = false;
+    if(pool){
+        pool->add(this);
+    }
+    else{
+        startThread(true);
+    }
+}
+
+//--------------------------------------------------------------
+template <typename T>
+bool ofxPipeWriterThread<T>::openPipe(bool bNonBlocking){
+    ofLogVerbose(logName) << "opening pipe: " <<  filePath;
+    if(bNonBlocking){
+        // a pool thread must not sit in open() until ffmpeg gets to this
+        // input, ENXIO means there is no reader yet and we try again later.
+        fd = ::open(filePath.c_str(), O_WRONLY | O_NONBLOCK);
+        if(fd == -1){
+            return false;
+        }
+    }
+    else{
+        fd = ::open(filePath.c_str(), O_WRONLY);
+        setNonBlocking(fd);
+    }
+    ofLogWarning(logName) << "got file descriptor " << fd;
+#ifdef F_SETPIPE_SZ
+    // the default 64k pipe takes around a hundred writes per 1080p frame
+    fcntl(fd, F_SETPIPE_SZ, 1024 * 1024);
+#endif
+
+    if(!streamHeader.empty()){
+        writeBuffer(streamHeader.data(), streamHeader.size());
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+template <typename T>
+void ofxPipeWriterThread<T>::closePipe(){
+    ofLogVerbose(logName) << "closing pipe: " <<  filePath;
+    if(fd != -1){
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+//--------------------------------------------------------------
+template <typename T>
+bool ofxPipeWriterThread<T>::waitForItem(T & item){
+    // the queue is checked under the condition mutex and signal() takes the
+    // same mutex, so an item produced between the check and the wait still
+    // wakes us up.
+    ofScopedLock lock(conditionMutex);
+    while(!queue->Consume(item) || !item){
+        if(bClose || !isThreadRunning()){
+            return false;
+        }
+        condition.wait(conditionMutex);
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+template <typename T>
+void ofxPipeWriterThread<T>::threadedFunction(){
+    if(fd == -1){
+        openPipe(false);
+    }
+
+    T item = NULL;
+    while(waitForItem(item))
+    {
+        writeBatch(item);
+        item = NULL;
+    }
+
+    closePipe();
+    finished();
+}
+
+//--------------------------------------------------------------
+template <typename T>
+void ofxPipeWriterThread<T>::collectBatch(T first){
+    // take whatever else is already queued along with the first item
+    batch.clear();
+    buffers.clear();
+    nextBuffer = 0;
+    size_t batchBytes = 0;
+    T item = first;
+    while(true){
+        batch.push_back(item);
+        size_t n = buffers.size();
+        addBuffers(item, buffers);
+        for(; n < buffers.size(); n++){
+            batchBytes += buffers[n].iov_len;
+        }
+        item = NULL;
+        if((int)batch.size() >= maxBatchItems || batchBytes >= maxBatchBytes || !queue->Consume(item) || !item){
+            break;
+        }
+    }
+}
+
+//--------------------------------------------------------------
+template <typename T>
+void ofxPipeWriterThread<T>::finishBatch(bool bWritten){
+    for(size_t i = 0; i < batch.size(); i++){
+        freeItem(batch[i]);
+    }
+    if(bWritten){
+        numWritten += batch.size();
+    }
+    else{
+        numDropped += batch.size();
+    }
+    batch.clear();
+    buffers.clear();
+    nextBuffer = 0;
+}
+
+//--------------------------------------------------------------
+template <typename T>
+void ofxPipeWriterThread<T>::writeBatch(T first){
+    collectBatch(first);
+
+    bIsWriting = true;
+    bool bWritten = writeBuffers(&buffers[0], buffers.size());
+    bIsWriting = false;
+
+    finishBatch(bWritten);
+}
+
+//--------------------------------------------------------------
+template <typename T>
+ofxPipeWriter::Result ofxPipeWriterThread<T>::service(){
+    if(bAbort){
+        finishBatch(false);
+        closePipe();
+        return FINISHED;
+    }
+    if(fd == -1 && !openPipe(true)){
+        return NOTHING_TO_DO;
+    }
+
+    if(nextBuffer == buffers.size()){
+        T item = NULL;
+        if(!queue->Consume(item) || !item){
+            bool bFinish;
+            {
+                ofScopedLock lock(conditionMutex);
+                bFinish = bClose;
+            }
+            if(bFinish){
+                closePipe();
+                return FINISHED;
+            }
+            return NOTHING_TO_DO;
+        }
+        collectBatch(item);
+    }
+
+    // a single writev(), a full pipe leaves the rest for the next call
+    struct iovec * pending = &buffers[nextBuffer];
+    int count = buffers.size() - nextBuffer;
+    bIsWriting = true;
+    ssize_t written = writeOnce(pending, count);
+    bIsWriting = false;
+    nextBuffer = buffers.size() - count;
+
+    if(written < 0 || count == 0){
+        // on errors the batch is dropped, like the threaded writer does
+        finishBatch(written >= 0);
+    }
+    return written > 0 ? WROTE : written == 0 ? PIPE_FULL : NOTHING_TO_DO;
+}
+
+//--------------------------------------------------------------
+template <typename T>
+void ofxPipeWriterThread<T>::finished(){
+    // waitForFinish() returns from here on, this must be the last use of the writer
+    ofScopedLock lock(conditionMutex);
+    bDone = true;
+    condition.broadcast();
+}
+
+//--------------------------------------------------------------
+template <typename T>
+bool ofxPipeWriterThread<T>::waitForFinish(long milliseconds){
+    if(!pool){
+        waitForThread(false, milliseconds < 0 ? INFINITE_JOIN_TIMEOUT : milliseconds);
+        return !isThreadRunning();
+    }
+    ofScopedLock lock(conditionMutex);
+    if(milliseconds < 0){
+        while(!bDone) condition.wait(conditionMutex);
+    }
+    else if(!bDone){
+        condition.tryWait(conditionMutex, milliseconds);
+    }
+    return bDone;
+}
+
+//--------------------------------------------------------------
+template <typename T>
+bool ofxPipeWriterThread<T>::writeBuffer(const char * data, int size){
+    struct iovec buffer;
+    buffer.iov_base = (void *)data;
+    buffer.iov_len = size;
+    return writeBuffers(&buffer, 1);
+}
+
+//--------------------------------------------------------------
+template <typename T>
+bool ofxPipeWriterThread<T>::writeBuffers(struct iovec * buffers, int count){
+    while(count > 0 && keepWriting())
+    {
+        ssize_t b_written = writeOnce(buffers, count);
+        if(b_written < 0){
+            return false;
+        }
+        if(b_written == 0 && count > 0){
+            // the pipe is full, wait until ffmpeg has read some of it
+            if(!waitWritable()){
+                return false;
+            }
+        }
+
+        if (!keepWriting()) {
+            ofLogWarning(logName) << ofGetTimestampString("%H:%M:%S:%i") << " - The thread is not running anymore let's get out of here!";
+        }
+    }
+    return count == 0;
+}
+
+//--------------------------------------------------------------
+// One writev() of what is left, moves buffers and count past what went out.
+// Returns the bytes written, 0 when the pipe is full and -1 on errors.
+template <typename T>
+ssize_t ofxPipeWriterThread<T>::writeOnce(struct iovec *& buffers, int & count){
+    while(true)
+    {
+        errno = 0;
+
+        unsigned long long writeStart = ofGetElapsedTimeMicros();
+        ssize_t b_written = ::writev(fd, buffers, count);
+        unsigned long long writeTime = ofGetElapsedTimeMicros() - writeStart;
+        writeCalls++;
+        writeBlockedMicros += writeTime;
+        addLatency(writeTime);
+
+        if(b_written > 0){
+            bytesWritten += b_written;
+            // skip the buffers that went out completely, and move into the
+            // one the pipe cut short.
+            ssize_t left = b_written;
+            while(count > 0 && (size_t)left >= buffers->iov_len){
+                left -= buffers->iov_len;
+                buffers++;
+                count--;
+            }
+            if(count > 0){
+                buffers->iov_base = (char *)buffers->iov_base + left;
+                buffers->iov_len -= left;
+            }
+            return b_written;
+        }
+        else if (b_written < 0 && errno == EINTR) {
+            continue;
+        }
+        else if (b_written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        }
+        else if (b_written < 0) {
+            ofLogError(logName) << ofGetTimestampString("%H:%M:%S:%i") << " - write to PIPE failed with error -> " << errno << " - " << strerror(errno) << ".";
+            bNotifyError = true;
+            return -1;
+        }
+        return 0;
+    }
+}
+
+//--------------------------------------------------------------
+template <typename T>
+bool ofxPipeWriterThread<T>::waitWritable(){
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+
+    // wake up now and then to notice abort()
+    unsigned long long pollStart = ofGetElapsedTimeMicros();
+    int result = ::poll(&pfd, 1, 100);
+    writeBlockedMicros += ofGetElapsedTimeMicros() - pollStart;
+    pollCalls++;
+
+    if(result < 0 && errno != EINTR){
+        ofLogError(logName) << ofGetTimestampString("%H:%M:%S:%i") << " - poll on PIPE failed with error -> " << errno << " - " << strerror(errno) << ".";
+        bNotifyError = true;
+        return false;
+    }
+    if(result > 0 && (pfd.revents & (POLLERR | POLLHUP))){
+        ofLogError(logName) << ofGetTimestampString("%H:%M:%S:%i") << " - PIPE was closed by the reader.";
+        bNotifyError = true;
+        return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+template <typename T>
+void ofxPipeWriterThread<T>::addLatency(unsigned long long micros){
+    int bucket = 0;
+    while(bucket < numLatencyBuckets - 1 && (1ULL << (bucket + 1)) <= micros){
+        bucket++;
+    }
+    writeLatency[bucket]++;
+    if(micros > writeLatencyMax){
+        writeLatencyMax = micros;
+    }
+}
+
+//--------------------------------------------------------------
+template <typename T>
+unsigned long long ofxPipeWriterThread<T>::getWriteLatencyPercentile(float percentile){
+    unsigned long long total = writeCalls;
+    if(total == 0) return 0;
+    unsigned long long target = (unsigned long long)(percentile * total);
+    unsigned long long count = 0;
+    for(int i = 0; i < numLatencyBuckets; i++){
+        count += writeLatency[i];
+        if(count > target){
+            return 1ULL << (i + 1);
+        }
+    }
+    return writeLatencyMax;
+}
+
+//--------------------------------------------------------------
+template <typename T>
+void ofxPipeWriterThread<T>::signal(){
+    if(pool){
+        pool->signal(this);
+        return;
+    }
+    ofScopedLock lock(conditionMutex);
+    condition.signal();
+}
+
+//--------------------------------------------------------------
+template <typename T>
+void ofxPipeWriterThread<T>::close(){
+    {
+        ofScopedLock lock(conditionMutex);
+        bClose = true;
+        condition.broadcast();
+    }
+    if(pool){
+        pool->signal(this);
+    }
+}
+
+//--------------------------------------------------------------
+template <typename T>
+void ofxPipeWriterThread<T>::abort(){
+    // a writer waiting on a full pipe notices this on its next poll timeout
+    bAbort = true;
+    if(!pool){
+        stopThread();
+    }
+    close();
+}
+
+//--------------------------------------------------------------
+template <typename T>
+void ofxPipeWriterThread<T>::setPipeNonBlocking(){
+    if(fd != -1){
+        setNonBlocking(fd);
+    }
+}
 
 //--------------------------------------------------------------
 //--------------------------------------------------------------
@@ -114,15 +690,86 @@ public:
     string fileName;
 };
 
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+struct ofxVideoRecorderPipeStats {
+    ofxVideoRecorderPipeStats();
+
+    int queueSize;
+    int queueHighWater;                     // since setup()
+    unsigned long long itemsWritten;        // frames or sample buffers
+    unsigned long long itemsDropped;        // lost to failed writes or an abort
+    unsigned long long bytesWritten;
+    float bytesPerSecond;                   // over the last sampling interval
+    unsigned long long writeBlockedMicros;  // total time spent in writev() and poll()
+    unsigned long long writeCalls;          // writev() syscalls
+    unsigned long long pollCalls;           // poll() syscalls waiting on a full pipe
+    unsigned long long writeLatencyP50;     // microseconds per writev(), bucket upper bounds
+    unsigned long long writeLatencyP99;
+    unsigned long long writeLatencyMax;
+};
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+// Snapshot returned by ofxVideoRecorder::getStats(). Only reads counters, so
+// it is fine to take one every frame.
+struct ofxVideoRecorderStats {
+    ofxVideoRecorderStats();
+
+    float time;                             // seconds since setup()
+    ofxVideoRecorderPipeStats video;
+    ofxVideoRecorderPipeStats audio;
+    unsigned long long videoFramesRecorded;
+    unsigned long long videoFramesDropped;
+    unsigned long long videoFramesDuplicated;
+    float encoderCpuPercent;                // of one core, -1 when not available
+};
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+// Returned by ofxVideoRecorder::close(). The recording is finalized on a
+// background thread; poll this from the app loop or block on it at exit.
+// The handle reads the recorder's writer threads, so it must not outlive
+// the recorder that returned it.
+class ofxVideoRecorderCloseHandle
+{
+public:
+    ofxVideoRecorderCloseHandle();
+
+    bool isComplete();
+    bool hasTimedOut();     // the deadline passed, queued data was dropped or ffmpeg was killed
+    float getProgress();    // 0..1, share of the data queued at close() that has been written
+    bool waitForCompletion(long milliseconds = -1);
+
+private:
+    friend class ofxVideoRecorder;
+    void begin(ofxVideoDataWriterThread * video, ofxAudioDataWriterThread * audio, unsigned long long pending);
+    void finish(bool timedOut);
+
+    ofMutex mutex;
+    Poco::Condition condition;
+    ofxVideoDataWriterThread * videoThread;
+    ofxAudioDataWriterThread * audioThread;
+    unsigned long long writtenAtClose;
+    unsigned long long pending;
+    bool bComplete;
+    bool bTimedOut;
+};
+
+typedef shared_ptr<ofxVideoRecorderCloseHandle> ofxVideoRecorderCloseHandlePtr;
+
 //--------------------------------------------------------------
 //--------------------------------------------------------------
 class ofxVideoRecorder  : public ofThread
 {
 public:
     ofxVideoRecorder();
+    ~ofxVideoRecorder();
 
     void threadedFunction();
 
+    // Sent from update(), so on the app thread, once a closed recording's
+    // file is complete. The file is finalized on a background thread.
     ofEvent<ofxVideoRecorderOutputFileCompleteEventArgs> outputFileCompleteEvent;
 
     bool setup(string fname, int w, int h, float fps, int sampleRate=0, int channels=0, bool sysClockSync=false, bool silent=false);
@@ -133,7 +780,13 @@ public:
     void addAudioSamples(float * samples, int bufferSize, int numChannels);
 
     void start();
-    void close();
+    // call once per app frame, notifies outputFileCompleteEvent.
+    void update();
+    // Stops recording and returns immediately. Queued data is written out on a
+    // background thread; anything still queued after timeoutMs is dropped so
+    // ffmpeg can finish the file, and an ffmpeg that does not exit shortly
+    // after that is killed (0 waits as long as it takes).
+    ofxVideoRecorderCloseHandlePtr close(unsigned long timeoutMs = 30000);
     void setPaused(bool bPause);
 
     bool hasVideoError();
@@ -151,13 +804,32 @@ public:
     void setOutputPixelFormat(string pixelF) {
         outputPixelFormat = pixelF;
     }
+    // Send each frame once with its presentation timestamp and let ffmpeg
+    // fill the constant output rate, instead of pushing duplicated frames
+    // through the pipe to keep sync. Needs an ffmpeg that reads
+    // V_UNCOMPRESSED Matroska, turn off for older builds.
+    void setTimestampedTransport(bool bTimestamps) { bUseTimestamps = bTimestamps; }
+    // Write through a shared pool instead of starting writer threads for this
+    // recorder. Takes effect on the next setup().
+    void setWriterPool(ofxVideoRecorderWriterPool * pool) { writerPool = pool; }
 
     unsigned long long getNumVideoFramesRecorded() { return videoFramesRecorded; }
     unsigned long long getNumAudioSamplesRecorded() { return audioSamplesRecorded; }
+    // frames skipped to keep sync, and output frames that repeat the previous
+    // one (sent again over the pipe, or filled in by ffmpeg when timestamped).
+    unsigned long long getNumVideoFramesWritten() { return videoThread.getNumWritten(); }
+    unsigned long long getNumBytesWritten() { return videoThread.getBytesWritten() + audioThread.getBytesWritten(); }
+    unsigned long long getNumVideoFramesDropped() { return videoFramesDropped; }
+    unsigned long long getNumVideoFramesDuplicated() { return videoFramesDuplicated; }
 
     int getVideoQueueSize(){ return frames.size(); }
     int getAudioQueueSize(){ return audioFrames.size(); }
 
+    ofxVideoRecorderStats getStats();
+    // every recording keeps a snapshot per second, write them out for
+    // capacity planning once the session is over.
+    bool saveStatsCsv(string path);
+
     bool isInitialized(){ return bIsInitialized; }
     bool isRecording() { return bIsRecording; };
     bool isPaused() { return bIsPaused; };
@@ -171,29 +843,39 @@ private:
     string fileName;
     string moviePath;
     string videoPipePath, audioPipePath;
+    string pidPath;
     string ffmpegLocation;
     string videoCodec, audioCodec, videoBitrate, audioBitrate, pixelFormat, outputPixelFormat;
     int width, height, sampleRate, audioChannels;
     float frameRate;
 
-    bool bIsInitialized;
+    std::atomic<bool> bIsInitialized;     // cleared by the close thread
     bool bRecordAudio;
     bool bRecordVideo;
     bool bIsRecording;
     bool bIsPaused;
     bool bFinishing;
     bool bIsSilent;
+    bool bUseTimestamps;
+    bool bTimestamped;
 
     bool bSysClockSync;
     float startTime;
     float recordingDuration;
     float totalRecordingDuration;
     float systemClock();
+    unsigned long closeTimeoutMs;
+    ofxVideoRecorderCloseHandlePtr closeHandle;
 
-    lockFreeQueue<ofPixels *> frames;
+    lockFreeQueue<videoFrame *> frames;
     lockFreeQueue<audioFrameShort *> audioFrames;
     unsigned long long audioSamplesRecorded;
     unsigned long long videoFramesRecorded;
+    unsigned long long videoFramesDropped;
+    unsigned long long videoFramesDuplicated;
+    long long lastVideoSlot;
+    bool addTimestampedFrame(const ofPixels &pixels);
+    ofxVideoRecorderWriterPool * writerPool;
     ofxVideoDataWriterThread videoThread;
     ofxAudioDataWriterThread audioThread;
     execThread ffmpegThread;
@@ -202,8 +884,29 @@ private:
     int pipeNumber;
 
     static set<int> openPipes;
+    static ofMutex openPipesMutex;
     static int requestPipeNumber();
     static void retirePipeNumber(int num);
 
+    long closeTimeLeft(unsigned long long deadline);
+    // how long aborted writers and ffmpeg get once the close deadline has passed
+    static const long abortGraceMs = 2000;
+    template <typename T>
+    bool stopWriter(ofxPipeWriterThread<T> & writer, const string & pipePath);
+    bool waitForEncoder(long milliseconds);
+    void killEncoder();
+
+    void sampleStats();
+    void fillStats(ofxVideoRecorderStats & stats);
+    float getEncoderCpu();
+    ofMutex statsMutex;
+    ofxVideoRecorderStats lastStats;
+    vector<ofxVideoRecorderStats> statsHistory;
+    unsigned long long setupTime;
+    double lastCpuSeconds;
+    float lastCpuTime;
+    float lastEncoderCpu;
     void outputFileComplete();
+    ofMutex completedFilesMutex;
+    vector<string> completedFiles;      // finalized, not yet notified by update()
 };
@@ -0,0 +1,236 @@
+#include "ofxVideoRecorderManager.h"
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+ofxVideoRecorderSessionStats::ofxVideoRecorderSessionStats(){
+    videoQueueSize = 0;
+    audioQueueSize = 0;
+    videoFramesWritten = 0;
+    bytesWritten = 0;
+    framesPerSecond = 0;
+    bytesPerSecond = 0;
+}
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+ofxVideoRecorderManager::ofxVideoRecorderManager(){
+    lastUpdateTime = 0;
+    lastQueueSize = 0;
+    queueGrowthCount = 0;
+}
+
+//--------------------------------------------------------------
+ofxVideoRecorderManager::~ofxVideoRecorderManager(){
+    for(size_t i = 0; i < sessions.size(); i++){
+        // the destructor closes the recording and waits for it to finish,
+        // the pool has to keep running until then.
+        delete sessions[i].recorder;
+    }
+    sessions.clear();
+    pool.stop();
+}
+
+//--------------------------------------------------------------
+void ofxVideoRecorderManager::setup(int numWriterThreads){
+    pool.setup(numWriterThreads);
+    lastUpdateTime = ofGetElapsedTimeMillis();
+}
+
+//--------------------------------------------------------------
+ofxVideoRecorder * ofxVideoRecorderManager::addSession(){
+    Session session;
+    session.recorder = new ofxVideoRecorder();
+    session.recorder->setWriterPool(&pool);
+    session.lastFramesWritten = 0;
+    session.lastBytesWritten = 0;
+    session.bRemoved = false;
+    sessions.push_back(session);
+    return session.recorder;
+}
+
+//--------------------------------------------------------------
+void ofxVideoRecorderManager::removeSession(ofxVideoRecorder * recorder){
+    for(size_t i = 0; i < sessions.size(); i++){
+        if(sessions[i].recorder == recorder && !sessions[i].bRemoved){
+            sessions[i].bRemoved = true;
+            sessions[i].closeHandle = recorder->close();
+            return;
+        }
+    }
+}
+
+//--------------------------------------------------------------
+void ofxVideoRecorderManager::update(){
+    // forget sessions whose output file is complete, after their listeners heard of it
+    for(size_t i = 0; i < sessions.size();){
+        Session & session = sessions[i];
+        session.recorder->update();
+        if(session.bRemoved && (!session.closeHandle || session.closeHandle->isComplete())){
+            delete session.recorder;
+            sessions.erase(sessions.begin() + i);
+        }
+        else{
+            i++;
+        }
+    }
+
+    unsigned long long now = ofGetElapsedTimeMillis();
+    if(now - lastUpdateTime < 1000){
+        return;
+    }
+    float elapsed = (now - lastUpdateTime) / 1000.f;
+    lastUpdateTime = now;
+
+    sessionStats.clear();
+    aggregateStats = ofxVideoRecorderSessionStats();
+    for(size_t i = 0; i < sessions.size(); i++){
+        Session & session = sessions[i];
+        ofxVideoRecorderSessionStats stats;
+        stats.fileName = session.recorder->getMoviePath();
+        stats.videoQueueSize = session.recorder->getVideoQueueSize();
+        stats.audioQueueSize = session.recorder->getAudioQueueSize();
+        stats.videoFramesWritten = session.recorder->getNumVideoFramesWritten();
+        stats.bytesWritten = session.recorder->getNumBytesWritten();
+        // the counters restart when a recorder is set up again
+        if(stats.videoFramesWritten >= session.lastFramesWritten && stats.bytesWritten >= session.lastBytesWritten){
+            stats.framesPerSecond = (stats.videoFramesWritten - session.lastFramesWritten) / elapsed;
+            stats.bytesPerSecond = (stats.bytesWritten - session.lastBytesWritten) / elapsed;
+        }
+        session.lastFramesWritten = stats.videoFramesWritten;
+        session.lastBytesWritten = stats.bytesWritten;
+        sessionStats.push_back(stats);
+
+        aggregateStats.videoQueueSize += stats.videoQueueSize;
+        aggregateStats.audioQueueSize += stats.audioQueueSize;
+        aggregateStats.videoFramesWritten += stats.videoFramesWritten;
+        aggregateStats.bytesWritten += stats.bytesWritten;
+        aggregateStats.framesPerSecond += stats.framesPerSecond;
+        aggregateStats.bytesPerSecond += stats.bytesPerSecond;
+    }
+
+    int queueSize = aggregateStats.videoQueueSize + aggregateStats.audioQueueSize;
+    if(queueSize > lastQueueSize){
+        queueGrowthCount++;
+    }
+    else{
+        queueGrowthCount = 0;
+    }
+    lastQueueSize = queueSize;
+}
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+ofxVideoRecorderCapacityBenchmark::ofxVideoRecorderCapacityBenchmark(){
+    outputString = " -vcodec mpeg4 -b 2000k -f null -";
+    width = 0;
+    height = 0;
+    fps = 0;
+    stepSeconds = 0;
+    maxSessions = 0;
+    numWriterThreads = 0;
+    startTime = 0;
+    stepStartTime = 0;
+    framesSent = 0;
+    sustainedSessions = 0;
+    bRunning = false;
+    bFinished = false;
+}
+
+//--------------------------------------------------------------
+void ofxVideoRecorderCapacityBenchmark::setup(int width, int height, float fps, float stepSeconds, int numWriterThreads, int maxSessions){
+    this->width = width;
+    this->height = height;
+    this->fps = fps;
+    this->stepSeconds = stepSeconds;
+    this->numWriterThreads = numWriterThreads;
+    this->maxSessions = maxSessions;
+
+    // a few noise frames in turn, so the encoder cannot get away with
+    // repeating the previous one
+    frames.resize(8);
+    for(size_t i = 0; i < frames.size(); i++){
+        frames[i].allocate(width, height, OF_PIXELS_RGB);
+        unsigned char * data = frames[i].getData();
+        for(size_t n = 0; n < frames[i].size(); n++){
+            data[n] = (unsigned char)ofRandom(256);
+        }
+    }
+
+    manager.setup(numWriterThreads);
+    sessions.clear();
+    framesSent = 0;
+    sustainedSessions = 0;
+    bFinished = false;
+    bRunning = true;
+    startTime = ofGetElapsedTimeMillis();
+    addSession();
+}
+
+//--------------------------------------------------------------
+void ofxVideoRecorderCapacityBenchmark::addSession(){
+    ofxVideoRecorder * session = manager.addSession();
+    session->setupCustomOutput(width, height, fps, outputString, false, true);
+    session->start();
+    sessions.push_back(session);
+    stepStartTime = ofGetElapsedTimeMillis();
+    ofLogNotice("ofxVideoRecorderCapacityBenchmark") << "running " << sessions.size() << " sessions of "
+        << width << "x" << height << "@" << fps;
+}
+
+//--------------------------------------------------------------
+void ofxVideoRecorderCapacityBenchmark::update(){
+    manager.update();
+    if(!bRunning){
+        return;
+    }
+
+    // all sessions get a frame on the same clock, catching up on missed ones
+    unsigned long long now = ofGetElapsedTimeMillis();
+    unsigned long long due = (unsigned long long)((now - startTime) * fps / 1000.f);
+    for(; framesSent < due; framesSent++){
+        const ofPixels & frame = frames[framesSent % frames.size()];
+        for(size_t i = 0; i < sessions.size(); i++){
+            sessions[i]->addFrame(frame);
+        }
+    }
+
+    if(!manager.isKeepingUp()){
+        finish();
+        return;
+    }
+    if(now - stepStartTime >= stepSeconds * 1000){
+        sustainedSessions = sessions.size();
+        if((int)sessions.size() >= maxSessions){
+            finish();
+            return;
+        }
+        addSession();
+    }
+}
+
+//--------------------------------------------------------------
+void ofxVideoRecorderCapacityBenchmark::finish(){
+    for(size_t i = 0; i < sessions.size(); i++){
+        manager.removeSession(sessions[i]);
+    }
+    sessions.clear();
+    bRunning = false;
+    bFinished = true;
+    ofLogNotice("ofxVideoRecorderCapacityBenchmark") << getReport();
+}
+
+//--------------------------------------------------------------
+string ofxVideoRecorderCapacityBenchmark::getReport(){
+    stringstream ss;
+    ss << width << "x" << height << "@" << fps << " with " << numWriterThreads << " writer threads: ";
+    if(bFinished){
+        ss << "sustained " << sustainedSessions << " sessions";
+        if(sustainedSessions >= maxSessions){
+            ss << " (the configured maximum)";
+        }
+    }
+    else{
+        ss << sessions.size() << " sessions, " << sustainedSessions << " sustained so far";
+    }
+    return ss.str();
+}
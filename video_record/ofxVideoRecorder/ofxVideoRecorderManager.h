@@ -0,0 +1,117 @@
+#pragma once
+
+#include "ofxVideoRecorder.h"
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+struct ofxVideoRecorderSessionStats {
+    ofxVideoRecorderSessionStats();
+
+    string fileName;
+    int videoQueueSize;
+    int audioQueueSize;
+    unsigned long long videoFramesWritten;
+    unsigned long long bytesWritten;
+    float framesPerSecond;      // video frames written to the pipe per second
+    float bytesPerSecond;       // video and audio bytes written per second
+};
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+// Runs several recordings over one ofxVideoRecorderWriterPool instead of
+// two writer threads per recorder. Each session still gets its own ffmpeg
+// process. All calls are meant for the app thread.
+//
+// To find how many sessions of a given size a machine sustains, keep adding
+// sessions while isKeepingUp() stays true, ofxVideoRecorderCapacityBenchmark
+// below does exactly that with synthetic frames.
+class ofxVideoRecorderManager {
+public:
+    ofxVideoRecorderManager();
+    ~ofxVideoRecorderManager();
+
+    void setup(int numWriterThreads = 2);
+
+    // The manager owns the returned recorder. Configure it and call setup()
+    // and start() on it as usual.
+    ofxVideoRecorder * addSession();
+    // Closes the session, it is deleted by update() once its file is complete.
+    void removeSession(ofxVideoRecorder * session);
+
+    // call once per frame, updates every session and refreshes the
+    // statistics about once a second.
+    void update();
+
+    int getNumSessions() { return sessions.size(); }
+    int getNumWriterThreads() { return pool.getNumThreads(); }
+
+    vector<ofxVideoRecorderSessionStats> getSessionStats() { return sessionStats; }
+    ofxVideoRecorderSessionStats getAggregateStats() { return aggregateStats; }
+
+    // false once the queued data has grown over several consecutive
+    // measurements, ie. the writers fall behind what the sessions produce.
+    bool isKeepingUp() { return queueGrowthCount < 3; }
+
+private:
+    struct Session {
+        ofxVideoRecorder * recorder;
+        ofxVideoRecorderCloseHandlePtr closeHandle;
+        unsigned long long lastFramesWritten;
+        unsigned long long lastBytesWritten;
+        bool bRemoved;
+    };
+
+    ofxVideoRecorderWriterPool pool;
+    vector<Session> sessions;
+    vector<ofxVideoRecorderSessionStats> sessionStats;
+    ofxVideoRecorderSessionStats aggregateStats;
+    unsigned long long lastUpdateTime;
+    int lastQueueSize;
+    int queueGrowthCount;
+};
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+// Measures how many sessions of one size a machine sustains. Starts with one
+// session fed with synthetic frames at its frame rate, and adds another after
+// every step the manager kept up with, until isKeepingUp() fails. Drive it
+// from the app loop, the result is logged and available once isFinished().
+class ofxVideoRecorderCapacityBenchmark {
+public:
+    ofxVideoRecorderCapacityBenchmark();
+
+    // ffmpeg output options of every session, by default they encode with
+    // mpeg4 to the null muxer so the disk does not take part.
+    void setOutputString(string output) { outputString = output; }
+    void setup(int width = 1280, int height = 720, float fps = 30, float stepSeconds = 10,
+               int numWriterThreads = 2, int maxSessions = 64);
+    // call once per app frame
+    void update();
+
+    bool isRunning() { return bRunning; }
+    bool isFinished() { return bFinished; }
+    int getNumSessions() { return sessions.size(); }
+    // the most sessions that kept up for a whole step
+    int getSustainedSessions() { return sustainedSessions; }
+    string getReport();
+
+private:
+    void addSession();
+    void finish();
+
+    ofxVideoRecorderManager manager;
+    vector<ofxVideoRecorder *> sessions;
+    vector<ofPixels> frames;
+    string outputString;
+    int width, height;
+    float fps;
+    float stepSeconds;
+    int maxSessions;
+    int numWriterThreads;
+    unsigned long long startTime;
+    unsigned long long stepStartTime;
+    unsigned long long framesSent;
+    int sustainedSessions;
+    bool bRunning;
+    bool bFinished;
+};